@@ -0,0 +1,144 @@
+#include "BatchRunner.h"
+#include "message/orders.h"
+#include "util/util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+BatchRunner::BatchRunner(Factory factory, std::size_t num_threads) :
+    factory(std::move(factory)), num_threads(num_threads)
+{
+    if (!this->factory) {
+        throw std::invalid_argument("BatchRunner requires a simulation factory.");
+    }
+}
+
+int BatchRunner::simulationSeed(int seed, int sim) {
+    // SplitMix64 finaliser over (seed, sim).
+    uint64_t z = (static_cast<uint64_t>(static_cast<uint32_t>(seed)) << 32) + static_cast<uint32_t>(sim);
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return static_cast<int>(z & 0x7FFFFFFF);
+}
+
+SimulationResult BatchRunner::runOne(const SimulationContext& ctx) {
+    SimulationResult result;
+    result.sim = ctx.sim;
+    result.seed = ctx.seed;
+    result.wallclock_seconds = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    try {
+        // Start every simulation from the same per-thread state, whatever ran here before.
+        seedRandom(static_cast<uint32_t>(ctx.seed));
+        Order::order_id_counter = 0;
+
+        if (!ctx.skip_log) {
+            std::filesystem::create_directories(std::filesystem::path("log") / ctx.log_dir);
+        }
+
+        std::unique_ptr<Simulation> s = factory(ctx);
+        if (!s || !s->kernel || !s->agents || !s->oracle) {
+            throw std::runtime_error("Simulation factory must supply a kernel, agents and an oracle.");
+        }
+
+        result.custom_state = s->kernel->runner(
+            *s->agents,
+            s->startTime,
+            s->stopTime,
+            ctx.seed,
+            1,
+            s->defaultComputationalDelay,
+            s->defaultLatency,
+            ctx.skip_log,
+            *s->oracle,
+            ctx.log_dir
+        );
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    } catch (...) {
+        result.error = "unknown exception";
+    }
+    result.wallclock_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    return result;
+}
+
+std::vector<SimulationResult> BatchRunner::run(int num_simulations, int seed, bool skip_log, const std::string& log_dir) {
+    std::vector<SimulationResult> results(std::max(num_simulations, 0));
+
+    // Each task writes only its own slot, so results need no locking.
+    ThreadPool pool(std::min<std::size_t>(num_threads, results.size()));
+    for (int sim = 0; sim < num_simulations; sim++) {
+        pool.submit([this, &results, sim, seed, skip_log, &log_dir] {
+            SimulationContext ctx;
+            ctx.sim = sim;
+            ctx.seed = simulationSeed(seed, sim);
+            ctx.skip_log = skip_log;
+            ctx.log_dir = log_dir + "/sim_" + std::to_string(sim);
+            results[sim] = runOne(ctx);
+        });
+    }
+    pool.wait();
+
+    return results;
+}
+
+std::unordered_map<std::string, std::string> BatchRunner::aggregate(const std::vector<SimulationResult>& results) {
+    struct Summary {
+        double sum = 0;
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        std::size_t count = 0;
+        bool numeric = true;
+    };
+
+    std::unordered_map<std::string, Summary> summaries;
+    std::size_t completed = 0;
+    double wallclock = 0;
+
+    for (const SimulationResult& result : results) {
+        wallclock += result.wallclock_seconds;
+        if (!result.error.empty()) { continue; }
+        completed++;
+
+        for (const auto& entry : result.custom_state) {
+            Summary& summary = summaries[entry.first];
+            if (!summary.numeric) { continue; }
+
+            const char* begin = entry.second.c_str();
+            char* end = nullptr;
+            double value = std::strtod(begin, &end);
+            if (end == begin || *end != '\0') {
+                summary.numeric = false;
+                continue;
+            }
+            summary.sum += value;
+            summary.min = std::min(summary.min, value);
+            summary.max = std::max(summary.max, value);
+            summary.count++;
+        }
+    }
+
+    std::unordered_map<std::string, std::string> aggregated;
+    for (const auto& entry : summaries) {
+        const Summary& summary = entry.second;
+        // Only keys every completed simulation reported as a number.
+        if (!summary.numeric || summary.count != completed) { continue; }
+        aggregated[entry.first + "_mean"] = std::to_string(summary.sum / summary.count);
+        aggregated[entry.first + "_min"] = std::to_string(summary.min);
+        aggregated[entry.first + "_max"] = std::to_string(summary.max);
+    }
+
+    aggregated["batch_simulations"] = std::to_string(results.size());
+    aggregated["batch_failed"] = std::to_string(results.size() - completed);
+    aggregated["batch_mean_wallclock_seconds"] = std::to_string(results.empty() ? 0.0 : wallclock / results.size());
+
+    return aggregated;
+}
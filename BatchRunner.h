@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Kernel.h"
+#include "agents/AgentRegistry.h"
+#include "util/logger.h"
+#include "util/oracles/Oracle.h"
+#include "util/ThreadPool.h"
+
+struct SimulationContext {
+    /*
+    What a BatchRunner tells its factory about the simulation to build.
+    */
+    int sim;                // Index within the batch, from 0.
+    int seed;               // Seed for this simulation, derived from the batch seed.
+    bool skip_log;
+    std::string log_dir;    // Per-simulation log directory (relative to log/).
+};
+
+
+struct Simulation {
+    /*
+    Everything one simulation owns, as built by a BatchRunner factory.  Nothing in here
+    may be shared with another simulation of the same batch: each has its own logger,
+    oracle, kernel and agents.  Read-only data may be shared: an ExternalFileOracle built
+    from a path shares its series with every other one in the process (FundamentalStore),
+    and can overlay its own noise (seeded from ctx.seed) instead of copying the data.
+    */
+    std::unique_ptr<Logger> logger;
+    std::unique_ptr<Oracle> oracle;
+    std::unique_ptr<Kernel> kernel;
+    std::unique_ptr<AgentRegistry> agents;
+
+    int startTime;
+    int stopTime;
+    int defaultComputationalDelay;
+    int defaultLatency;
+};
+
+
+struct SimulationResult {
+    int sim;
+    int seed;
+    std::unordered_map<std::string, std::string> custom_state;
+    std::string error;              // Empty unless the simulation threw.
+    double wallclock_seconds;
+};
+
+
+class BatchRunner {
+    /*
+    Runs many independent simulations in one process on a work-stealing thread pool.
+
+    For each simulation the factory is called on a worker thread to build a fresh
+    Simulation, which is then run to completion with Kernel::runner and destroyed there,
+    so simulations never share a kernel, agents or log sink.  Before the factory is called
+    the worker's fallback random stream (see util.h) is seeded with the simulation's seed
+    and the message and order id counters are reset.  Kernel latency noise is keyed by
+    the seed and each agent's stream by its random_state, so a factory that derives agent
+    random_states from ctx.seed gets results that depend only on the seed, not on which
+    thread ran the simulation or what ran there before.
+
+        BatchRunner batch([&](const SimulationContext& ctx) {
+            auto s = std::make_unique<Simulation>();
+            s->logger = std::make_unique<Logger>("log/" + ctx.log_dir + "/kernel.txt");
+            ...
+            return s;
+        });
+        std::vector<SimulationResult> results = batch.run(1000, 42, false, "sweep");
+        auto summary = BatchRunner::aggregate(results);
+
+    Compared with one process per seed this saves process startup and lets the factory
+    share anything expensive and read-only (e.g. parsed data files) across the batch.
+    */
+
+public:
+    typedef std::function<std::unique_ptr<Simulation>(const SimulationContext&)> Factory;
+
+private:
+    Factory factory;
+    std::size_t num_threads;
+
+    SimulationResult runOne(const SimulationContext& ctx);
+
+public:
+    BatchRunner(Factory factory, std::size_t num_threads = ThreadPool::defaultThreads());
+    /*
+    Arguments:
+        factory: Builds one simulation; called concurrently from several threads.
+        num_threads: Number of simulations run at once.
+    */
+
+    std::vector<SimulationResult> run(int num_simulations, int seed, bool skip_log, const std::string& log_dir);
+    /* Runs num_simulations simulations and returns their results in simulation order.
+       Simulation i gets seed simulationSeed(seed, i) and logs to <log_dir>/sim_<i>.
+       A simulation that throws is reported through its result's error, not rethrown. */
+
+    static int simulationSeed(int seed, int sim);
+    /* The seed of simulation sim in a batch seeded with seed (a SplitMix64 hash, so
+       neighbouring simulations get unrelated seeds). */
+
+    static std::unordered_map<std::string, std::string> aggregate(const std::vector<SimulationResult>& results);
+    /* Summarises custom_state across the simulations that completed: for every key whose
+       value is numeric in each of them, <key>_mean, <key>_min and <key>_max.  Also adds
+       batch_simulations, batch_failed and batch_mean_wallclock_seconds. */
+};
@@ -3,26 +3,67 @@
 #include "util/oracles/ExternalFileOracle.h"
 #include "util/util.h"
 #include "message/orders.h"
+#include "util/queues/BinaryHeapQueue.h"
+#include "util/queues/CalendarQueue.h"
 #include <stdexcept>
 #include <algorithm>
 #include <sstream>
 #include <ctime>
+#include <filesystem>
+#include <exception>
+#include <limits>
+#include <thread>
+#include "util/SpinBarrier.h"
+
+// The automatic order id counter is per thread, so that concurrent simulations never share it.
+thread_local OrderId Order::order_id_counter = 0;
+
+static std::unique_ptr<EventQueue> makeEventQueue(EventQueueType queue_type) {
+    switch (queue_type) {
+        case EventQueueType::BINARY_HEAP:
+            return std::make_unique<BinaryHeapQueue>();
+        case EventQueueType::CALENDAR:
+            break;
+    }
+    return std::make_unique<CalendarQueue>();
+}
 
-// Initialise message static id var to 0.
-int Message::uniq = 0;
-
-int Order::order_id_counter = 0;
-
-Kernel::Kernel(const std::string& kernel_name, const int& random_state, Logger& logger) :
-    kernel_name(kernel_name), random_state(random_state), logger(logger)
+Kernel::Kernel(const std::string& kernel_name, const int& random_state, Logger& logger, EventQueueType queue_type) :
+    kernel_name(kernel_name), random_state(random_state), logger(logger),
+    queue_type(queue_type), parallelism(1), eventLog(nullptr)
 {
     kernelWallClockStart = time(0);
 
-    logger.log("Kernel initialised.");
+    LOG_INFO(logger, "Kernel initialised.");
+}
+
+template <typename F>
+void Kernel::dispatch(int id, F&& call) {
+    /* Runs one call into agent `id` with that agent's own automatic order id sequence
+        loaded (see Order::order_id_counter), so the ids it gets only depend on its own
+        history, whichever LP or thread the call happens on.  The thread's counter is put
+        back afterwards, so orders created outside the kernel are unaffected. */
+    OrderId outer = Order::order_id_counter;
+    Order::order_id_counter = agentNextOrderId[id];
+    call(agents->get(id));
+    agentNextOrderId[id] = Order::order_id_counter;
+    Order::order_id_counter = outer;
+}
+
+void Kernel::setLatencyModel(std::unique_ptr<LatencyModel> model) {
+    latencyModel = std::move(model);
+    customLatencyModel = latencyModel != nullptr;
+}
+
+void Kernel::setParallelism(int num_lps) {
+    if (num_lps < 1) {
+        throw std::invalid_argument("Kernel parallelism must be at least 1.");
+    }
+    parallelism = num_lps;
 }
 
 std::unordered_map<std::string, std::string> Kernel::runner(
-        std::vector<Agent>& agents, 
+        AgentRegistry& agents, 
         int startTime, 
         int stopTime,
         int seed,
@@ -34,8 +75,10 @@ std::unordered_map<std::string, std::string> Kernel::runner(
         std::string log_dir
         )
 {
-    // Agents must be a list of agents for the simulation.
-    this->agents = agents;
+    /* Agents must be a registry of agents for the simulation.  The kernel
+        dispatches to them through Agent's virtual interface. */
+    agents.validate();
+    this->agents = &agents;
 
     /* The kernel start and stop time (first and last timestamp in
         the simulation, separate from anything like exchange open/close). */
@@ -46,7 +89,8 @@ std::unordered_map<std::string, std::string> Kernel::runner(
     this->seed = seed;
 
     this->skip_log = skip_log;
-    this->oracle = oracle;
+    this->log_dir = log_dir;
+    this->oracle = &oracle;
     
     /* The kernel maintains a current time for each agent to allow
         simulation of per-agent computation delays.  The agent's time
@@ -66,19 +110,65 @@ std::unordered_map<std::string, std::string> Kernel::runner(
         penalty applies _after_ the agent acts, before it may act again. */
     agentComputationDelays.resize(n_agents, defaultComputationalDelay);
 
-    agentLatency.resize(n_agents, std::vector<int>(n_agents, defaultLatency));
+    if (!customLatencyModel) {
+        latencyModel = std::make_unique<UniformLatencyModel>(defaultLatency);
+    }
+    latencyModel->checkAgents(n_agents);
+
+    // Kernel streams sit in the upper half of the stream id space, clear of agent ids.
+    latencyNoise.clear();
+    for (int i = 0; i < n_agents; i++) {
+        latencyNoise.emplace_back(static_cast<uint32_t>(seed), (uint64_t(1) << 63) | static_cast<uint64_t>(i));
+    }
+
+    /* Spread the agents round-robin over the logical processes.  Events between agents
+        of different LPs are at least `lookahead` apart, which is what lets LPs advance
+        concurrently; with no lookahead there is nothing to gain, so run sequentially. */
+    int n_lps = std::max(1, std::min(parallelism, n_agents));
+    int64_t lookahead = latencyModel->minLatency();
+    if (n_lps > 1) {
+        if (lookahead <= 0) {
+            LOG_WARNING(logger, "Minimum inter-agent latency is 0; running sequentially.");
+            n_lps = 1;
+        }
+    }
+
+    lps.clear();
+    for (int i = 0; i < n_lps; i++) {
+        lps.emplace_back(new LogicalProcess());
+        lps.back()->messages = makeEventQueue(queue_type);
+    }
+    agentLP.resize(n_agents);
+    agentNextOrderId.resize(n_agents);
+    for (int i = 0; i < n_agents; i++) {
+        agentLP[i] = i % n_lps;
+        agentNextOrderId[i] = static_cast<OrderId>(i) << 32;
+    }
+    agentSendSeq.assign(n_agents, 0);
+    agentLogSeq.assign(n_agents, 0);
+    kernelLogSeq = 0;
+    if (eventLog != nullptr && eventLog->producerCount() < lps.size()) {
+        throw std::invalid_argument("The event log needs a producer for each of the "
+                                    + std::to_string(lps.size()) + " logical processes.");
+    }
 
-    currentAgentAdditionalDelay = 0;
+    agentBatches.resize(n_agents);
+    anyBatchAgents = false;
+    for (int i = 0; i < n_agents; i++) {
+        agentBatches[i] = agents.get(i).receivesBatches();
+        anyBatchAgents = anyBatchAgents || agentBatches[i];
+    }
+    agentBatchTail.assign(n_agents, -1);
 
-    logger.log("Kernel started.");
-    logger.log("Simulation started.");
+    LOG_INFO(logger, "Kernel started.");
+    LOG_INFO(logger, "Simulation started.");
     
-    /*  Note that num_simulations has not yet been really used or tested
-        for anything.  Instead we have been running multiple simulations
-        with coarse parallelization from a shell script.*/
+    /*  num_simulations reruns the same agents in sequence.  Independent
+        simulations (e.g. a sweep over seeds) are better run concurrently,
+        each with its own kernel and agents, by a BatchRunner.*/
     for (int sim=0; sim<num_simulations; sim++)
     {
-        logger.log("Starting sim " + std::to_string(sim));
+        LOG_INFO(logger, "Starting sim " + std::to_string(sim));
         /* Event notification for kernel init (agents should not try to
             communicate with other agents, as order is unknown). Agents
             should initialize any internal resources that may be needed
@@ -87,10 +177,10 @@ std::unordered_map<std::string, std::string> Kernel::runner(
             communicate with the kernel in the future (as it does not have
             an agentID). */
             
-        logger.log("––– Agent.kernelInitialising() ---");
+        LOG_INFO(logger, "––– Agent.kernelInitialising() ---");
         for (int i=0; i<n_agents; i++)
         {
-            this->agents[i].kernelInitialising(*this);
+            dispatch(i, [&](Agent& agent) { agent.kernelInitialising(*this); });
         }
 
         /* Event notification for kernel start (agents may set up
@@ -107,138 +197,97 @@ std::unordered_map<std::string, std::string> Kernel::runner(
             the Kernel.  Direct references to utility objects that are not
             agents are acceptable (e.g. oracles). */
 
-        logger.log("––– Agent.kernelStarting() ---");
+        LOG_INFO(logger, "––– Agent.kernelStarting() ---");
+        for (auto& lp : lps) { lp->currentTime = currentTime; }
         for (int i=0; i<n_agents; i++) {
-            this->agents[i].kernelStarting(startTime);
+            dispatch(i, [&](Agent& agent) { agent.kernelStarting(this->startTime); });
         }
 
         // Set the kernel to its startTime.
         currentTime = startTime;
-        logger.log("––– Kernel Clock started ---");
-        logger.log("Kernel.currentTime is now" + currentTime.to_string());
+        for (auto& lp : lps) { lp->currentTime = currentTime; }
+        LOG_INFO(logger, "––– Kernel Clock started ---");
+        LOG_INFO(logger, "Kernel.currentTime is now" + currentTime.to_string());
 
         // Start processing the Event Queue.
-        logger.log("––– Kernel Event Queue begins ---");
-        logger.log("Kernel will start processing messages.  Queue length: " +  std::to_string(messages.size()));
+        LOG_INFO(logger, "––– Kernel Event Queue begins ---");
+        std::size_t queued = 0;
+        for (auto& lp : lps) { queued += lp->messages->size() + lp->wakeups.size() + lp->outbox.size(); }
+        LOG_INFO(logger, "Kernel will start processing messages.  Queue length: " +  std::to_string(queued));
+
+        recordEvent(currentTime, -1, LogEvent::KERNEL_START, sim);
 
         // Track starting wall clock time and total message count.
         eventQueueWallClockStart = time(0);
         ttl_messages = 0;
-        
+        for (auto& lp : lps) { lp->ttl_messages = 0; }
+
         /* Process messages until there aren't any (at which point there never can
             be again, because agents only "wake" in response to messages), or until
             the kernel stop time is reached. */
+        if (lps.size() == 1) {
+            runSequential(*lps[0]);
+        }
+        else {
+            runParallel(lookahead);
+        }
 
-        while (not messages.empty() and currentTime.isValid() and (currentTime <= stopTime)) {        
-            // Get the next message in timestamp order (delivery time) and extract it.
-            QueueEntry entry = messages.top();
-            messages.pop();
-            const Message* msg = entry.msg;
-            int recipientId = entry.recipientId;
-            int senderId = entry.senderId;
-
-
-            // Periodically print the simulation time and total messages, even if muted.
-            if (ttl_messages % 100000 == 0)
-            {
-                std::ostringstream oss;
-                oss << "\n--- Simulation time: " << currentTime.to_string() << ", messages processed: " 
-                << ttl_messages << ", wallclock elapsed: " << time(0) - eventQueueWallClockStart;
-                logger.log(oss.str()); // Log the message using Logger
-            }
-            
-            logger.log("\n--- Kernel Event Queue pop ---");
-            logger.log("Kernel handling " + msg->getName() + " message for agent " 
-            + std::to_string(recipientId) + " at time " + currentTime.to_string());
-
-            ttl_messages ++;
-            
-            // In between messages, always reset the currentAgentAdditionalDelay.
-            currentAgentAdditionalDelay = 0;
-
-
-            // Dispatch message to agent.
-            if (const WakeupMsg* wakeupMsg = dynamic_cast<const WakeupMsg*>(msg)) {                    
-                
-                /* Test to see if the agent is already in the future.  If so,
-                    delay the wakeup until the agent can act again. */
-                if (agentCurrentTimes[recipientId] > currentTime)
-                {
-                    // Push the wakeup call back into th PQ with a new time.
-                    messages.push(QueueEntry(agentCurrentTimes[recipientId], recipientId, recipientId, wakeupMsg));
-                    logger.log("Agent in future: wakeup requested for " + agentCurrentTimes[recipientId].to_string());
-                    continue;
-                }
-                // Set agent's current time to global current time for start of processing.
-                agentCurrentTimes[recipientId] = currentTime;
-
-                // Wake the agent.
-                agents[recipientId].wakeup(currentTime);
-
-                // Delay the agent by its computation delay plus any transient additional delay requested.
-                agentCurrentTimes[recipientId] += agentComputationDelays[recipientId] + currentAgentAdditionalDelay;
-            
-                logger.log("After wakeup return, agent " + std::to_string(recipientId) + " delayed from " 
-                            + " to" + agentCurrentTimes[recipientId].to_string());
-            }
-
-            else {                    
-                // Test to see if the agent is already in the future. If so
-                // delay the message until the agent can act again.
-                if (agentCurrentTimes[recipientId] > currentTime) {
-                    // Push the message back into the PQ with a new time.
-                    messages.push(QueueEntry(agentCurrentTimes[recipientId], senderId, recipientId, msg));
-                    logger.log("Agent in future: message requed for " + agentCurrentTimes[recipientId].to_string());
-                    continue;
-                }
-
-                // Set agent's current time to global current time for start of processsing.
-                agentCurrentTimes[recipientId] = currentTime;
-
-                // Deliver the message.
-                agents[recipientId].receiveMessage(currentTime, senderId, msg);
+        bool drained = true;
+        for (auto& lp : lps) {
+            ttl_messages += lp->ttl_messages;
+            drained = drained && lp->empty() && lp->outbox.empty();
+        }
+        if (drained) { LOG_INFO(logger, "\n--- Kernel Event Queue empty ---"); }
 
-                // Delay the agent by its computation plus any transient additoinal delay requested.
-                agentCurrentTimes[recipientId] += agentComputationDelays[recipientId] + currentAgentAdditionalDelay;
+        if (currentTime.isValid() && (currentTime > stopTime)) { LOG_INFO(logger, "\n--- Kernel Stop Time surpassed ---"); }
 
-                logger.log("After receiveMessage return, agent " + std::to_string(recipientId) + " delayed from "
-                            + currentTime.to_string() + " to " + agentCurrentTimes[recipientId].to_string());
+        // Messages still pending at the stop time are never delivered; recycle them.
+        for (auto& lp : lps) {
+            while (not lp->messages->empty()) {
+                lp->messagePool.release(lp->messages->pop().msg);
             }
-
+            lp->wakeups.clear();
+            for (const QueueEntry& entry : lp->outbox) {
+                lp->messagePool.release(entry.msg);
+            }
+            lp->outbox.clear();
+            lp->windowEnd = INT64_MIN;
+        }
+        for (auto& lp : lps) {
+            lp->messagePool.returnForeign();
         }
-        if (messages.empty()) { logger.log("\n--- Kernel Event Queue empty ---"); }
-
-        if (currentTime.isValid() && (currentTime > stopTime)) { logger.log("\n--- Kernel Stop Time surpassed ---"); }
 
         // Record wall clock stop time and elapsed time for stats at the end.
         int eventQueueWallClockStop = time(0);
 
         eventQueueWallClockElapsed = eventQueueWallClockStop - eventQueueWallClockStart;
 
+        recordEvent(currentTime, -1, LogEvent::KERNEL_STOP, sim, ttl_messages);
+
         /* Event notification for kernel end (agents may communicate with
             other agents, as all agents are still guaranteed to exist).
             Agents should not destroy resources they may need to respond
             to final communications from other agents. */
-        logger.log("\n--- Agent.kernelStopping() ---");
+        LOG_INFO(logger, "\n--- Agent.kernelStopping() ---");
         
         for (int id = 0; id < agents.size(); id++) {
-            agents[id].kernelStopping();
+            dispatch(id, [](Agent& agent) { agent.kernelStopping(); });
         }
 
         /* Event notification for kernel termination (agents should not
             attempt communication with other agents, as order of termination
             is unknown). Agents should clean up all used resources as the
             simulation program may not actually terminate if num_simulations > 1. */
-        logger.log("\n--- Agent.kernelTerminating() ---");
+        LOG_INFO(logger, "\n--- Agent.kernelTerminating() ---");
 
         for (int id = 0; id < agents.size(); id++) {
-            agents[id].kernelTerminating();
+            dispatch(id, [](Agent& agent) { agent.kernelTerminating(); });
         }
         
         std::cout << "Event Queue elapsed: " << eventQueueWallClockElapsed << ", messages: " << ttl_messages 
                     << ", messages per second: IMPLEMENT" << std::endl;
 
-        logger.log("Ending sim " + std::to_string(sim));
+        LOG_INFO(logger, "Ending sim " + std::to_string(sim));
     }
     // The Kernel adds a handful of custom state results for all simulations,
     // which configurations may use, print, log, or discard.
@@ -261,13 +310,318 @@ std::unordered_map<std::string, std::string> Kernel::runner(
     }
 
     std::cout << "Simulation ending!" << std::endl;
+    logger.flush();
 
     return custom_state;
 }
+void Kernel::enqueue(LogicalProcess& lp, const QueueEntry& entry) {
+    LogicalProcess& target = lpOf(entry.recipientId);
+    if (&target == &lp) {
+        lp.messages->push(entry);
+        return;
+    }
+    if (queueKeyNanos(entry.key) < lp.windowEnd) {
+        throw std::logic_error("Message from agent " + std::to_string(entry.senderId) + " to agent "
+                               + std::to_string(entry.recipientId) + " would arrive inside the current"
+                               " lookahead window (negative delay?); not supported in parallel mode.");
+    }
+    lp.outbox.push_back(entry);
+}
+
+QueueEntry Kernel::popNext(LogicalProcess& lp, WakeupHandle& wakeup) {
+    /* Get the next event in timestamp order (delivery time) and extract it: the earlier
+        of the next message and the next wakeup.  Wakeups carry no message. */
+    if (!lp.wakeups.empty() && (lp.messages->empty() || lp.wakeups.top().key < lp.messages->top().key)) {
+        return lp.wakeups.pop(wakeup);
+    }
+    wakeup = WakeupHandle();
+    return lp.messages->pop();
+}
+
+void Kernel::processNext(LogicalProcess& lp) {
+    WakeupHandle wakeup;
+    QueueEntry entry = popNext(lp, wakeup);
+    processEvent(lp, entry, wakeup);
+}
+
+void Kernel::processEvent(LogicalProcess& lp, const QueueEntry& entry, WakeupHandle handle) {
+    lp.currentTime = entry.time();
+    const Timestamp& currentTime = lp.currentTime;
+    const Message* msg = entry.msg;
+    bool isWakeup = msg == nullptr;
+    int recipientId = entry.recipientId;
+    int senderId = entry.senderId;
+
+    LOG_TRACE(logger, "\n--- Kernel Event Queue pop ---");
+    LOG_TRACE(logger, "Kernel handling " + (isWakeup ? std::string("wakeup") : msg->getName() + " message")
+    + " for agent " + std::to_string(recipientId) + " at time " + currentTime.to_string());
+
+    lp.ttl_messages ++;
+
+    // In between messages, always reset the currentAgentAdditionalDelay.
+    lp.currentAgentAdditionalDelay = 0;
+
+    /* Test to see if the agent is already in the future.  If so, delay the
+        wakeup or message until the agent can act again. */
+    if (agentCurrentTimes[recipientId] > currentTime) {
+        // Push the event back with a new time (and its original tie-break).  A deferred
+        // wakeup keeps its handle, so the agent can still cancel it.
+        if (isWakeup) {
+            lp.wakeups.defer(handle, makeQueueKey(agentCurrentTimes[recipientId], entry.seq()));
+            recordEvent(currentTime, recipientId, LogEvent::WAKEUP_REQUEUED,
+                        agentCurrentTimes[recipientId].to_nanoseconds());
+            LOG_TRACE(logger, "Agent in future: wakeup requested for " + agentCurrentTimes[recipientId].to_string());
+        }
+        else {
+            lp.messages->push(QueueEntry(agentCurrentTimes[recipientId], entry.seq(), senderId, recipientId, msg));
+            recordEvent(currentTime, recipientId, LogEvent::MESSAGE_REQUEUED, senderId,
+                        agentCurrentTimes[recipientId].to_nanoseconds());
+            LOG_TRACE(logger, "Agent in future: message requed for " + agentCurrentTimes[recipientId].to_string());
+        }
+        return;
+    }
+
+    // Set agent's current time to global current time for start of processing.
+    agentCurrentTimes[recipientId] = currentTime;
+
+    // Dispatch to the agent, then retire the wakeup or recycle the message.
+    if (isWakeup) {
+        recordEvent(currentTime, recipientId, LogEvent::WAKEUP);
+        dispatch(recipientId, [&](Agent& agent) { agent.wakeup(currentTime); });
+        lp.wakeups.finish(handle);
+    }
+    else {
+        recordEvent(currentTime, recipientId, LogEvent::MESSAGE_DELIVERED, senderId, msg->type_id);
+        dispatch(recipientId, [&](Agent& agent) { agent.receiveMessage(currentTime, senderId, msg); });
+        lp.messagePool.release(msg);
+    }
+
+    // Delay the agent by its computation delay plus any transient additional delay requested.
+    agentCurrentTimes[recipientId] += agentComputationDelays[recipientId] + lp.currentAgentAdditionalDelay;
+
+    LOG_TRACE(logger, "After event, agent " + std::to_string(recipientId) + " delayed from "
+                + currentTime.to_string() + " to " + agentCurrentTimes[recipientId].to_string());
+}
+
+void Kernel::processBatch(LogicalProcess& lp) {
+    /* Delivers every event pending at the head timestamp in key order, exactly as
+        repeated processNext() calls would, except that all the messages for an agent that
+        receivesBatches() go to it in one receiveMessages() call, at the point of its
+        first one.  Only messages are drained up front; wakeups stay in the wheel until
+        their turn, so they can still be cancelled by the events before them.  Messages
+        created meanwhile for this same timestamp (only possible with zero delay and
+        latency) are left for the next batch. */
+    if (!anyBatchAgents) {
+        processNext(lp);
+        return;
+    }
+
+    const int64_t t = queueKeyNanos(lp.nextKey());
+    std::vector<BatchedEvent>& batch = lp.batch;
+    batch.clear();
+    while (!lp.messages->empty() && queueKeyNanos(lp.messages->top().key) == t) {
+        batch.emplace_back();
+        batch.back().entry = lp.messages->pop();
+
+        // Chain each batching agent's messages together.
+        int recipient = batch.back().entry.recipientId;
+        if (agentBatches[recipient]) {
+            int index = static_cast<int>(batch.size()) - 1;
+            if (agentBatchTail[recipient] >= 0) { batch[agentBatchTail[recipient]].next = index; }
+            agentBatchTail[recipient] = index;
+        }
+    }
+
+    WakeupHandle wakeup;
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        BatchedEvent& event = batch[i];
+        while (!lp.wakeups.empty() && lp.wakeups.top().key < event.entry.key) {
+            QueueEntry entry = lp.wakeups.pop(wakeup);
+            processEvent(lp, entry, wakeup);
+        }
+        if (event.done) { continue; }
+
+        int recipient = event.entry.recipientId;
+        if (!agentBatches[recipient]) {
+            processEvent(lp, event.entry, WakeupHandle());
+            continue;
+        }
+        agentBatchTail[recipient] = -1;
+        deliverBatch(lp, static_cast<int>(i));
+    }
+    while (!lp.wakeups.empty() && queueKeyNanos(lp.wakeups.top().key) == t) {
+        QueueEntry entry = lp.wakeups.pop(wakeup);
+        processEvent(lp, entry, wakeup);
+    }
+}
+
+void Kernel::deliverBatch(LogicalProcess& lp, int first) {
+    // Delivers the chain of messages starting at lp.batch[first] to their (batching) recipient.
+    std::vector<BatchedEvent>& batch = lp.batch;
+    int recipientId = batch[first].entry.recipientId;
+    lp.currentTime = batch[first].entry.time();
+    const Timestamp& currentTime = lp.currentTime;
+
+    if (agentCurrentTimes[recipientId] > currentTime) {
+        // The agent is busy: requeue each message individually, as processNext would.
+        for (int i = first; i >= 0; i = batch[i].next) {
+            batch[i].done = true;
+            processEvent(lp, batch[i].entry, WakeupHandle());
+        }
+        return;
+    }
+
+    lp.delivered.clear();
+    for (int i = first; i >= 0; i = batch[i].next) {
+        const QueueEntry& entry = batch[i].entry;
+        batch[i].done = true;
+        lp.delivered.push_back(DeliveredMessage{entry.senderId, entry.msg});
+        recordEvent(currentTime, recipientId, LogEvent::MESSAGE_DELIVERED, entry.senderId, entry.msg->type_id);
+    }
+
+    LOG_TRACE(logger, "Kernel delivering " + std::to_string(lp.delivered.size()) + " messages to agent "
+    + std::to_string(recipientId) + " at time " + currentTime.to_string());
+
+    lp.ttl_messages += static_cast<int>(lp.delivered.size());
+    lp.currentAgentAdditionalDelay = 0;
+    agentCurrentTimes[recipientId] = currentTime;
+
+    dispatch(recipientId, [&](Agent& agent) {
+        agent.receiveMessages(currentTime, MessageBatch(lp.delivered.data(), lp.delivered.size()));
+    });
+    for (const DeliveredMessage& delivered : lp.delivered) {
+        lp.messagePool.release(delivered.message);
+    }
+
+    // One computation delay for the whole batch.
+    agentCurrentTimes[recipientId] += agentComputationDelays[recipientId] + lp.currentAgentAdditionalDelay;
+}
+
+void Kernel::runSequential(LogicalProcess& lp) {
+    const int64_t stop_ns = stopTime.to_nanoseconds();
+    int reported = -1;
+    while (not lp.empty() and currentTime.isValid() and (currentTime <= stopTime)) {
+        // Periodically print the simulation time and total messages, unless logging is off.
+        if (lp.ttl_messages / 100000 != reported && logger.enabled(LogLevel::INFO))
+        {
+            reported = lp.ttl_messages / 100000;
+            std::ostringstream oss;
+            oss << "\n--- Simulation time: " << currentTime.to_string() << ", messages processed: " 
+            << lp.ttl_messages << ", wallclock elapsed: " << time(0) - eventQueueWallClockStart;
+            logger.log(oss.str()); // Log the message using Logger
+        }
+
+        // Only the first event past the stop time is delivered, never a whole batch.
+        if (queueKeyNanos(lp.nextKey()) > stop_ns) {
+            processNext(lp);
+        }
+        else {
+            processBatch(lp);
+        }
+        currentTime = lp.currentTime;
+    }
+}
+
+void Kernel::runParallel(int64_t lookahead) {
+    /* YAWNS: repeatedly find the earliest pending event T across all LPs; every event
+        before T + lookahead can only have been caused by events already processed, so
+        all LPs process their events in [T, T + lookahead) concurrently, each in key order.
+        Anything they send to another LP arrives at or after T + lookahead and is held in
+        the sender's outbox until the barrier that ends the window.  LP 0 runs on this
+        thread; the rest each get their own. */
+    const std::size_t n = lps.size();
+    const int64_t stop_ns = stopTime.to_nanoseconds();
+
+    SpinBarrier barrier(n);
+    bool done = false;
+    int64_t windowEnd = 0;
+    std::vector<std::exception_ptr> errors(n);
+
+    auto processWindow = [&](std::size_t i) {
+        LogicalProcess& lp = *lps[i];
+        lp.windowEnd = windowEnd;
+        try {
+            while (not lp.empty() && queueKeyNanos(lp.nextKey()) < windowEnd) {
+                processBatch(lp);
+            }
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < n; i++) {
+        workers.emplace_back([&, i] {
+            while (true) {
+                barrier.wait();         // Window published (or done).
+                if (done) { return; }
+                processWindow(i);
+                barrier.wait();         // Window finished.
+            }
+        });
+    }
+
+    std::exception_ptr error;
+    int reported = 0;
+    while (currentTime.isValid() && currentTime <= stopTime) {
+        // Hand events sent across LPs during the last window to their recipients, and
+        // the blocks of messages delivered across LPs back to the pools that made them.
+        for (auto& lp : lps) {
+            for (const QueueEntry& entry : lp->outbox) { lpOf(entry.recipientId).messages->push(entry); }
+            lp->outbox.clear();
+            lp->messagePool.returnForeign();
+        }
+
+        LogicalProcess* next = nullptr;
+        for (auto& lp : lps) {
+            if (lp->empty()) { continue; }
+            if (next == nullptr || lp->nextKey() < next->nextKey()) { next = lp.get(); }
+        }
+        if (next == nullptr) { break; }
+
+        int64_t start = queueKeyNanos(next->nextKey());
+        if (start > stop_ns) {
+            // As in a sequential run, the first event past the stop time is still delivered
+            // (anything it sends is never delivered, so need not respect the lookahead).
+            next->windowEnd = INT64_MIN;
+            try { processNext(*next); } catch (...) { error = std::current_exception(); }
+            currentTime = next->currentTime;
+            break;
+        }
+
+        windowEnd = std::min(start + lookahead, stop_ns + 1);
+        barrier.wait();
+        processWindow(0);
+        barrier.wait();
+
+        for (std::size_t i = 0; i < n && !error; i++) { error = errors[i]; }
+        if (error) { break; }
+
+        int processed = 0;
+        for (auto& lp : lps) {
+            processed += lp->ttl_messages;
+            if (lp->currentTime > currentTime) { currentTime = lp->currentTime; }
+        }
+        if (processed / 100000 != reported && logger.enabled(LogLevel::INFO)) {
+            reported = processed / 100000;
+            std::ostringstream oss;
+            oss << "\n--- Simulation time: " << currentTime.to_string() << ", messages processed: " 
+            << processed << ", wallclock elapsed: " << time(0) - eventQueueWallClockStart;
+            logger.log(oss.str());
+        }
+    }
+
+    done = true;
+    barrier.wait();
+    for (std::thread& worker : workers) { worker.join(); }
+
+    if (error) { std::rethrow_exception(error); }
+}
+
 void Kernel::sendMessage(
     const int& sender, 
     const int& recipient, 
-    const Message msg,
+    const Message* msg,
     int delay
     ) {
     /* Apply the agent's current computation delay to effectively "send" the message
@@ -283,19 +637,29 @@ void Kernel::sendMessage(
        This means message delay (before latency) is the agent's standard computation delay
        PLUS any accumulated delay for this wake cycle PLUS any one-time requested delay
        for this specific message only. */
-    Timestamp sentTime(currentTime + agentComputationDelays[sender] + currentAgentAdditionalDelay + delay);
+    LogicalProcess& lp = lpOf(sender);
+    const Timestamp& currentTime = lp.currentTime;
+    Timestamp sentTime(currentTime + agentComputationDelays[sender] + lp.currentAgentAdditionalDelay + delay);
     
-    /* Apply communication delay per the agentLatencyModel, if defined, or the agentLatency
-       matrix [sender][recipient] otherwise. */
-    // TODO: Implement agency latency model
-    int latency = agentLatency[sender][recipient];
-    double noise = genRandInt(0,3);
+    // Apply communication delay per the latency model, plus a few nanoseconds of noise.
+    int64_t latency = latencyModel->latency(sender, recipient, latencyNoise[sender]);
+    int noise = latencyNoise[sender].uniformInt(0, 3);
     Timestamp deliverAt(sentTime + latency + noise);
 
+    // Finally drop the message in the queue with priority == delivery time.
+    enqueue(lp, QueueEntry(deliverAt, nextSeq(sender), sender, recipient, msg));
+
+    recordEvent(currentTime, sender, LogEvent::MESSAGE_SENT, recipient, msg->type_id);
+
+    LOG_TRACE(logger, "Sent time: " + sentTime.to_string() + ", current time: " + currentTime.to_string()
+               + ", computation delay: " + std::to_string(agentComputationDelays[sender]));
+    LOG_TRACE(logger, "Message queued: " + msg->getName());
 }
 
 
-void Kernel::setWakeup(const int& sender, Timestamp requestedTime) {
+Timestamp Kernel::checkWakeupTime(const LogicalProcess& lp, Timestamp requestedTime) {
+    const Timestamp& currentTime = lp.currentTime;
+
     if (requestedTime == 0) { requestedTime = currentTime + 1000; }
 
     if (currentTime.isValid() && (requestedTime < currentTime)) {
@@ -305,12 +669,48 @@ void Kernel::setWakeup(const int& sender, Timestamp requestedTime) {
                      << "requestedTime: " << requestedTime.to_string();
         throw std::runtime_error(errorMessage.str());
     }
+    return requestedTime;
+}
+
+WakeupHandle Kernel::setWakeup(const int& sender, Timestamp requestedTime) {
+    LogicalProcess& lp = lpOf(sender);
+    requestedTime = checkWakeupTime(lp, requestedTime);
 
-    logger.log("Kernel adding wakeup for agent " + std::to_string(sender) + " at time " 
+    LOG_TRACE(logger, "Kernel adding wakeup for agent " + std::to_string(sender) + " at time " 
     + requestedTime.to_string());
 
-    const WakeupMsg* msg; 
-    messages.push(QueueEntry(requestedTime, sender, sender, msg));
+    return lp.wakeups.push(QueueEntry(requestedTime, nextSeq(sender), sender, sender, nullptr));
+}
+
+bool Kernel::cancelWakeup(const int& sender, WakeupHandle handle) {
+    LogicalProcess& lp = lpOf(sender);
+    const QueueEntry* pending = lp.wakeups.find(handle);
+    if (pending == nullptr || pending->recipientId != sender) { return false; }
+
+    QueueEntry cancelled;
+    if (!lp.wakeups.cancel(handle, cancelled)) { return false; }
+
+    LOG_TRACE(logger, "Kernel cancelled wakeup for agent " + std::to_string(sender) + " at time "
+    + cancelled.time().to_string());
+    return true;
+}
+
+bool Kernel::rescheduleWakeup(const int& sender, WakeupHandle handle, Timestamp requestedTime) {
+    LogicalProcess& lp = lpOf(sender);
+    const QueueEntry* pending = lp.wakeups.find(handle);
+    if (pending == nullptr || pending->recipientId != sender) { return false; }
+    requestedTime = checkWakeupTime(lp, requestedTime);
+
+    // A fresh sequence number, so the wakeup orders as if it had just been set.
+    if (!lp.wakeups.reschedule(handle, makeQueueKey(requestedTime, nextSeq(sender)))) { return false; }
+
+    LOG_TRACE(logger, "Kernel moved wakeup for agent " + std::to_string(sender) + " to time "
+    + requestedTime.to_string());
+    return true;
+}
+
+void Kernel::setEventLog(BinaryLogger* eventLog) {
+    this->eventLog = eventLog;
 }
 
 int Kernel::getAgentComputeDelay(const int& sender) {
@@ -328,6 +728,18 @@ void Kernel::setAgentComputeDelay(const int& sender, const int requestedDelay) {
     agentComputationDelays[sender] = requestedDelay;
 }
 
+void Kernel::writeLog(int sender, const EventLog& log, std::string filename) {
+    if (skip_log) { return; }
+
+    std::filesystem::path path = std::filesystem::path("log") / log_dir;
+    std::filesystem::create_directories(path);
+
+    if (filename.empty()) {
+        filename = "agent_" + std::to_string(sender);
+    }
+    log.writeTo((path / (filename + ".evlog")).string());
+}
+
 void Kernel::appendSummaryLog(int id, std::string eventType, LogEntry e) {
     // Implementation goes here (empty for now or left for future implementation)
 
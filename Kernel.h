@@ -1,39 +1,79 @@
 #pragma once
 #include "message/Message.h"
+#include "message/orders.h"
 #include "agents/Agent.h"
+#include "agents/AgentRegistry.h"
 #include <string>
-#include <queue>
+#include <memory>
 #include <iostream>
 #include <unordered_map>
 #include "util/oracles/Oracle.h"
+#include "util/queues/EventQueue.h"
+#include "util/queues/TimerWheel.h"
+#include "util/MessagePool.h"
+#include "util/BinaryLogger.h"
+#include "util/RandomStream.h"
+#include "util/model/LatencyModel.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
 
 class Agent;
 struct LogEntry;
 
-struct QueueEntry {
+struct BatchedEvent {
+    // One message drained by Kernel::processBatch.
+    QueueEntry entry;
+    int next = -1;          // Next message in the batch for the same batching agent.
+    bool done = false;
+};
 
-    Timestamp ts;
-    int senderId;
-    int recipientId;
-    const Message* msg;
-    
-    QueueEntry(Timestamp& ts, int senderId, int recipientId, const Message* msg) 
-    : ts(ts), senderId(senderId), recipientId(recipientId), msg(msg) {}
 
-    // Define operator< for priority comparison
-    bool operator<(const QueueEntry& other) const {
-        // Compare based on timestamp; this will determine the order in the priority queue.
-        return ts < other.ts;
+struct LogicalProcess {
+    /*
+    One partition of the agents, with its own pending event queue, message pool and
+    clock.  A sequential run has a single LP holding every agent; a parallel run (see
+    Kernel::setParallelism) gives each LP its own thread.
+    */
+    std::unique_ptr<EventQueue> messages;
+    // Pending wakeups, kept apart from messages so they can be cancelled or moved.
+    TimerWheel wakeups;
+    MessagePool messagePool;
+    Timestamp currentTime;
+    int currentAgentAdditionalDelay = 0;
+    int ttl_messages = 0;
+
+    // Events for agents of other LPs, handed over at the next window barrier.
+    std::vector<QueueEntry> outbox;
+    // Exclusive end (ns) of the window being processed; outbox events must not precede it.
+    int64_t windowEnd = INT64_MIN;
+
+    // Scratch space for processBatch, kept to avoid reallocating per timestamp.
+    std::vector<BatchedEvent> batch;
+    std::vector<DeliveredMessage> delivered;
+
+    bool empty() const {
+        return messages->empty() && wakeups.empty();
+    }
+
+    QueueKey nextKey() {
+        // Key of the earlier of the next message and the next wakeup; the LP must not be empty.
+        if (wakeups.empty()) { return messages->top().key; }
+        if (messages->empty()) { return wakeups.top().key; }
+        return std::min(messages->top().key, wakeups.top().key);
     }
 };
 
 class Kernel
 {
 private:
-    std::vector<Agent> agents;
+    // Not owned; the registry passed to runner() must outlive the run.
+    AgentRegistry* agents;
     // Member variable to store key-value pairs
     std::unordered_map<std::string, std::string> custom_state;
     bool skip_log;
+    std::string log_dir;
 
     std::vector<int> agentComputationDelays;
     std::vector<Timestamp> agentCurrentTimes;
@@ -41,15 +81,75 @@ private:
     int eventQueueWallClockStart;
     int eventQueueWallClockElapsed;
     int ttl_messages;
-    int currentAgentAdditionalDelay;
-    std::vector<std::vector<int> > agentLatency;
+
+    // Network latency between agents; a UniformLatencyModel of defaultLatency unless
+    // setLatencyModel() supplied one.
+    std::unique_ptr<LatencyModel> latencyModel;
+    bool customLatencyModel = false;
+
+    // Latency noise (and any model jitter) is drawn from one stream per sender, keyed by
+    // (seed, sender), so a sender's delays do not depend on what any other agent sent before.
+    std::vector<RandomStream> latencyNoise;
 
     Logger& logger;
 
+    EventQueueType queue_type;
+    int parallelism;
+
+    /* The logical processes of the current run and the LP each agent belongs to.  Each
+       LP owns the in-flight messages created by its agents until they are delivered. */
+    std::vector<std::unique_ptr<LogicalProcess>> lps;
+    std::vector<int> agentLP;
+
+    /* Per-agent tie-break sequence for queued events and next automatic order id; see
+       nextSeq() and dispatch(). */
+    std::vector<uint64_t> agentSendSeq;
+    std::vector<OrderId> agentNextOrderId;
+
+    /* Which agents take their messages in batches (Agent::receivesBatches), and per
+       agent the last batched message seen while draining a timestamp (-1 if none). */
+    std::vector<char> agentBatches;
+    bool anyBatchAgents = false;
+    std::vector<int> agentBatchTail;
+
+    /* Optional binary event log; not owned.  Each LP records as its own producer, and
+       each agent's records (and the kernel's own, as agent -1) are numbered in order. */
+    BinaryLogger* eventLog;
+    std::vector<uint64_t> agentLogSeq;
+    uint64_t kernelLogSeq = 0;
+
+    LogicalProcess& lpOf(int agent) { return *lps[agentLP[agent]]; }
+
+    uint64_t nextSeq(int sender) {
+        // Sender id in the top 24 bits, the sender's own event count below it.
+        return (static_cast<uint64_t>(sender) << 40) | agentSendSeq[sender]++;
+    }
+
+    void recordEvent(const Timestamp& time, int agent, LogEvent event, int64_t a = 0, int64_t b = 0) {
+        if (eventLog == nullptr) { return; }
+        if (agent < 0) {
+            eventLog->recordFrom(0, kernelLogSeq++, time, agent, event, a, b);
+        }
+        else {
+            eventLog->recordFrom(agentLP[agent], agentLogSeq[agent]++, time, agent, event, a, b);
+        }
+    }
+
+    template <typename F>
+    void dispatch(int id, F&& call);
+    void enqueue(LogicalProcess& lp, const QueueEntry& entry);
+    QueueEntry popNext(LogicalProcess& lp, WakeupHandle& wakeup);
+    void processEvent(LogicalProcess& lp, const QueueEntry& entry, WakeupHandle wakeup);
+    void processNext(LogicalProcess& lp);
+    void processBatch(LogicalProcess& lp);
+    void deliverBatch(LogicalProcess& lp, int first);
+    Timestamp checkWakeupTime(const LogicalProcess& lp, Timestamp requestedTime);
+    void runSequential(LogicalProcess& lp);
+    void runParallel(int64_t lookahead);
+
     void writeSummaryLog();
 
 public:
-    std::priority_queue<QueueEntry> messages;
     std::string kernel_name;
     std::string summaryLog[1000];
     std::unordered_map<std::string, int> meanResultByAgentType;
@@ -65,16 +165,39 @@ public:
     int num_stimulations;
     int defaultComputationalDelay;
 
-    Oracle oracle;
+    // The simulation's oracle, as passed to runner(); not owned.
+    Oracle* oracle = nullptr;
 
     Kernel(
         const std::string& kernel_name, 
         const int& random_state, 
-        Logger& logger
+        Logger& logger,
+        EventQueueType queue_type = EventQueueType::CALENDAR
         );
+    /* queue_type selects the pending event queue implementation.  The binary heap
+       is kept as a reference; the calendar queue is the default. */
+
+    void setLatencyModel(std::unique_ptr<LatencyModel> model);
+    /* Replaces the uniform defaultLatency with a latency model for subsequent runs (see
+       util/model/LatencyModel.h).  Pass nullptr to go back to the default. */
+
+    void setParallelism(int num_lps);
+    /* Number of logical processes (threads) the next runner() call spreads the agents
+       over, round-robin by id.  The default of 1 runs everything on the calling thread.
+
+       With more than one, LPs run conservatively synchronised windows (YAWNS): the
+       lookahead is the smallest latency between agents of different LPs, so no event
+       inside [earliest pending event, + lookahead) can be affected by any other LP and
+       every LP processes its share of the window concurrently.  The lookahead is taken
+       from the latency model's minLatency().  Each agent sees exactly
+       the same events in the same order as in a sequential run, and automatic order ids
+       are numbered per agent, (agent id << 32) | n, in every mode, so results are
+       identical for any number of LPs.
+       Agents must only interact through kernel messages, and should draw randomness from
+       their own stream (Agent::random).  Falls back to sequential if the lookahead is 0. */
 
     std::unordered_map<std::string, std::string> runner(
-        std::vector<Agent>& agents, 
+        AgentRegistry& agents, 
         int startTime, 
         int stopTime,
         int seed,
@@ -89,7 +212,7 @@ public:
     void sendMessage(
         const int& sender, 
         const int& recipient, 
-        const Message msg,
+        const Message* msg,
         int delay = 0
         );
     /* Called by an agent to send a message to another agent.  The kernel
@@ -99,20 +222,57 @@ public:
        The optional delay parameter represents an agent's request for ADDITIONAL
        delay (beyond the Kernel's mandatory computation + latency delays) to represent
        parallel pipeline processing delays (that should delay the transmission of messages
-       but do not make the agent "busy" and unable to respond to new messages). */
+       but do not make the agent "busy" and unable to respond to new messages).
+
+       msg must have been created by this kernel's message pools (see emplaceMessage).
+       The kernel takes ownership and recycles it once it has been delivered. */
+
+    template <typename T, typename... Args>
+    void emplaceMessage(const int& sender, const int& recipient, int delay, Args&&... args) {
+        sendMessage(sender, recipient, lpOf(sender).messagePool.create<T>(std::forward<Args>(args)...), delay);
+    }
+    /* Constructs a message of type T directly in the kernel's message pool and sends it. */
+
+    template <typename T, typename = std::enable_if_t<std::is_base_of<Message, std::decay_t<T>>::value>>
+    void sendMessage(const int& sender, const int& recipient, T&& msg, int delay = 0) {
+        sendMessage(sender, recipient, lpOf(sender).messagePool.create<std::decay_t<T>>(std::forward<T>(msg)), delay);
+    }
+    /* Moves (or copies, for lvalues) msg into the message pool with its full type and sends it. */
 
-    void setWakeup(const int& sender, Timestamp requestedTime);
+    WakeupHandle setWakeup(const int& sender, Timestamp requestedTime);
     /* Called by an agent to receive a "wakeup call" from the kernel
        at some requested future time.  Defaults to the next possible
        timestamp.  Wakeup time cannot be the current time or a past time.
        Sender is required and should be the ID of the agent making the call.
        The agent is responsible for maintaining any required state; the
-       kernel will not supply any parameters to the wakeup() call. */
+       kernel will not supply any parameters to the wakeup() call.
+       Returns a handle for cancelWakeup() and rescheduleWakeup(). */
+
+    bool cancelWakeup(const int& sender, WakeupHandle handle);
+    /* Cancels a pending wakeup set by sender.  Returns false if it has already fired,
+       was cancelled, is firing right now, or belongs to another agent. */
+
+    bool rescheduleWakeup(const int& sender, WakeupHandle handle, Timestamp requestedTime);
+    /* Moves a pending wakeup set by sender to requestedTime (with the same rules as
+       setWakeup), keeping its handle.  Returns false, leaving nothing scheduled, in the
+       cases where cancelWakeup() would. */
+
+    void setEventLog(BinaryLogger* eventLog);
+    /* Attaches an asynchronous binary log that receives one record per send, delivery,
+       wakeup and requeue.  Pass nullptr to detach.  The log must outlive the run and have
+       a producer per logical process (see setParallelism); its decoded records are the
+       same for any number of them. */
 
     int getAgentComputeDelay(const int& sender);
 
     void setAgentComputeDelay(const int& sender, const int requestedDelay);
 
+    void writeLog(int sender, const EventLog& log, std::string filename = "");
+    /* Called by any agent, usually at the very end of the simulation just before
+       kernel shutdown, to write to disk any log it has accumulated.  Files go to
+       log/<log_dir>/<filename or agent name>.evlog in the columnar EventLog format.
+       Does nothing if the kernel was run with skip_log. */
+
     void appendSummaryLog(int id, std::string eventType, LogEntry e);
 
     int findAgentByType(std::string type);
@@ -120,4 +280,17 @@ public:
        passed as "type".  For example, any ExchangeAgent, or any NasdaqExchangeAgent.
        This method is rather expensive, so the results should be cached by the caller! */
 
-};
\ No newline at end of file
+};
+
+
+/* Agent's templated send helpers need the complete Kernel. */
+
+template <typename T, typename>
+void Agent::sendMessage(int recipientID, T&& msg, int delay) {
+    kernel->sendMessage(id, recipientID, std::forward<T>(msg), delay);
+}
+
+template <typename T, typename... Args>
+void Agent::emplaceMessage(int recipientID, int delay, Args&&... args) {
+    kernel->emplaceMessage<T>(id, recipientID, delay, std::forward<Args>(args)...);
+}
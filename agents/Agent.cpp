@@ -1,8 +1,16 @@
 #include "../util/timestamping.h"
 #include "../Kernel.h"
 
-void Agent::setWakeup(Timestamp requestedTime) {
-    kernel->setWakeup(id, requestedTime);
+WakeupHandle Agent::setWakeup(Timestamp requestedTime) {
+    return kernel->setWakeup(id, requestedTime);
+}
+
+bool Agent::cancelWakeup(WakeupHandle handle) {
+    return kernel->cancelWakeup(id, handle);
+}
+
+bool Agent::rescheduleWakeup(WakeupHandle handle, Timestamp requestedTime) {
+    return kernel->rescheduleWakeup(id, handle, requestedTime);
 }
 
 int Agent::getComputationDelay() {
@@ -13,21 +21,39 @@ void Agent::setComputationDelay(const int& requestedDelay) {
     kernel->setAgentComputeDelay(id, requestedDelay);
 }
 
-void Agent::sendMessage(int recipientID, Message msg, int delay) {
-    kernel->sendMessage(id, recipientID, msg, delay = delay);
+void Agent::sendMessage(int recipientID, const Message* msg, int delay) {
+    kernel->sendMessage(id, recipientID, msg, delay);
 }
 
 void Agent::logEvent(std::string eventType, std::string event, bool appendSummaryLog) {
-    LogEntry e;
-    e.event = event;
-    e.eventTime = currentTime;
-    e.eventType = eventType;
-    log.push_back(e);
+    logEvent(EventTypes::intern(eventType), std::move(event), appendSummaryLog);
+}
+
+void Agent::logEvent(EventType eventType, std::string event, bool appendSummaryLog) {
+    if (appendSummaryLog) {
+        LogEntry e;
+        e.event = event;
+        e.eventTime = currentTime;
+        e.eventType = EventTypes::name(eventType);
+        kernel->appendSummaryLog(id, e.eventType, e);
+    }
+
+    log.appendText(currentTime, eventType, std::move(event));
+}
+
+void Agent::kernelTerminating() {
+    if (!log.empty() && logToFile) {
+        kernel->writeLog(id, log);
+    }
+}
 
-    if (appendSummaryLog) { kernel->appendSummaryLog(id, eventType, e); }
+void Agent::receiveMessages(const Timestamp new_currentTime, MessageBatch messages) {
+    for (const DeliveredMessage& delivered : messages) {
+        receiveMessage(new_currentTime, delivered.senderId, delivered.message);
+    }
 }
 
 void Agent::receiveMessage(const Timestamp new_currentTime, int senderId, const Message* message) {
     currentTime = new_currentTime;
-    logger->log("At " + new_currentTime.to_string() + ", agent " + std::to_string(id) + name.value() + " received: " + message->getName());
+    LOG_TRACE(*logger, "At " + new_currentTime.to_string() + ", agent " + std::to_string(id) + name.value() + " received: " + message->getName());
     }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once
 #include "../util/logger.h"
+#include "../util/timestamping.h"
+#include "../message/Message.h"
+#include "../util/EventLog.h"
+#include "../util/RandomStream.h"
+#include "../util/queues/TimerWheel.h"
+#include <cstddef>
 #include <vector>
 #include <optional>
+#include <type_traits>
 
 class Kernel;
-class Message;
 
 struct LogEntry {
     Timestamp eventTime;
@@ -28,11 +34,37 @@ inline void writeVectorToFile(const std::vector<int>& vec, const std::string& fi
     outFile.close();
 }
 
+struct DeliveredMessage {
+    int senderId;
+    const Message* message;
+};
+
+
+class MessageBatch {
+    /*
+    The messages delivered to one agent at one timestamp, in delivery order.  A view
+    into Kernel storage: valid only for the duration of the receiveMessages() call.
+    */
+
+    const DeliveredMessage* first;
+    std::size_t count;
+
+public:
+    MessageBatch(const DeliveredMessage* first, std::size_t count) : first(first), count(count) {}
+
+    const DeliveredMessage* begin() const { return first; }
+    const DeliveredMessage* end() const { return first + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const DeliveredMessage& operator[](std::size_t i) const { return first[i]; }
+};
+
+
 class Agent {
 private:
     int random_state;
     bool logToFile;
-    std::vector<LogEntry> log;
+    EventLog log;
 
 protected:
     Kernel* kernel;
@@ -41,6 +73,10 @@ protected:
     std::optional<std::string> name;
     std::optional<std::string> type;
 
+    // This agent's own random stream, keyed by (random_state, id): reproducible for a
+    // given random_state, independent of every other agent's draws and of threading.
+    RandomStream random;
+
 public:
     Logger* logger;
     
@@ -52,22 +88,30 @@ public:
         Logger& logger, 
         const bool& logToFile)
     : id(id), name(name), type(type), random_state(random_state), 
+      random(static_cast<uint32_t>(random_state), static_cast<uint32_t>(id)),
       logger(&logger), logToFile(logToFile) {}
 
+    virtual ~Agent() = default;
+
+    int getId() const { return id; }
+
+    const Timestamp& getCurrentTime() const { return currentTime; }
+
     // Flow of required kernel listening methods:
     // init -> start -> (entire simulation) -> end -> terminate
+    // All are virtual: the Kernel only ever sees agents through Agent&.
 
-    void kernelInitialising(Kernel& kernel) {
+    virtual void kernelInitialising(Kernel& kernel) {
     /*  Called by kernel one time when simulation first begins.
         No other agents are guaranteed to exist at this time.
 
         Kernel reference must be retained, as this is the only time the
         agent can "see" it. */
         this->kernel = &kernel;
-        logger->log("Agent " + std::to_string(id) + " initialising.");
+        LOG_DEBUG(*logger, "Agent " + std::to_string(id) + " initialising.");
     }
 
-    void kernelStarting(Timestamp startTime) {
+    virtual void kernelStarting(Timestamp startTime) {
     /*  Called by kernel one time _after_ simulationInitializing.
         All other agents are guaranteed to exist at this time.
         startTime is the earliest time for which the agent can
@@ -78,49 +122,60 @@ public:
         setWakeup(startTime);
     }
     
-    void wakeup(const Timestamp new_currentTime) {
+    virtual void wakeup(const Timestamp new_currentTime) {
     /*  Agents can request a wakeup call at a future simulation time using
         Agent.setWakeup().  This is the method called when the wakeup time
         arrives. */
 
         currentTime = new_currentTime;
-        logger->log("At " + currentTime.to_string() + " agent " + std::to_string(id) +
+        LOG_TRACE(*logger, "At " + currentTime.to_string() + " agent " + std::to_string(id) +
                     name.value() + " received wakeup.");
     }
 
-    void receiveMessage(const Timestamp new_currentTime, int senderId, const Message* message);
+    virtual void receiveMessage(const Timestamp new_currentTime, int senderId, const Message* message);
     /* Called each time a message destined for this agent reaches
        the front of the kernel's priority queue. currentTime is
        the simulation time at which the kernel is delivering this
        message -- the agent should treat this as "now". msg is
-       an object guaranteed to inherit from the message.Message class. */
+       an object guaranteed to inherit from the message.Message class.
+       The message is recycled by the kernel when this call returns, so
+       copy out anything that must be retained. */
+
+    virtual bool receivesBatches() const { return false; }
+    /* Agents that return true get every message the kernel delivers to them at one
+       timestamp in a single receiveMessages() call instead of one receiveMessage() call
+       each, and are charged their computation delay once for the whole batch.  Queried
+       once per run. */
+
+    virtual void receiveMessages(const Timestamp new_currentTime, MessageBatch messages);
+    /* Called instead of receiveMessage() for agents that receivesBatches(), with all of
+       their messages due at new_currentTime.  Lets an agent amortise per-message work
+       (e.g. update state once per burst).  The default hands each message to
+       receiveMessage() in turn.  As with receiveMessage(), the messages are recycled when
+       this call returns. */
 
 
-    void kernelStopping(){
+    virtual void kernelStopping() {
     /* Called by kernel one time _before_ simulationTerminating.
         All other agents are guaranteed to exist at this time. */
     }
 
-    void kernelTerminating() {
-        std::cout << "KernelTerminating" << std::endl;
-    }
-    // /* Called by kernel one time when simulation terminates.
-    //    No other agents are guaranteed to exist at this time. */
+    virtual void kernelTerminating();
+    /* Called by kernel one time when simulation terminates.
+       No other agents are guaranteed to exist at this time.
 
-    // // If this agent has been maintaining a log, convert it to a Dataframe
-    // // and request that the Kernel write it to disk before terminating.
-    // if (log) && (log_to_file) {
-    //     writeVectorToFile()
-    // }
+       If this agent has been maintaining a log, request that the
+       Kernel write it to disk before terminating. */
 
+    
+    WakeupHandle setWakeup(Timestamp requestedTime);
 
-    //     dfLog = pd.DataFrame(self.log);
-    //     dfLog.set_index('EventTime', inplace=True);
-    //     self.writeLog(dfLog);
-    // }; 
+    bool cancelWakeup(WakeupHandle handle);
+    /* Cancels a wakeup set earlier; false if it already fired (or is firing now). */
 
-    
-    void setWakeup(Timestamp requestedTime);
+    bool rescheduleWakeup(WakeupHandle handle, Timestamp requestedTime);
+    /* Moves a pending wakeup to requestedTime; false, with nothing scheduled, if it
+       already fired.  Cheaper than a cancel and a new setWakeup(). */
 
     int getComputationDelay();
 
@@ -133,7 +188,30 @@ public:
        
        We can make a single copy of the object (in case it is an arbitrary
        class instance) for both potential log targets, because we don't
-       alter logs once recorded. */
+       alter logs once recorded.
+
+       The event type is interned on every call, which takes a process-wide
+       lock; prefer the overloads below, with the type interned once. */
+
+    void logEvent(EventType eventType, std::string event, bool appendSummaryLog = false);
+    /* As above, for a type interned once with EventTypes::intern(). */
+
+    void logEvent(EventType eventType, int64_t v0 = 0, int64_t v1 = 0, int64_t v2 = 0) {
+        log.append(currentTime, eventType, v0, v1, v2);
+    }
+    /* Adds a numeric event to this agent's log without formatting anything.
+       The meaning of v0..v2 is defined by the event type, e.g. for BEST_BID
+       (price, quantity).  Intern the type once with EventTypes::intern(). */
+
+    void sendMessage(int recipientID, const Message* msg, int delay = 0);
+    /* Sends a message created by the kernel's message pool; ownership passes to the kernel. */
+
+    template <typename T, typename = std::enable_if_t<std::is_base_of<Message, std::decay_t<T>>::value>>
+    void sendMessage(int recipientID, T&& msg, int delay = 0);
+    /* Sends msg with its full type (no slicing), moving it into the kernel's message pool. */
 
-    void sendMessage(int recipientID, Message msg, int delay = 0);
+    template <typename T, typename... Args>
+    void emplaceMessage(int recipientID, int delay, Args&&... args);
+    /* Constructs a T in place in the kernel's message pool and sends it, without any copy.
+       Defined in Kernel.h. */
 };
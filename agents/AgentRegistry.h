@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Agent.h"
+
+class AgentRegistry {
+    /*
+    Owns the heterogeneous agents of a simulation and indexes them by agent id.
+
+    Agents are constructed in place, never copied, so subclasses keep their full type and
+    the Kernel reaches them through Agent's virtual interface.  Storage is grouped by
+    concrete type: each type gets its own arena of fixed-size chunks, so agents of the
+    same type sit next to each other in memory (and never move once created), which keeps
+    bursts of same-type wakeups cache friendly.  The id index is a flat vector of
+    pointers into those arenas.
+
+    Agent ids must be unique and, by the time the Kernel runs, dense from 0.
+    */
+
+    struct ArenaBase {
+        virtual ~ArenaBase() = default;
+    };
+
+    template <typename T>
+    struct Arena : ArenaBase {
+        static constexpr std::size_t CHUNK = 64;
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+        std::vector<std::unique_ptr<Slot[]>> chunks;
+        std::size_t count = 0;
+
+        template <typename... Args>
+        T* emplace(Args&&... args) {
+            if (count == chunks.size() * CHUNK) {
+                chunks.emplace_back(new Slot[CHUNK]);
+            }
+            Slot* slot = &chunks[count / CHUNK][count % CHUNK];
+            T* agent = ::new (static_cast<void*>(slot)) T(std::forward<Args>(args)...);
+            count++;
+            return agent;
+        }
+
+        ~Arena() override {
+            for (std::size_t i = 0; i < count; i++) {
+                std::launder(reinterpret_cast<T*>(&chunks[i / CHUNK][i % CHUNK]))->~T();
+            }
+        }
+    };
+
+    // Arenas in order of first use, so destruction order is deterministic.
+    std::vector<std::unique_ptr<ArenaBase>> arenas;
+    std::unordered_map<std::type_index, ArenaBase*> arena_by_type;
+    std::vector<Agent*> by_id;
+
+    template <typename T>
+    Arena<T>& arenaFor() {
+        auto it = arena_by_type.find(std::type_index(typeid(T)));
+        if (it != arena_by_type.end()) {
+            return *static_cast<Arena<T>*>(it->second);
+        }
+        arenas.emplace_back(new Arena<T>());
+        Arena<T>* arena = static_cast<Arena<T>*>(arenas.back().get());
+        arena_by_type.emplace(std::type_index(typeid(T)), arena);
+        return *arena;
+    }
+
+public:
+    AgentRegistry() = default;
+    AgentRegistry(const AgentRegistry&) = delete;
+    AgentRegistry& operator=(const AgentRegistry&) = delete;
+
+    template <typename T, typename... Args>
+    T& add(int id, Args&&... args) {
+        /*
+        Constructs an agent of type T, as T(id, args...), in the registry and indexes it
+        under id.  Throws, before anything is constructed, if id is negative or another
+        agent already holds it.
+        */
+        static_assert(std::is_base_of<Agent, T>::value, "AgentRegistry only holds Agent subclasses.");
+
+        if (id < 0) {
+            throw std::invalid_argument("Agent ids must be non-negative, got " + std::to_string(id));
+        }
+        if (static_cast<std::size_t>(id) < by_id.size() && by_id[id] != nullptr) {
+            throw std::invalid_argument("Duplicate agent id " + std::to_string(id));
+        }
+
+        T* agent = arenaFor<T>().emplace(id, std::forward<Args>(args)...);
+        if (static_cast<std::size_t>(id) >= by_id.size()) {
+            by_id.resize(id + 1, nullptr);
+        }
+        by_id[id] = agent;
+        return *agent;
+    }
+
+    Agent& get(int id) {
+        return *by_id[id];
+    }
+
+    const Agent& get(int id) const {
+        return *by_id[id];
+    }
+
+    std::size_t size() const {
+        return by_id.size();
+    }
+
+    void validate() const {
+        /*
+        Throws unless every id in [0, size()) is held by an agent.
+        */
+        for (std::size_t id = 0; id < by_id.size(); id++) {
+            if (by_id[id] == nullptr) {
+                throw std::runtime_error("Agent ids must be dense from 0; missing id " + std::to_string(id));
+            }
+        }
+    }
+};
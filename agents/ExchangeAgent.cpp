@@ -1,6 +1,9 @@
 #include "../util/timestamping.h"
 #include "ExchangeAgent.h"
+#include "../message/market_data.h"
 #include "../message/orders.h"
+#include "../Kernel.h"
+#include "../util/OrderBook.h"
 
 ExchangeAgent::ExchangeAgent(
     int id, 
@@ -18,7 +21,7 @@ ExchangeAgent::ExchangeAgent(
     bool log_orders,
     int random_state,
     bool use_metric_tracker
-    ) : FinancialAgent(id, name, type, random_state, logger), symbols(symbols),
+    ) : FinancialAgent(id, name, type, random_state, logger),
       // Store this exchange's open and close times.
       mkt_open(mkt_open), mkt_close(mkt_close),  
 
@@ -40,30 +43,74 @@ ExchangeAgent::ExchangeAgent(
         // Do not request repeated wakeup calls.
         reschedule = false;
 
+        // Symbols are interned here, once; everything downstream is keyed by SymbolId.
+        for (const std::string& symbol : symbols) {
+            this->symbols.push_back(SymbolTable::intern(symbol));
+        }
+
+        std::size_t n_symbols = SymbolTable::size();
+        order_books.resize(n_symbols);
+        metric_trackers.resize(n_symbols);
+        data_subscriptions.resize(n_symbols);
+
         // Create an order book for each symbol.
-        
+        for (SymbolId symbol : this->symbols) {
+            order_books[symbol] = std::make_unique<OrderBook>(*this, symbol);
+
+            if (use_metric_tracker) {
+                // Create a metric tracker for each symbol.
+                metric_trackers[symbol].emplace();
+            }
+        }
+}
 
+ExchangeAgent::~ExchangeAgent() = default;
 
-    # Create an order book for each symbol.
-    self.order_books: Dict[str, OrderBook] = {
-        symbol: OrderBook(self, symbol) for symbol in symbols
-    }
+OrderBook* ExchangeAgent::getOrderBook(SymbolId symbol) {
+    return symbol < order_books.size() ? order_books[symbol].get() : nullptr;
+}
+
+
+void ExchangeAgent::publishOrderBookData(SymbolId symbol) {
+    OrderBook* book = getOrderBook(symbol);
+    if (book == nullptr) { return; }
 
-    if use_metric_tracker:
-        # Create a metric tracker for each symbol.
-        self.metric_trackers: Dict[str, ExchangeAgent.MetricTracker] = {
-            symbol: self.MetricTracker() for symbol in symbols
+    Timestamp now = getCurrentTime();
+    int last_trade = book->getLastTrade();
+
+    for (std::unique_ptr<BaseDataSubscription>& subscription : data_subscriptions[symbol]) {
+        if (subscription->type != BaseDataSubscription::Type::L1
+            && subscription->type != BaseDataSubscription::Type::L2
+            && subscription->type != BaseDataSubscription::Type::L3) {
+            continue;
         }
 
-    # The subscription dict is a dictionary with the key = agent ID,
-    # value = dict (key = symbol, value = list [levels (no of levels to recieve updates for),
-    # frequency (min number of ns between messages), last agent update timestamp]
-    # e.g. {101 : {'AAPL' : [1, 10, NanosecondTime(10:00:00)}}
-    self.data_subscriptions: DefaultDict[
-        str, List[ExchangeAgent.BaseDataSubscription]
-    ] = defaultdict(list)
-
-    # Store a list of agents who have requested market close price information.
-    # (this is most likely all agents)
-    self.market_close_price_subscriptions: List[int] = []
-    }
\ No newline at end of file
+        FrequencyBasedSubscription& sub = static_cast<FrequencyBasedSubscription&>(*subscription);
+        if (now.to_nanoseconds() - sub.last_update_ts.to_nanoseconds() < sub.freq) { continue; }
+        sub.last_update_ts = now;
+
+        switch (sub.type) {
+        case BaseDataSubscription::Type::L1: {
+            // An empty side is reported as (0, 0).
+            std::pair<int, int> bid = book->getL1BidData().value_or(std::make_pair(0, 0));
+            std::pair<int, int> ask = book->getL1AskData().value_or(std::make_pair(0, 0));
+            int bid_data[2] = {bid.first, bid.second};
+            int ask_data[2] = {ask.first, ask.second};
+            emplaceMessage<L1DataMsg>(sub.agent_id, 0, symbol, last_trade, now, bid_data, ask_data);
+            break;
+        }
+        case BaseDataSubscription::Type::L2: {
+            std::size_t depth = static_cast<std::size_t>(static_cast<L2DataSubscription&>(sub).depth);
+            emplaceMessage<L2DataMsg>(sub.agent_id, 0, symbol, last_trade, now, book->getL2Snapshot(depth));
+            break;
+        }
+        case BaseDataSubscription::Type::L3: {
+            std::size_t depth = static_cast<std::size_t>(static_cast<L3DataSubscription&>(sub).depth);
+            emplaceMessage<L3DataMsg>(sub.agent_id, 0, symbol, last_trade, now, book->getL3Snapshot(depth));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
@@ -1,9 +1,12 @@
 #pragma once
+#include <memory>
 #include <optional>
 #include "FinancialAgent.h"
+#include "../message/orders.h"
+#include "../util/SymbolTable.h"
 #include <vector>
 
-struct Side;
+class OrderBook;
 
 class ExchangeAgent : public FinancialAgent {
     /*
@@ -40,16 +43,22 @@ class ExchangeAgent : public FinancialAgent {
         }
     };
 
+protected:
     struct BaseDataSubscription {
         /*
-        Base class for all types of data subscription registered with this agent.
+        Base class for all types of data subscription registered with this agent.  `type`
+        names the concrete subscription, so publishing can switch on it without RTTI.
         */
+        enum class Type : uint8_t { L1, L2, L3, TRANSACTED_VOL, BOOK_IMBALANCE };
 
+        Type type;
         int agent_id;
         Timestamp last_update_ts;
 
-        BaseDataSubscription(int agent_id, Timestamp last_update_ts) 
-        : agent_id(agent_id), last_update_ts(last_update_ts) {}
+        BaseDataSubscription(Type type, int agent_id, Timestamp last_update_ts) 
+        : type(type), agent_id(agent_id), last_update_ts(last_update_ts) {}
+
+        virtual ~BaseDataSubscription() = default;
     };
 
 
@@ -60,14 +69,14 @@ class ExchangeAgent : public FinancialAgent {
         */
         int freq;
 
-        FrequencyBasedSubscription(int agent_id, Timestamp last_update_ts, int freq) 
-        : BaseDataSubscription(agent_id, last_update_ts), freq(freq) {}
+        FrequencyBasedSubscription(Type type, int agent_id, Timestamp last_update_ts, int freq) 
+        : BaseDataSubscription(type, agent_id, last_update_ts), freq(freq) {}
     };
 
 
     struct L1DataSubscription : public FrequencyBasedSubscription {
         L1DataSubscription(int agent_id, Timestamp last_update_ts, int freq)
-        : FrequencyBasedSubscription(agent_id, last_update_ts, freq) {}
+        : FrequencyBasedSubscription(Type::L1, agent_id, last_update_ts, freq) {}
     };
 
 
@@ -75,7 +84,7 @@ class ExchangeAgent : public FinancialAgent {
         int depth;
 
         L2DataSubscription(int agent_id, Timestamp last_update_ts, int freq, int depth)
-        : FrequencyBasedSubscription(agent_id, last_update_ts, freq), depth(depth) {}
+        : FrequencyBasedSubscription(Type::L2, agent_id, last_update_ts, freq), depth(depth) {}
     };
 
 
@@ -83,7 +92,7 @@ class ExchangeAgent : public FinancialAgent {
         int depth;
 
         L3DataSubscription(int agent_id, Timestamp last_update_ts, int freq, int depth)
-        : FrequencyBasedSubscription(agent_id, last_update_ts, freq), depth(depth) {}
+        : FrequencyBasedSubscription(Type::L3, agent_id, last_update_ts, freq), depth(depth) {}
     };
 
 
@@ -91,7 +100,7 @@ class ExchangeAgent : public FinancialAgent {
         std::string lookback;
 
         TransactedVolDataSubscription(int agent_id, Timestamp last_update_ts, int freq, int depth, std::string lookback)
-        : FrequencyBasedSubscription(agent_id, last_update_ts, freq), lookback(lookback) {}
+        : FrequencyBasedSubscription(Type::TRANSACTED_VOL, agent_id, last_update_ts, freq), lookback(lookback) {}
     };
 
 
@@ -102,8 +111,8 @@ class ExchangeAgent : public FinancialAgent {
         */
         bool event_in_progress;
 
-        EventBasedSubscription(int agent_id, Timestamp last_update_ts, bool event_in_progress)
-        : BaseDataSubscription(agent_id, last_update_ts), event_in_progress(event_in_progress) {}
+        EventBasedSubscription(Type type, int agent_id, Timestamp last_update_ts, bool event_in_progress)
+        : BaseDataSubscription(type, agent_id, last_update_ts), event_in_progress(event_in_progress) {}
     };
 
 
@@ -122,12 +131,16 @@ class ExchangeAgent : public FinancialAgent {
             float min_imbalance, 
             std::optional<float> imbalance = std::nullopt,
             std::optional<Side> side = std::nullopt
-            ) : EventBasedSubscription(agent_id, last_update_ts, event_in_progress),
+            ) : EventBasedSubscription(Type::BOOK_IMBALANCE, agent_id, last_update_ts, event_in_progress),
                 min_imbalance(min_imbalance), imbalance(imbalance), side(side) {}
     };
 
+    // Subscriptions registered with this exchange, per symbol.
+    std::vector<std::vector<std::unique_ptr<BaseDataSubscription>>> data_subscriptions;
+
+private:
     bool reschedule;
-    std::vector<std::string> symbols;
+    std::vector<SymbolId> symbols;
     Timestamp mkt_close;
     int pipeline_delay;
     int computational_delay;
@@ -136,6 +149,14 @@ class ExchangeAgent : public FinancialAgent {
     bool log_orders;
     int stream_history;
 
+    /* Per-symbol state is indexed directly by SymbolId; entries for symbols this
+       exchange does not trade are empty. */
+    std::vector<std::unique_ptr<OrderBook>> order_books;
+    std::vector<std::optional<MetricTracker>> metric_trackers;
+
+    // Agents who have requested market close price information (most likely all agents).
+    std::vector<int> market_close_price_subscriptions;
+
 public:
     Timestamp mkt_open;
 
@@ -156,4 +177,21 @@ public:
         int random_state = -1,
         bool use_metric_tracker = true
         );
+
+    ~ExchangeAgent() override;
+
+    OrderBook* getOrderBook(SymbolId symbol);
+    /*
+    Returns the order book for the symbol, or nullptr if this exchange does not trade it.
+    */
+
+    void publishOrderBookData(SymbolId symbol);
+    /*
+    Sends L1, L2 and L3 data to each subscriber of the symbol whose update frequency has
+    elapsed since its last update.  Call it after the book changes.
+
+    L2 and L3 subscribers are sent the book's shared snapshot for their depth (see
+    OrderBook::getL2Snapshot), so hundreds of subscribers at one depth cost one
+    incremental snapshot build and a reference each, not a copy of the book each.
+    */
 };
\ No newline at end of file
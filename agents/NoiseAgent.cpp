@@ -1,6 +1,7 @@
 #include "NoiseAgent.h"
 #include "../util/util.h"
 #include "../Kernel.h"
+#include "../message/MessageDispatch.h"
 #include "../message/orders.h"
 
 NoiseAgent::NoiseAgent(
@@ -15,7 +16,7 @@ NoiseAgent::NoiseAgent(
         std::string type,
         int random_state
     ) : TradingAgent(id, name, type, random_state, logger, starting_cash, log_orders),
-        wakeup_time(wakeup_time), symbol(symbol), order_size_model(order_size_model) {
+        wakeup_time(wakeup_time), symbol(SymbolTable::intern(symbol)), order_size_model(order_size_model) {
 
         // The agent uses this to track whether it has begun its strategy or is still
         // handling pre-market tasks.
@@ -29,7 +30,7 @@ NoiseAgent::NoiseAgent(
         // units have passed.
         prev_wake_time = Timestamp();
 
-        size = genRandInt(20, 50);
+        size = random.uniformInt(20, 49);
 }
 
 void NoiseAgent::kernelStarting(Timestamp startTime) {
@@ -44,6 +45,8 @@ void NoiseAgent::kernelStopping() {
     // Always call parent method to be safe.
     TradingAgent::kernelStopping();
 
+    static const EventType FINAL_VALUATION = EventTypes::intern("FINAL_VALUATION");
+
     // Fix the problem of logging an agent that has not waken up.
     try {
         // Attempt to get bid/ask values
@@ -57,9 +60,15 @@ void NoiseAgent::kernelStopping() {
         if (bid != -1 and ask != -1) {
             rT = int(bid + ask) / 2;
         }
+        else if (last_trade.find(symbol) != last_trade.end()) {
+            rT = last_trade[symbol];
+        }
+        else if (oracle != nullptr) {
+            // No price seen at all: value the holdings at the fundamental.
+            rT = oracle->observePrice(symbol, getCurrentTime(), 0, random, oracle_cursor);
+        }
         else {
-            auto it = last_trade.find(symbol);
-            rT = it->second;
+            throw std::out_of_range("No price known for " + SymbolTable::name(symbol));
         }
 
         // Final (real) fundamental value times shares held.
@@ -68,19 +77,19 @@ void NoiseAgent::kernelStopping() {
         logger->log("Surplus after holdings: " + std::to_string(surplus));
 
         // Add ending cash value and subtract starting cash value.
-        surplus += holdings["CASH"] - starting_cash;
+        surplus += holdings[SymbolTable::CASH] - starting_cash;
         surplus = surplus / starting_cash;
 
-        logEvent("FINAL_VALUATION", std::to_string(surplus), true);
+        logEvent(FINAL_VALUATION, std::to_string(surplus), true);
 
         logger->log(
-            name + "final report. Holdings: " + std::to_string(H) + ", end cash: " + std::to_string(holdings["CASH"])
+            name.value_or("") + "final report. Holdings: " + std::to_string(H) + ", end cash: " + std::to_string(holdings[SymbolTable::CASH])
             + ", start cash: " + std::to_string(starting_cash) + ", final fundamental: " 
             + std::to_string(rT) + ", surplus: " + std::to_string(surplus)
         );
     }
     catch (const std::out_of_range& e) {
-        logEvent("FINAL_VALUATION", std::to_string(starting_cash), true);
+        logEvent(FINAL_VALUATION, std::to_string(starting_cash), true);
     }
 }
     
@@ -97,7 +106,7 @@ void NoiseAgent::wakeup(Timestamp currentTime) {
                 trading = true;
 
                 // Time to start trading!
-                logger->log(name + " is ready to start trading now.");
+                logger->log(name.value_or("") + " is ready to start trading now.");
             }
         }
 
@@ -132,7 +141,7 @@ void NoiseAgent::wakeup(Timestamp currentTime) {
     
 void NoiseAgent::placeOrder() {
     // Place order in random direction at mid.
-    int buy_indicator = genRandInt(0,2);
+    int buy_indicator = random.uniformInt(0, 1);
 
     auto [bid, bid_vol, ask, ask_vol] = getKnownBidAsk(symbol);
 
@@ -150,34 +159,41 @@ void NoiseAgent::placeOrder() {
     }
 }
     
-void NoiseAgent::receiveMessage(Timestamp currentTime, int sender_id, Message& message) {
+struct NoiseAgent::MessageHandler {
+    NoiseAgent& agent;
+
+    void handle(const QuerySpreadResponseMsg&) {
+        if (agent.state != "AWAITING_SPREAD") {
+            return;
+        }
+        // We were waiting to receive the current spread/book.  Since we don't currently
+        // track timestamps on retained information, we rely on actually seeing a
+        // QUERY_SPREAD response message.  This is what we were waiting for.
+
+        // But if the market is now closed, don't advance to placing orders.
+        if (agent.mkt_closed) {
+            return;
+        }
+        // We now have the information needed to place a limit order with the eta
+        // strategic threshold parameter.
+        agent.placeOrder();
+        agent.state = "AWAITING_WAKEUP";
+    }
+
+    void handle(const Message&) {}
+};
+
+void NoiseAgent::receiveMessage(Timestamp currentTime, int sender_id, const Message* message) {
         // Parent class schedules market open wakeup call once market open/close times are known.
         TradingAgent::receiveMessage(currentTime, sender_id, message);
 
         // We have been awakened by something other than our scheduled wakeup.
         // If our internal state indicates we were waiting for a particular event,
         // check if we can transition to a new state.
-
-        if (state == "AWAITING_SPREAD") {
-            // We were waiting to receive the current spread/book.  Since we don't currently
-            // track timestamps on retained information, we rely on actually seeing a
-            // QUERY_SPREAD response message.
-
-            if (message.getName() == "QuerySpreadResponseMsg") {
-                // This is what we were waiting for.
-
-                // But if the market is now closed, don't advance to placing orders.
-                if (mkt_closed) {
-                    return;
-                }
-                // We now have the information needed to place a limit order with the eta
-                // strategic threshold parameter.
-                placeOrder();
-                state = "AWAITING_WAKEUP";
-            }
-        }
+        MessageHandler handler{*this};
+        dispatchMessage(handler, *message);
 }
 // Internal state and logic specific to this agent subclass.
 Timestamp NoiseAgent::getWakeFrequency() {
-        return Timestamp(genRandInt(0, 100));
+        return Timestamp(random.uniformInt(0, 99));
 }
\ No newline at end of file
@@ -13,7 +13,7 @@ class NoiseAgent : public TradingAgent {
 */
 
 private:
-    std::string symbol;
+    SymbolId symbol;
     bool order_size_model;   // Not implemented yet.
     Timestamp wakeup_time;
 
@@ -21,7 +21,8 @@ private:
     std::string state;
     Timestamp prev_wake_time;
     int size;
-    Oracle oracle;
+    Oracle* oracle = nullptr;
+    OracleCursor oracle_cursor;     // This agent's place in the oracle's series for `symbol`.
 
 public:
     NoiseAgent(
@@ -37,11 +38,11 @@ public:
         int random_state = 1
     );
 
-    void kernelStarting(Timestamp startTime);
+    void kernelStarting(Timestamp startTime) override;
     
-    void kernelStopping();
+    void kernelStopping() override;
         
-    void wakeup(Timestamp currentTime);
+    void wakeup(Timestamp currentTime) override;
     /*
         Arguments:
             current_time: The time that this agent was woken up by the kernel.
@@ -54,9 +55,11 @@ public:
         
     void placeOrder();
      
-    void receiveMessage(Timestamp current_time, int sender_id, Message& message);
+    void receiveMessage(Timestamp current_time, int sender_id, const Message* message) override;
       
     Timestamp getWakeFrequency();
 
-      
+private:
+    struct MessageHandler;
+    // Handles the messages NoiseAgent reacts to (see receiveMessage), through dispatchMessage.
 };
\ No newline at end of file
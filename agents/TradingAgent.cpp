@@ -1,8 +1,9 @@
 #include "TradingAgent.h"
 #include <limits>
-#include "../kernel.h"
+#include "../Kernel.h"
 #include "ExchangeAgent.h"
 #include "../message/market.h"
+#include "../message/MessageDispatch.h"
 #include "../message/query.h"
 #include "../message/orders.h"
 
@@ -29,7 +30,7 @@ TradingAgent::TradingAgent(
             Holdings is a dictionary of symbol -> shares.  CASH is a special symbol
             worth one cent per share.  Orders is a dictionary of active, open orders
             (not cancelled, not fully executed) keyed by order_id. */
-        holdings["CASH"] = starting_cash;
+        holdings[SymbolTable::CASH] = starting_cash;
         
         nav_diff = 0;
         basket_size = 0;
@@ -44,9 +45,10 @@ TradingAgent::TradingAgent(
         mkt_closed = false;
 }
 
-void TradingAgent::kernelStarting(const Timestamp& startTime) {
+void TradingAgent::kernelStarting(Timestamp startTime) {
     // kernel is set in Agent.kernelInitializing().
-    logEvent("STARTING_CASH", std::to_string(starting_cash), true);
+    static const EventType STARTING_CASH = EventTypes::intern("STARTING_CASH");
+    logEvent(STARTING_CASH, std::to_string(starting_cash), true);
 
     /* Find an exchange with which we can place orders.  It is guaranteed
        to exist by now (if there is one). */
@@ -63,18 +65,22 @@ void TradingAgent::kernelStopping() {
     // Always call parent method to be safe.
     Agent::kernelStopping();
 
+    static const EventType FINAL_HOLDINGS = EventTypes::intern("FINAL_HOLDINGS");
+    static const EventType FINAL_CASH_POSITION = EventTypes::intern("FINAL_CASH_POSITION");
+    static const EventType ENDING_CASH = EventTypes::intern("ENDING_CASH");
+
     // Print end of day holdings.
-    logEvent("FINAL_HOLDINGS", fmtHoldings(holdings));
-    logEvent("FINAL_CASH_POSITION", std::to_string(holdings["CASH"]), true);
+    logEvent(FINAL_HOLDINGS, fmtHoldings(holdings));
+    logEvent(FINAL_CASH_POSITION, std::to_string(holdings[SymbolTable::CASH]), true);
 
     // Mark to market.
     cash = markToMarket(holdings);
 
-    logEvent("ENDING_CASH", std::to_string(cash), true);
-    std::cout << "Final holdings for" << name << ": " << fmtHoldings(holdings) <<  " Marked to market: " << cash << std::endl;
+    logEvent(ENDING_CASH, std::to_string(cash), true);
+    std::cout << "Final holdings for" << name.value_or("") << ": " << fmtHoldings(holdings) <<  " Marked to market: " << cash << std::endl;
     
     // Record final results for presentation/debugging.
-    std::string mytype = type;
+    std::string mytype = type.value_or("");
     int gain = cash - starting_cash;
     
     // Check mytype exists in meanResultByAgentType.
@@ -91,12 +97,13 @@ void TradingAgent::kernelStopping() {
     }
 }
 
-bool TradingAgent::wakeup(const Timestamp currentTime) {
+void TradingAgent::wakeup(const Timestamp currentTime) {
     Agent::wakeup(currentTime);
 
     if (first_wake) {
         // Log initial holdings.
-        logEvent("HOLDINGS_UPDATED", fmtHoldings(holdings));
+        static const EventType HOLDINGS_UPDATED = EventTypes::intern("HOLDINGS_UPDATED");
+        logEvent(HOLDINGS_UPDATED, fmtHoldings(holdings));
         first_wake = false;
         sendMessage(exchangeID, MarketClosePriceRequestMsg());
     }
@@ -105,10 +112,9 @@ bool TradingAgent::wakeup(const Timestamp currentTime) {
         // Ask our exchange when it opens and closes.
         sendMessage(exchangeID, MarketHoursRequestMsg());
     }
+}
 
-    /* For the sake of subclasses, TradingAgent now returns a boolean
-       indicating whether the agent is "ready to trade" -- has it received
-       the market open and closed times, and is the market not already closed. */
+bool TradingAgent::readyToTrade() const {
     return (mkt_open.isValid() and mkt_close.isValid()) and not mkt_closed;
 }
 
@@ -124,40 +130,48 @@ void TradingAgent::cancelDataSubscription(MarketDataSubReqMsg subscription_messa
     sendMessage(exchangeID, subscription_message);
 }
 
-void TradingAgent::receiveMessage(Timestamp currentTime, int sender_id, Message& message) { 
-    //FinancialAgent::receiveMessage(currentTime, sender_id, message); NEED TO DO
-
-    // Do we know the market hours?
-    bool had_mkt_hours = mkt_open.isValid() and mkt_close.isValid();
+struct TradingAgent::MessageHandler {
+    TradingAgent& agent;
 
-    // Record market open or close times.
-    if (const MarketHoursMsg* marketMsg = dynamic_cast<const MarketHoursMsg*>(&message)) {
-        mkt_open = marketMsg->mkt_open;
-        mkt_close = marketMsg->mkt_close;
+    void handle(const MarketHoursMsg& msg) {
+        // Record market open or close times.
+        agent.mkt_open = msg.mkt_open;
+        agent.mkt_close = msg.mkt_close;
 
-        logger->log("Recorded market open: " + mkt_open.to_string());
-        logger->log("Recorded market close: " + mkt_close.to_string());
+        agent.logger->log("Recorded market open: " + agent.mkt_open.to_string());
+        agent.logger->log("Recorded market close: " + agent.mkt_close.to_string());
     }
 
-    else if (const MarketClosePriceMsg* marketMsg = dynamic_cast<const MarketClosePriceMsg*>(&message)) {
+    void handle(const MarketClosePriceMsg& msg) {
         // Update the local pricing data to ensure accurate mark-to-market calculations.
-        for (const auto& pair : marketMsg->close_prices) {
-            const std::string& symbol = pair.first;
+        for (const auto& pair : msg.close_prices) {
+            SymbolId symbol = pair.first;
             int close_price = pair.second;
 
-            last_trade[symbol] = close_price;
+            agent.last_trade[symbol] = close_price;
         }
-
     }
+
+    void handle(const Message&) {}
+};
+
+void TradingAgent::receiveMessage(const Timestamp currentTime, int sender_id, const Message* message) { 
+    //FinancialAgent::receiveMessage(currentTime, sender_id, message); NEED TO DO
+
+    // Do we know the market hours?
+    bool had_mkt_hours = mkt_open.isValid() and mkt_close.isValid();
+
+    MessageHandler handler{*this};
+    dispatchMessage(handler, *message);
 }
 
 
-std::string TradingAgent::fmtHoldings(const std::unordered_map<std::string, int>& holdings) {
+std::string TradingAgent::fmtHoldings(const std::unordered_map<SymbolId, int>& holdings) {
     std::ostringstream oss;
     oss << "{ ";
     
     // Ensure there's always a CASH entry.
-    auto cashIt = holdings.find("CASH");
+    auto cashIt = holdings.find(SymbolTable::CASH);
     int cashValue = 0;
     if (cashIt != holdings.end()) {
         cashValue = cashIt->second;
@@ -165,8 +179,8 @@ std::string TradingAgent::fmtHoldings(const std::unordered_map<std::string, int>
 
     // Iterate over the holdings and format the string.
     for (const auto& [key, value] : holdings) {
-        if (key == "CASH") continue;  // Skip the CASH entry for now.
-        oss << key << ": " << value << ", ";
+        if (key == SymbolTable::CASH) continue;  // Skip the CASH entry for now.
+        oss << SymbolTable::name(key) << ": " << value << ", ";
     }
     
     oss << "CASH: " << cashValue;
@@ -174,8 +188,8 @@ std::string TradingAgent::fmtHoldings(const std::unordered_map<std::string, int>
     return oss.str();
 }
 
-int TradingAgent::markToMarket(std::unordered_map<std::string, int>& holdings, bool use_midpoint) {
-    auto cashIt = holdings.find("CASH");
+int TradingAgent::markToMarket(std::unordered_map<SymbolId, int>& holdings, bool use_midpoint) {
+    auto cashIt = holdings.find(SymbolTable::CASH);
     int cashValue = 0;
     if (cashIt != holdings.end()) {
         cashValue = cashIt->second;
@@ -185,7 +199,7 @@ int TradingAgent::markToMarket(std::unordered_map<std::string, int>& holdings, b
 
     int value = 0;
     for (const auto& [symbol, shares] : holdings) {
-        if (symbol == "CASH") { continue; }
+        if (symbol == SymbolTable::CASH) { continue; }
 
         if (use_midpoint) {
             auto [bid, ask, midpoint] = getKnownBidAskMidpoint(symbol); // return std::make_tuple(bid, ask, midpoint);
@@ -200,19 +214,19 @@ int TradingAgent::markToMarket(std::unordered_map<std::string, int>& holdings, b
             int value = last_trade[symbol] * shares;
         }
         cash += value;
-        logger->log("MARK_TO_MARKET" + std::to_string(shares) + symbol + " @ "  + std::to_string(last_trade[symbol]) + std::to_string(value));
+        logger->log("MARK_TO_MARKET" + std::to_string(shares) + SymbolTable::name(symbol) + " @ "  + std::to_string(last_trade[symbol]) + std::to_string(value));
     }
     return cash;
 }
 
-std::tuple<int, int, int> TradingAgent::getKnownBidAskMidpoint(std::string symbol) {
+std::tuple<int, int, int> TradingAgent::getKnownBidAskMidpoint(SymbolId symbol) {
     int bid = -1;
     int ask = -1;
     int mid = -1;
     return std::make_tuple(bid, ask, mid);
 }
 
-std::tuple<int, int, int, int> TradingAgent::getKnownBidAsk(std::string symbol, bool best) {
+std::tuple<int, int, int, int> TradingAgent::getKnownBidAsk(SymbolId symbol, bool best) {
     if (best) {
         if (known_bids.find(symbol) != known_bids.end()) {
         const auto& inner_map = known_bids[symbol];
@@ -224,11 +238,11 @@ std::tuple<int, int, int, int> TradingAgent::getKnownBidAsk(std::string symbol,
             return most_recent->second;
             
         } else {
-            std::cout << "No bids found for " << symbol << std::endl;
+            std::cout << "No bids found for " << SymbolTable::name(symbol) << std::endl;
             return std::make_tuple(-1,-1,-1,-1);
         }
     } else {
-        std::cout << "Symbol " << symbol << " not found in known_bids" << std::endl;
+        std::cout << "Symbol " << SymbolTable::name(symbol) << " not found in known_bids" << std::endl;
         return std::make_tuple(-1,-1,-1,-1);
     }
     }
@@ -238,26 +252,26 @@ std::tuple<int, int, int, int> TradingAgent::getKnownBidAsk(std::string symbol,
     }
 }
 
-int TradingAgent::getHoldings(std::string symbol) {
+int TradingAgent::getHoldings(SymbolId symbol) {
     auto it = holdings.find(symbol);
     return it != holdings.end() ? it->second : 0;
 }
 
-void TradingAgent::getCurrentSpread(std::string symbol, int depth) {
+void TradingAgent::getCurrentSpread(SymbolId symbol, int depth) {
     sendMessage(exchangeID, QuerySpreadMsg(symbol, depth));
 }
 
 LimitOrder TradingAgent::createLimitOrder(
-    std::string symbol,
+    SymbolId symbol,
     int quantity,
     Side side,
     int limit_price,
-    std::optional<int> order_id = std::nullopt,
-    bool is_hidden = false,
-    bool is_price_to_comply = false,
-    bool insert_by_id = false,
-    bool is_post_only = false,
-    bool ignore_risk = true
+    std::optional<OrderId> order_id,
+    bool is_hidden,
+    bool is_price_to_comply,
+    bool insert_by_id,
+    bool is_post_only,
+    bool ignore_risk
 ) {
     LimitOrder order(
             id,
@@ -289,8 +303,8 @@ LimitOrder TradingAgent::createLimitOrder(
         // If at_risk is lower, always allow. Otherwise, new_at_risk must be bellow starting cash.
         if (!ignore_risk) {
             // Compute before and after at-risk capital.
-            int at_risk = markToMarket(holdings) - holdings["CASH"];
-            int new_at_risk = markToMarket(new_holdings) - new_holdings["CASH"];
+            int at_risk = markToMarket(holdings) - holdings[SymbolTable::CASH];
+            int new_at_risk = markToMarket(new_holdings) - new_holdings[SymbolTable::CASH];
 
             if (new_at_risk > at_risk && new_at_risk > starting_cash) {
                 std::ostringstream oss;
@@ -311,11 +325,11 @@ LimitOrder TradingAgent::createLimitOrder(
 
 
 void TradingAgent::placeLimitOrder(
-    std::string symbol,
+    SymbolId symbol,
     int quantity,
     Side side,
     int limit_price,
-    int order_id,
+    OrderId order_id,
     bool is_hidden,
     bool is_price_to_comply,
     bool insert_by_id,
@@ -341,9 +355,10 @@ void TradingAgent::placeLimitOrder(
             orders[order.order_id.value()] = order;
 
             if (log_orders) {
+                static const EventType ORDER_SUBMITTED = EventTypes::intern("ORDER_SUBMITTED");
                 std::ostringstream oss;
                 oss << order;
-                logEvent("ORDER_SUBMITTED", oss.str());
+                logEvent(ORDER_SUBMITTED, oss.str());
             }
         }
 }
\ No newline at end of file
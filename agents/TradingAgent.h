@@ -5,12 +5,10 @@
 #include <unordered_map>
 #include <map>
 #include "../message/market_data.h"
+#include "../message/orders.h"
+#include "../util/SymbolTable.h"
 #include <optional>
 
-struct LimitOrder;
-class Side;
-struct Order;
-
 /* The TradingAgent class (via FinancialAgent, via Agent) is intended as the
    base class for all trading agents (i.e. not things like exchanges) in a
    market simulation.  It handles a lot of messaging (inbound and outbound)
@@ -33,31 +31,31 @@ protected:
     int nav_diff;
     int basket_size;
 
-    std::unordered_map<int, Order> orders;
+    std::unordered_map<OrderId, Order> orders;
 
     // Used in subscription mode to record the timestamp for which the data was current in the ExchangeAgent.
-    std::unordered_map<std::string, Timestamp> exchange_ts;
+    std::unordered_map<SymbolId, Timestamp> exchange_ts;
 
     /* The agent remembers the last known bids and asks (with variable depth,
        showing only aggregate volume at each price level) when it receives
        a response to QUERY_SPREAD. */
-    std::unordered_map<std::string, std::map<Timestamp, std::tuple<int, int, int, int>>> known_bids;
-    std::unordered_map<std::string, std::map<Timestamp, std::tuple<int, int, int, int>>> known_asks;
+    std::unordered_map<SymbolId, std::map<Timestamp, std::tuple<int, int, int, int>>> known_bids;
+    std::unordered_map<SymbolId, std::map<Timestamp, std::tuple<int, int, int, int>>> known_asks;
 
     /* The agent remembers the order history communicated by the exchange
        when such is requested by an agent (for example, a heuristic belief
        learning agent). */
-    std::unordered_map<std::string, int> stream_history;
+    std::unordered_map<SymbolId, int> stream_history;
 
     // The agent records the total transacted volume in the exchange for a given symbol and lookback period.
-    std::unordered_map<std::string, int> transacted_volume;
+    std::unordered_map<SymbolId, int> transacted_volume;
 
     // Each agent can choose to log the orders executed.
     std::vector<std::unordered_map<std::string, int>> executed_orders;
 
 public:
     const int starting_cash;
-    std::unordered_map<std::string, int> holdings;
+    std::unordered_map<SymbolId, int> holdings;
     bool mkt_closed;
     
     // Not yet aware of when the exchange opens/closes.
@@ -70,11 +68,11 @@ public:
         agent must request pricing when it wants it.  This agent does NOT
         automatically generate such requests, though it has a helper function
         that can be used to make it happen. */
-    std::unordered_map<std::string, int> last_trade;
+    std::unordered_map<SymbolId, int> last_trade;
 
     /* When a last trade price comes in after market close, the trading agent
        automatically records it as the daily close price for a symbol.*/
-    std::unordered_map<std::string, int> daily_close_price;
+    std::unordered_map<SymbolId, int> daily_close_price;
 
     TradingAgent(
         int id, 
@@ -87,11 +85,18 @@ public:
         bool log_to_file = true
         );
 
-    void kernelStarting(const Timestamp& startTime);
+    void kernelStarting(Timestamp startTime) override;
+
+    void kernelStopping() override;
 
-    void kernelStopping();
+    void wakeup(const Timestamp currentTime) override;
 
-    bool wakeup(const Timestamp currentTime);
+    bool readyToTrade() const;
+    /*
+        For the sake of subclasses, TradingAgent reports whether the agent is
+        "ready to trade" -- has it received the market open and closed times,
+        and is the market not already closed.
+    */
 
     void requestDataSubscription(MarketDataSubReqMsg subscription_message);
     /*
@@ -111,7 +116,7 @@ public:
             subscription_message: An instance of a MarketDataSubReqMessage.
     */
 
-    void receiveMessage(Timestamp currentTime, int sender_id, Message& message);
+    void receiveMessage(const Timestamp currentTime, int sender_id, const Message* message) override;
     /*
         Arguments:
             current_time: The time that this agent received the message.
@@ -119,13 +124,13 @@ public:
             message: The message contents.
     */
 
-    std::string fmtHoldings(const std::unordered_map<std::string, int>& holdings);
+    std::string fmtHoldings(const std::unordered_map<SymbolId, int>& holdings);
 
-    int markToMarket(std::unordered_map<std::string, int>& holdings, bool use_midpoint = false);
+    int markToMarket(std::unordered_map<SymbolId, int>& holdings, bool use_midpoint = false);
 
-    std::tuple<int, int, int> getKnownBidAskMidpoint(std::string symbol);
+    std::tuple<int, int, int> getKnownBidAskMidpoint(SymbolId symbol);
 
-    std::tuple<int, int, int, int> getKnownBidAsk(std::string symbol, bool best = true);
+    std::tuple<int, int, int, int> getKnownBidAsk(SymbolId symbol, bool best = true);
     /*
         Extract the current known bid and asks.
 
@@ -136,7 +141,7 @@ public:
             best:
     */
 
-   int getHoldings(std::string symbol);
+   int getHoldings(SymbolId symbol);
     /*
         Gets holdings.  Returns zero for any symbol not held.
 
@@ -144,7 +149,7 @@ public:
             symbol: The symbol to query.
     */
 
-    void getCurrentSpread(std::string symbol, int depth = 1);
+    void getCurrentSpread(SymbolId symbol, int depth = 1);
     /*
         Used by any Trading Agent subclass to query the current spread for a symbol.
 
@@ -156,11 +161,11 @@ public:
     */
 
     LimitOrder createLimitOrder(
-        std::string symbol,
+        SymbolId symbol,
         int quantity,
         Side side,
         int limit_price,
-        std::optional<int> order_id = std::nullopt,
+        std::optional<OrderId> order_id = std::nullopt,
         bool is_hidden = false,
         bool is_price_to_comply = false,
         bool insert_by_id = false,
@@ -175,7 +180,7 @@ public:
             quantity: Positive share quantity.
             side: Side.BID or Side.ASK.
             limit_price: Price in cents.
-            order_id: An optional order id (otherwise global autoincrement is used).
+            order_id: An optional order id (otherwise the next automatic id is used).
             is_hidden:
             is_price_to_comply:
             insert_by_id:
@@ -185,11 +190,11 @@ public:
         */
 
    void placeLimitOrder(
-        std::string symbol,
+        SymbolId symbol,
         int quantity,
         Side side,
         int limit_price,
-        int order_id = -1,
+        OrderId order_id = -1,
         bool is_hidden = false,
         bool is_price_to_comply = false,
         bool insert_by_id = false,
@@ -204,7 +209,7 @@ public:
             quantity: Positive share quantity.
             side: Side.BID or Side.ASK.
             limit_price: Price in cents.
-            order_id: An optional order id (otherwise global autoincrement is used).
+            order_id: An optional order id (otherwise the next automatic id is used).
             is_hidden:
             is_price_to_comply:
             insert_by_id:
@@ -213,4 +218,7 @@ public:
                 the order.
     */
 
+private:
+    struct MessageHandler;
+    // Handles the message types TradingAgent reacts to (see receiveMessage), through dispatchMessage.
 };
\ No newline at end of file
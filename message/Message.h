@@ -1,5 +1,7 @@
 #pragma once
 #include <string>  
+#include <cstdint>
+#include "MessageTypes.h"
 
 class Message {
     /*
@@ -11,20 +13,20 @@ class Message {
     The body may be overridden by specific message type subclasses.
     */
 
-    /* The autoincrementing variable here will ensure that, when Messages are due for
-       delivery at the same time step, the Message that was created first is delivered
-       first. (Which is not important, but Python 3 requires a fully resolved chain of
-       priority in all cases, so we need something consistent) We might want to generate
-       these with stochasticity, but guarantee uniqueness somehow, to make delivery of
-       orders at the same exact timestamp "random" instead of "arbitrary" (FIFO among
-       tied times) as it currently is. */
+    /* Messages carry no ordering information of their own.  When several are due at the
+       same time step, the Kernel delivers them in order of sender id, and each sender's
+       in the order it sent them (see nextSeq() in Kernel.h and QueueKey), which does not
+       depend on how agents are spread over threads. */
+
+    /* type_id identifies the concrete message class (see MessageTypes.h).  Every
+       subclass constructor assigns its own id, so after construction it always names
+       the most-derived type and can be used to dispatch without RTTI. */
 
 public:
-    static int uniq;
-    int uniq_id;
+    MessageTypeId type_id;
 
     Message() {
-        uniq_id = uniq++;
+        type_id = messageTypeId<Message>();
     }
     
     virtual std::string getName() const {
@@ -40,7 +42,10 @@ class WakeupMsg : public Message {
     Empty message send to agents to wake them up.
     */
 
+public:
+    WakeupMsg() : Message() { type_id = messageTypeId<WakeupMsg>(); }
+
     std::string getName() const override {
         return "WakeupMsg";
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include "Message.h"
+#include "market.h"
+#include "query.h"
+#include "order_book.h"
+#include "market_data.h"
+
+/* Jump-table dispatch on Message::type_id.
+
+   dispatchMessage(handler, msg) calls handler.handle(const T&) with msg downcast to its
+   concrete type T.  The table is built at compile time from MessageTypes, with one entry
+   per type, and overload resolution picks the most specific handle() the handler
+   declares for each type, so a handler may cover a whole family with a base-class
+   overload (e.g. handle(const QueryMsg&)).  Handlers must provide a catch-all
+   handle(const Message&).
+
+   Agents that only care about a few types can instead switch directly on type_id:
+
+       switch (msg->type_id) {
+           case messageTypeId<MarketHoursMsg>(): ...
+       }
+*/
+
+template <typename Handler, typename List>
+struct MessageDispatchTable;
+
+template <typename Handler, typename... Ts>
+struct MessageDispatchTable<Handler, MessageTypeList<Ts...>> {
+    typedef void (*HandlerFn)(Handler&, const Message&);
+
+    template <typename T>
+    static void call(Handler& handler, const Message& msg) {
+        handler.handle(static_cast<const T&>(msg));
+    }
+
+    static constexpr std::array<HandlerFn, sizeof...(Ts)> table = {{ &call<Ts>... }};
+};
+
+template <typename Handler>
+void dispatchMessage(Handler& handler, const Message& msg) {
+    MessageDispatchTable<Handler, MessageTypes>::table[msg.type_id](handler, msg);
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/* Compile-time registry of every message type.  A message's type id is its index in
+   MessageTypes, so ids are small, dense and usable as switch labels or table indices.
+   New message classes must be added to the list below and set their type_id in their
+   constructors (see Message.h). */
+
+class Message;
+class WakeupMsg;
+
+class MarketClosedMsg;
+class MarketHoursRequestMsg;
+class MarketHoursMsg;
+class MarketClosePriceRequestMsg;
+class MarketClosePriceMsg;
+
+struct QueryMsg;
+struct QueryResponseMsg;
+struct QueryLastTradeMsg;
+struct QueryLastTradeResponseMsg;
+struct QuerySpreadMsg;
+struct QuerySpreadResponseMsg;
+struct QueryOrderStreamMsg;
+struct QueryOrderStreamResponseMsg;
+struct QueryTransactedVolMsg;
+struct QueryTransactedVolResponseMsg;
+
+struct OrderBookMsg;
+struct OrderAcceptedMsg;
+struct OrderExecutedMsg;
+struct OrderCancelledMsg;
+struct OrderPartialCancelledMsg;
+struct OrderModifiedMsg;
+struct OrderReplacedMsg;
+
+class MarketDataSubReqMsg;
+class MarketDataFreqBasedSubReqMsg;
+class MarketDataEventBasedSubReqMsg;
+class L1SubReqMsg;
+class L2SubReqMsg;
+class L3SubReqMsg;
+class TransactedVolSubReqMsg;
+class BookImbalanceSubReqMsg;
+class MarketDataMsg;
+class MarketDataEventMsg;
+class L1DataMsg;
+class L2DataMsg;
+class L3DataMsg;
+class TransactedVolDataMsg;
+class BookImbalanceDataMsg;
+
+typedef uint16_t MessageTypeId;
+
+template <typename... Ts>
+struct MessageTypeList {
+    static constexpr std::size_t size = sizeof...(Ts);
+};
+
+typedef MessageTypeList<
+    Message,
+    WakeupMsg,
+
+    MarketClosedMsg,
+    MarketHoursRequestMsg,
+    MarketHoursMsg,
+    MarketClosePriceRequestMsg,
+    MarketClosePriceMsg,
+
+    QueryMsg,
+    QueryResponseMsg,
+    QueryLastTradeMsg,
+    QueryLastTradeResponseMsg,
+    QuerySpreadMsg,
+    QuerySpreadResponseMsg,
+    QueryOrderStreamMsg,
+    QueryOrderStreamResponseMsg,
+    QueryTransactedVolMsg,
+    QueryTransactedVolResponseMsg,
+
+    OrderBookMsg,
+    OrderAcceptedMsg,
+    OrderExecutedMsg,
+    OrderCancelledMsg,
+    OrderPartialCancelledMsg,
+    OrderModifiedMsg,
+    OrderReplacedMsg,
+
+    MarketDataSubReqMsg,
+    MarketDataFreqBasedSubReqMsg,
+    MarketDataEventBasedSubReqMsg,
+    L1SubReqMsg,
+    L2SubReqMsg,
+    L3SubReqMsg,
+    TransactedVolSubReqMsg,
+    BookImbalanceSubReqMsg,
+    MarketDataMsg,
+    MarketDataEventMsg,
+    L1DataMsg,
+    L2DataMsg,
+    L3DataMsg,
+    TransactedVolDataMsg,
+    BookImbalanceDataMsg
+> MessageTypes;
+
+constexpr std::size_t NUM_MESSAGE_TYPES = MessageTypes::size;
+
+
+template <typename T, typename List>
+struct MessageTypeIndex;
+
+template <typename T, typename... Ts>
+struct MessageTypeIndex<T, MessageTypeList<T, Ts...>> {
+    static constexpr MessageTypeId value = 0;
+};
+
+template <typename T, typename U, typename... Ts>
+struct MessageTypeIndex<T, MessageTypeList<U, Ts...>> {
+    static_assert(sizeof...(Ts) > 0, "Message type is not registered in MessageTypes.");
+    static constexpr MessageTypeId value = 1 + MessageTypeIndex<T, MessageTypeList<Ts...>>::value;
+};
+
+template <typename T>
+constexpr MessageTypeId messageTypeId() {
+    /*
+    Returns the compile-time type id of message class T.
+    */
+    return MessageTypeIndex<std::remove_cv_t<T>, MessageTypes>::value;
+}
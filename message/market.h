@@ -1,5 +1,6 @@
 #pragma once
-#include "message.h"
+#include "Message.h"
+#include "../util/SymbolTable.h"
 #include "../util/timestamping.h"
 #include <unordered_map>
 
@@ -12,7 +13,7 @@ class MarketClosedMsg : public Message {
     */
 
 public:
-    MarketClosedMsg() : Message() {}
+    MarketClosedMsg() : Message() { type_id = messageTypeId<MarketClosedMsg>(); }
 
     std::string getName() const override {
         return "MarketClosedMsg";
@@ -25,7 +26,7 @@ class MarketHoursRequestMsg : public Message {
     it trades. A ``MarketHoursMsg`` is sent in response.
     */
 public:
-    MarketHoursRequestMsg() : Message() {}
+    MarketHoursRequestMsg() : Message() { type_id = messageTypeId<MarketHoursRequestMsg>(); }
 
     std::string getName() const override {
         return "MarketHoursRequestMsg";
@@ -47,7 +48,7 @@ public:
     Timestamp mkt_close;
 
     MarketHoursMsg(Timestamp mkt_open, Timestamp mkt_close) 
-    : Message(), mkt_open(mkt_open), mkt_close(mkt_close) {}
+    : Message(), mkt_open(mkt_open), mkt_close(mkt_close) { type_id = messageTypeId<MarketHoursMsg>(); }
 
     std::string getName() const override {
         return "MarketHoursMsg";
@@ -62,7 +63,7 @@ class MarketClosePriceRequestMsg : public Message {
     the agent's final mark-to-market value.
     */
 public:
-    MarketClosePriceRequestMsg() : Message() {}
+    MarketClosePriceRequestMsg() : Message() { type_id = messageTypeId<MarketClosePriceRequestMsg>(); }
 
     std::string getName() const override {
         return "MarketClosePriceRequestMsg";
@@ -82,9 +83,9 @@ class MarketClosePriceMsg : public Message {
     */
 
 public:
-    std::unordered_map<std::string, int> close_prices;
+    std::unordered_map<SymbolId, int> close_prices;
 
-    MarketClosePriceMsg() : Message() {}
+    MarketClosePriceMsg() : Message() { type_id = messageTypeId<MarketClosePriceMsg>(); }
     
     std::string getName() const override {
         return "MarketClosePriceMsg";
@@ -1,10 +1,15 @@
 #pragma once
 #include "Message.h"
+#include "../util/BookSnapshot.h"
+#include "../util/SymbolTable.h"
 #include "../util/timestamping.h"
 #include <vector>
 #include <tuple>
 #include <limits>
+#include <memory>
 #include <array>
+#include <string>
+#include <utility>
 //from ..orders import Side
 
 
@@ -20,10 +25,12 @@ class MarketDataSubReqMsg : public Message {
     */
 
 public:
-    std::string symbol;
+    SymbolId symbol;
     bool cancel;
 
-    MarketDataSubReqMsg(std::string symbol, bool cancel) : Message(), symbol(symbol), cancel(cancel) {}
+    MarketDataSubReqMsg(SymbolId symbol, bool cancel) : Message(), symbol(symbol), cancel(cancel) {
+        type_id = messageTypeId<MarketDataSubReqMsg>();
+    }
 };
 
 
@@ -40,10 +47,13 @@ class MarketDataFreqBasedSubReqMsg : public MarketDataSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
+public:
     int freq;
-    MarketDataFreqBasedSubReqMsg(std::string symbol, bool cancel, int freq=1) : MarketDataSubReqMsg(symbol, cancel), freq(freq) {}
+    MarketDataFreqBasedSubReqMsg(SymbolId symbol, bool cancel, int freq=1) : MarketDataSubReqMsg(symbol, cancel), freq(freq) {
+        type_id = messageTypeId<MarketDataFreqBasedSubReqMsg>();
+    }
 };
 
 
@@ -59,8 +69,12 @@ class MarketDataEventBasedSubReqMsg : public MarketDataSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
+public:
+    MarketDataEventBasedSubReqMsg(SymbolId symbol, bool cancel) : MarketDataSubReqMsg(symbol, cancel) {
+        type_id = messageTypeId<MarketDataEventBasedSubReqMsg>();
+    }
 };
 
 
@@ -78,9 +92,13 @@ class L1SubReqMsg : public MarketDataFreqBasedSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
     // freq: int = 1
+public:
+    L1SubReqMsg(SymbolId symbol, bool cancel = false, int freq = 1) : MarketDataFreqBasedSubReqMsg(symbol, cancel, freq) {
+        type_id = messageTypeId<L1SubReqMsg>();
+    }
 };
 
 
@@ -99,10 +117,14 @@ class L2SubReqMsg : public MarketDataFreqBasedSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
     // freq: int = 1
+public:
     int depth = std::numeric_limits<int>::max();
+
+    L2SubReqMsg(SymbolId symbol, bool cancel = false, int freq = 1, int depth = std::numeric_limits<int>::max())
+    : MarketDataFreqBasedSubReqMsg(symbol, cancel, freq), depth(depth) { type_id = messageTypeId<L2SubReqMsg>(); }
 };
 
 
@@ -121,10 +143,14 @@ class L3SubReqMsg : public MarketDataFreqBasedSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
     // freq: int = 1
+public:
     int depth = std::numeric_limits<int>::max();
+
+    L3SubReqMsg(SymbolId symbol, bool cancel = false, int freq = 1, int depth = std::numeric_limits<int>::max())
+    : MarketDataFreqBasedSubReqMsg(symbol, cancel, freq), depth(depth) { type_id = messageTypeId<L3SubReqMsg>(); }
 };
 
 
@@ -143,10 +169,16 @@ class TransactedVolSubReqMsg : public MarketDataFreqBasedSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
     // freq: int = 1
+public:
     std::string lookback = "1min";
+
+    TransactedVolSubReqMsg(SymbolId symbol, bool cancel = false, int freq = 1, std::string lookback = "1min")
+    : MarketDataFreqBasedSubReqMsg(symbol, cancel, freq), lookback(lookback) {
+        type_id = messageTypeId<TransactedVolSubReqMsg>();
+    }
 };
 
 
@@ -166,9 +198,15 @@ class BookImbalanceSubReqMsg : public MarketDataEventBasedSubReqMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // cancel: bool = False
+public:
     float min_imbalance = 1.0;
+
+    BookImbalanceSubReqMsg(SymbolId symbol, bool cancel = false, float min_imbalance = 1.0)
+    : MarketDataEventBasedSubReqMsg(symbol, cancel), min_imbalance(min_imbalance) {
+        type_id = messageTypeId<BookImbalanceSubReqMsg>();
+    }
 };
 
 class MarketDataMsg : public Message {  
@@ -184,9 +222,15 @@ class MarketDataMsg : public Message {
         exchange_ts: The time that the message was sent from the exchange.
     */
 
-    std::string symbol;
+public:
+    SymbolId symbol;
     int last_transaction;
     Timestamp exchange_ts;
+
+    MarketDataMsg(SymbolId symbol, int last_transaction, Timestamp exchange_ts)
+    : symbol(symbol), last_transaction(last_transaction), exchange_ts(exchange_ts) {
+        type_id = messageTypeId<MarketDataMsg>();
+    }
 };
 
 
@@ -204,16 +248,22 @@ class MarketDataEventMsg : public MarketDataMsg {
         stage: The stage of this event (start or finish).
     */
 
+public:
     enum class Stage {
         START,
         FINISH
     };
 
     Stage stage;
+
+    MarketDataEventMsg(SymbolId symbol, int last_transaction, Timestamp exchange_ts, Stage stage)
+    : MarketDataMsg(symbol, last_transaction, exchange_ts), stage(stage) {
+        type_id = messageTypeId<MarketDataEventMsg>();
+    }
 };
 
 
-class L1DataMsg : MarketDataMsg {
+class L1DataMsg : public MarketDataMsg {
     /*
     This message returns L1 order book data as part of an L1 data subscription.
 
@@ -226,11 +276,17 @@ class L1DataMsg : MarketDataMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // last_transaction: int
     // exchange_ts: NanosecondTime
+public:
     int bid[2];
     int ask[2];
+
+    L1DataMsg(SymbolId symbol, int last_transaction, Timestamp exchange_ts, const int (&bid)[2], const int (&ask)[2])
+    : MarketDataMsg(symbol, last_transaction, exchange_ts), bid{bid[0], bid[1]}, ask{ask[0], ask[1]} {
+        type_id = messageTypeId<L1DataMsg>();
+    }
 };
 
 
@@ -238,50 +294,74 @@ class L2DataMsg : public MarketDataMsg {
     /*
     This message returns L2 order book data as part of an L2 data subscription.
 
+    The levels live in a shared, immutable snapshot (see BookSnapshot): the exchange
+    sends the same snapshot to every subscriber of the same depth.
+
     Attributes:
         symbol: The symbol of the security this data is for.
         last_transaction: The time of the last transaction that happened on the exchange.
         exchange_ts: The time that the message was sent from the exchange.
-        bids: A list of tuples containing the price and available volume at each bid
-            price level.
-        asks: A list of tuples containing the price and available volume at each ask
-            price level.
+        snapshot: The requested depth and, for each side, a list of the price and
+            available volume at each price level, best first.
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // last_transaction: int
     // exchange_ts: NanosecondTime
 
-    std::vector<std::array<int, 2>> bids;
-    std::vector<std::array<int, 2>> asks;
-
-    // TODO: include requested depth
+public:
+    std::shared_ptr<const L2Snapshot> snapshot;
+
+    L2DataMsg(
+        SymbolId symbol,
+        int last_transaction,
+        Timestamp exchange_ts,
+        std::shared_ptr<const L2Snapshot> snapshot
+    ) : MarketDataMsg(symbol, last_transaction, exchange_ts), snapshot(std::move(snapshot)) {
+        type_id = messageTypeId<L2DataMsg>();
+    }
+
+    const std::vector<L2Level>& bids() const { return *snapshot->bids; }
+    const std::vector<L2Level>& asks() const { return *snapshot->asks; }
+    std::size_t depth() const { return snapshot->depth; }
 };
 
 
-class L3DataMsg : MarketDataMsg {
+class L3DataMsg : public MarketDataMsg {
     /*
     This message returns L3 order book data as part of an L3 data subscription.
 
+    The levels live in a shared, immutable snapshot (see BookSnapshot): the exchange
+    sends the same snapshot to every subscriber of the same depth.
+
     Attributes:
         symbol: The symbol of the security this data is for.
         last_transaction: The time of the last transaction that happened on the exchange.
         exchange_ts: The time that the message was sent from the exchange.
-        bids: A list of tuples containing the price and a list of order sizes at each
-            bid price level.
-        asks: A list of tuples containing the price and a list of order sizes at each
-            ask price level.
+        snapshot: The requested depth and, for each side, a list of tuples containing
+            the price and a list of order sizes at each price level, best first.
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // last_transaction: int
     // exchange_ts: NanosecondTime
-    std::vector<std::tuple<int, std::vector<int>>> bids;
-    std::vector<std::tuple<int, std::vector<int>>> asks;
-
-    // TODO: include requested depth
+public:
+    std::shared_ptr<const L3Snapshot> snapshot;
+
+    L3DataMsg(
+        SymbolId symbol,
+        int last_transaction,
+        Timestamp exchange_ts,
+        std::shared_ptr<const L3Snapshot> snapshot
+    ) : MarketDataMsg(symbol, last_transaction, exchange_ts), snapshot(std::move(snapshot)) {
+        type_id = messageTypeId<L3DataMsg>();
+    }
+
+    const std::vector<L3Level>& bids() const { return *snapshot->bids; }
+    const std::vector<L3Level>& asks() const { return *snapshot->asks; }
+    std::size_t depth() const { return snapshot->depth; }
 };
 
 
@@ -299,12 +379,18 @@ class TransactedVolDataMsg : public MarketDataMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // last_transaction: int
     // exchange_ts: NanosecondTime
+public:
     int bid_volume;
     int ask_volume;
 
+    TransactedVolDataMsg(SymbolId symbol, int last_transaction, Timestamp exchange_ts, int bid_volume, int ask_volume)
+    : MarketDataMsg(symbol, last_transaction, exchange_ts), bid_volume(bid_volume), ask_volume(ask_volume) {
+        type_id = messageTypeId<TransactedVolDataMsg>();
+    }
+
     // TODO: include lookback period
 };
 
@@ -324,10 +410,22 @@ class BookImbalanceDataMsg : public MarketDataEventMsg {
     */
 
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     // last_transaction: int
     // exchange_ts: pd.Timestamp
     // stage: MarketDataEventMsg.Stage
+public:
     float imbalance;
     std::string side;
+
+    BookImbalanceDataMsg(
+        SymbolId symbol,
+        int last_transaction,
+        Timestamp exchange_ts,
+        Stage stage,
+        float imbalance,
+        std::string side
+    ) : MarketDataEventMsg(symbol, last_transaction, exchange_ts, stage), imbalance(imbalance), side(side) {
+        type_id = messageTypeId<BookImbalanceDataMsg>();
+    }
 };
\ No newline at end of file
@@ -1,37 +1,55 @@
+#pragma once
 #include "Message.h"
 #include "orders.h"
 
 struct OrderBookMsg : public Message {
+    OrderBookMsg() { type_id = messageTypeId<OrderBookMsg>(); }
     virtual ~OrderBookMsg() = default;
 };
 
 struct OrderAcceptedMsg : public OrderBookMsg {
     LimitOrder order;
-    OrderAcceptedMsg(const LimitOrder& order) : order(order) {}
+    OrderAcceptedMsg(const LimitOrder& order) : order(order) { type_id = messageTypeId<OrderAcceptedMsg>(); }
 };
 
 
 struct OrderExecutedMsg : public OrderBookMsg {
     Order order;
-    OrderExecutedMsg(const Order& order) : order(order) {}
+    OrderExecutedMsg(const Order& order) : order(order) { type_id = messageTypeId<OrderExecutedMsg>(); }
+
+    // Reports the executed portion of `order` without the caller copying it first.
+    OrderExecutedMsg(const Order& order, int quantity, int fill_price) : order(order) {
+        type_id = messageTypeId<OrderExecutedMsg>();
+        this->order.quantity = quantity;
+        this->order.fill_price = fill_price;
+    }
+
+    // As above, for an order resting in the book for `symbol`.
+    OrderExecutedMsg(const RestingOrder& order, SymbolId symbol, int quantity, int fill_price)
+        : order(order.agent_id, Timestamp(order.time_placed), symbol, quantity, order.side(), order.order_id) {
+        type_id = messageTypeId<OrderExecutedMsg>();
+        this->order.fill_price = fill_price;
+    }
 };
 
 
 struct OrderCancelledMsg : public OrderBookMsg {
     LimitOrder order;
-    OrderCancelledMsg(const LimitOrder& order) : order(order) {}
+    OrderCancelledMsg(const LimitOrder& order) : order(order) { type_id = messageTypeId<OrderCancelledMsg>(); }
 };
 
 
 struct OrderPartialCancelledMsg : public OrderBookMsg {
     LimitOrder new_order;
-    OrderPartialCancelledMsg(const LimitOrder& new_order) : new_order(new_order) {}
+    OrderPartialCancelledMsg(const LimitOrder& new_order) : new_order(new_order) {
+        type_id = messageTypeId<OrderPartialCancelledMsg>();
+    }
 };
 
 
 struct OrderModifiedMsg : public OrderBookMsg {
     LimitOrder new_order;
-    OrderModifiedMsg(const LimitOrder& new_order) : new_order(new_order) {}
+    OrderModifiedMsg(const LimitOrder& new_order) : new_order(new_order) { type_id = messageTypeId<OrderModifiedMsg>(); }
 };
 
 
@@ -39,5 +57,5 @@ struct OrderReplacedMsg : public OrderBookMsg {
     LimitOrder old_order;
     LimitOrder new_order;
     OrderReplacedMsg(const LimitOrder& old_order, const LimitOrder& new_order) 
-    : old_order(old_order), new_order(new_order) {}
+    : old_order(old_order), new_order(new_order) { type_id = messageTypeId<OrderReplacedMsg>(); }
 };
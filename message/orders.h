@@ -1,9 +1,16 @@
 #pragma once
 #include <string>
 #include <limits>
+#include <stdexcept>
 #include "../util/timestamping.h"
 #include <optional>  // For std::optional and std::nullopt
+#include <cstdint>
+#include <type_traits>
 #include "../util/util.h"
+#include "../util/SymbolTable.h"
+
+// Order ids are 64-bit so every agent's automatic sequence can get its own 2^32 ids.
+typedef int64_t OrderId;
 
 class Side {
 public:
@@ -60,13 +67,18 @@ struct Order {
     Specific order types will inherit from this (like LimitOrder).
     */
 
-    static int order_id_counter;
+    /* Automatic order ids are taken from order_id_counter.  Outside a simulation orders
+       are numbered 0, 1, 2, ... in creation order.  The Kernel loads each agent's own
+       sequence while dispatching to it, so agent a gets ids (a << 32) | 0, 1, 2, ... and
+       the ids an agent gets do not depend on what other agents (on other LPs or
+       threads) did meanwhile.  Either way a sequence holds 2^32 ids. */
+    static thread_local OrderId order_id_counter;
     int agentID;
     Timestamp time_placed;
-    std::string symbol;
+    SymbolId symbol;
     int quantity;
     Side side;
-    std::optional<int> order_id;
+    std::optional<OrderId> order_id;
     int fill_price;
 
     Order() {}
@@ -74,17 +86,17 @@ struct Order {
     Order(
         int agentID,
         Timestamp time_placed,
-        std::string symbol,
+        SymbolId symbol,
         int quantity,
         Side side,
-        std::optional<int> order_id = std::nullopt
+        std::optional<OrderId> order_id = std::nullopt
     ) : agentID(agentID), time_placed(time_placed), symbol(symbol),
         quantity(quantity), side(side) {
         /*
         Arguments:
             agent_id: The ID of the agent that created this order.
             time_placed: Time at which the order was created by the agent.
-            symbol: Equity symbol for the order.
+            symbol: Interned equity symbol for the order.
             quantity: Number of equity units affected by the order.
             side: Indicates if an order is on the BID or ASK side of the market.
             order_id: Either self generated or assigned. Should only be self
@@ -97,9 +109,14 @@ struct Order {
                 track of the intent of particular orders, to simplify their code.
         */
 
-        if (!order_id.has_value()) {
-            order_id = order_id_counter;
-            order_id_counter ++;
+        if (order_id.has_value()) {
+            this->order_id = order_id;
+        }
+        else {
+            if ((order_id_counter & 0xFFFFFFFF) == 0xFFFFFFFF) {
+                throw std::overflow_error("Automatic order ids exhausted.");
+            }
+            this->order_id = order_id_counter++;
         }
 
         // Create placeholder fields that don't get filled in until certain events happen.
@@ -125,7 +142,7 @@ struct LimitOrder : public Order {
     LimitOrder(
         int agentID,
         Timestamp time_placed,
-        std::string symbol,
+        SymbolId symbol,
         int quantity,
         Side side,
         int limit_price,
@@ -133,7 +150,7 @@ struct LimitOrder : public Order {
         bool is_price_to_comply = false,
         bool insert_by_id = false,
         bool is_post_only = false,
-        std::optional<int> order_id = std::nullopt
+        std::optional<OrderId> order_id = std::nullopt
     ) : Order(agentID, time_placed, symbol, quantity, side, order_id),
         limit_price(limit_price), is_hidden(is_hidden), is_price_to_comply(is_price_to_comply),
         insert_by_id(insert_by_id), is_post_only(is_post_only) {}
@@ -149,12 +166,61 @@ struct LimitOrder : public Order {
         std::string filled = order.fill_price != -1 ? "" : "(filled @ " + dollarise(order.fill_price) + ")";
 
         os << "(Agent " << order.agentID << " @ " << order.time_placed.to_string() << 
-        ") " << order.side.to_string() << " " << order.quantity << " " << order.symbol <<
+        ") " << order.side.to_string() << " " << order.quantity << " " << SymbolTable::name(order.symbol) <<
         " @ " << price << " " << filled;
         return os;
     }
 };
 
+struct RestingOrder {
+    /*
+    Dense record of a LimitOrder resting in an OrderBook.
+
+    Holds only what matching needs, in 32 trivially copyable bytes: the symbol is
+    implied by the book holding the order, and the order's boolean properties and
+    side are packed into `flags`.  Convert back with toLimitOrder() when an order
+    leaves the book (e.g. in a notification message).
+    */
+    enum Flag : uint8_t {
+        BID = 1,
+        HIDDEN = 2,
+        PRICE_TO_COMPLY = 4,
+        INSERT_BY_ID = 8,
+        POST_ONLY = 16
+    };
+
+    OrderId order_id;
+    int agent_id;
+    int price;
+    int quantity;
+    long long time_placed;      // ns
+    uint8_t flags;
+
+    RestingOrder() = default;
+
+    explicit RestingOrder(const LimitOrder& order)
+        : order_id(*order.order_id), agent_id(order.agentID), price(order.limit_price),
+          quantity(order.quantity), time_placed(order.time_placed.to_nanoseconds()),
+          flags((order.side.is_bid() ? BID : 0)
+                | (order.is_hidden ? HIDDEN : 0)
+                | (order.is_price_to_comply ? PRICE_TO_COMPLY : 0)
+                | (order.insert_by_id ? INSERT_BY_ID : 0)
+                | (order.is_post_only ? POST_ONLY : 0)) {}
+
+    Side side() const { return Side(flags & BID ? Side::Type::BID : Side::Type::ASK); }
+    bool isHidden() const { return flags & HIDDEN; }
+    bool isPriceToComply() const { return flags & PRICE_TO_COMPLY; }
+
+    LimitOrder toLimitOrder(SymbolId symbol) const {
+        return LimitOrder(agent_id, Timestamp(time_placed), symbol, quantity, side(), price,
+                          flags & HIDDEN, flags & PRICE_TO_COMPLY, flags & INSERT_BY_ID,
+                          flags & POST_ONLY, order_id);
+    }
+};
+
+static_assert(std::is_trivially_copyable<RestingOrder>::value, "RestingOrder must stay a plain record.");
+
+
 struct MarketOrder : public Order {
     /*
     MarketOrder class, inherits from Order class.
@@ -163,16 +229,16 @@ struct MarketOrder : public Order {
     MarketOrder(
         int agentID,
         Timestamp time_placed,
-        std::string symbol,
+        SymbolId symbol,
         int quantity,
         Side side,
-        std::optional<int> order_id = std::nullopt
+        std::optional<OrderId> order_id = std::nullopt
     ) : Order(agentID, time_placed, symbol, quantity, side, order_id) {}
 
 
     friend std::ostream& operator<<(std::ostream& os, const MarketOrder& order) {
         os << "(Agent " << order.agentID << " @ " << order.time_placed.to_string() << ") : MKT Order "
-           << order.side.to_string() << " " << order.quantity << " " << order.symbol;
+           << order.side.to_string() << " " << order.quantity << " " << SymbolTable::name(order.symbol);
 
         return os;
     }
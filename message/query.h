@@ -1,11 +1,14 @@
 #pragma once
 #include "Message.h"
+#include "../util/SymbolTable.h"
 #include <vector>
+#include <tuple>
+#include <utility>
 #include <unordered_map>
 
 struct QueryMsg : public Message {
-    std::string symbol;
-    QueryMsg(std::string symbol) : symbol(symbol) {}
+    SymbolId symbol;
+    QueryMsg(SymbolId symbol) : symbol(symbol) { type_id = messageTypeId<QueryMsg>(); }
 
     std::string getName() const override {
         return "QueryMsg";
@@ -13,9 +16,11 @@ struct QueryMsg : public Message {
 };
 
 struct QueryResponseMsg : public Message {
-    std::string symbol;
+    SymbolId symbol;
     bool mkt_closed;
-    QueryResponseMsg(std::string symbol, bool mkt_closed) : symbol(symbol), mkt_closed(mkt_closed) {}
+    QueryResponseMsg(SymbolId symbol, bool mkt_closed) : symbol(symbol), mkt_closed(mkt_closed) {
+        type_id = messageTypeId<QueryResponseMsg>();
+    }
 
     std::string getName() const override {
         return "QueryResponseMsg";
@@ -25,8 +30,8 @@ struct QueryResponseMsg : public Message {
 
 struct QueryLastTradeMsg : public QueryMsg {
     // Inherited Fields:
-    // symbol: str
-    QueryLastTradeMsg(std::string symbol) : QueryMsg(symbol) {}
+    // symbol: SymbolId
+    QueryLastTradeMsg(SymbolId symbol) : QueryMsg(symbol) { type_id = messageTypeId<QueryLastTradeMsg>(); }
 
     std::string getName() const override {
         return "QueryLastTradeMsg";
@@ -36,11 +41,11 @@ struct QueryLastTradeMsg : public QueryMsg {
 
 struct QueryLastTradeResponseMsg : public QueryResponseMsg {
     /* Inherited Fields:
-       symbol: str
+       symbol: SymbolId
        mkt_closed: bool */    
     int last_trade;
-    QueryLastTradeResponseMsg(std::string symbol, bool mkt_closed, int last_trade) : last_trade(last_trade),
-    QueryResponseMsg(symbol, mkt_closed) {}
+    QueryLastTradeResponseMsg(SymbolId symbol, bool mkt_closed, int last_trade) : last_trade(last_trade),
+    QueryResponseMsg(symbol, mkt_closed) { type_id = messageTypeId<QueryLastTradeResponseMsg>(); }
 
     std::string getName() const override {
         return "QueryLastTradeResponseMsg";
@@ -50,9 +55,9 @@ struct QueryLastTradeResponseMsg : public QueryResponseMsg {
 
 struct QuerySpreadMsg : public QueryMsg {
     /* Inherited Fields:
-       symbol: str */
+       symbol: SymbolId */
     int depth;
-    QuerySpreadMsg(std::string symbol, int depth) : QueryMsg(symbol), depth(depth) {}
+    QuerySpreadMsg(SymbolId symbol, int depth) : QueryMsg(symbol), depth(depth) { type_id = messageTypeId<QuerySpreadMsg>(); }
 
     std::string getName() const override {
         return "QuerySpreadMsg";
@@ -62,13 +67,23 @@ struct QuerySpreadMsg : public QueryMsg {
 
 struct QuerySpreadResponseMsg : public QueryResponseMsg {
     /* Inherited Fields:
-       symbol: str
+       symbol: SymbolId
        mkt_closed: bool */
     int depth;
     std::vector<std::tuple<int, int>> bids;
     std::vector<std::tuple<int, int>> asks;
     int last_trade;
 
+    QuerySpreadResponseMsg(
+        SymbolId symbol,
+        bool mkt_closed,
+        int depth,
+        std::vector<std::tuple<int, int>> bids,
+        std::vector<std::tuple<int, int>> asks,
+        int last_trade
+    ) : QueryResponseMsg(symbol, mkt_closed), depth(depth), bids(std::move(bids)), asks(std::move(asks)),
+        last_trade(last_trade) { type_id = messageTypeId<QuerySpreadResponseMsg>(); }
+
     std::string getName() const override {
         return "QuerySpreadResponseMsg";
     }
@@ -77,9 +92,11 @@ struct QuerySpreadResponseMsg : public QueryResponseMsg {
 
 struct QueryOrderStreamMsg : public QueryMsg {
     /* Inherited Fields:
-       symbol: str */
+       symbol: SymbolId */
     int length;
-    QueryOrderStreamMsg(std::string symbol, int length) : length(length), QueryMsg(symbol) {}
+    QueryOrderStreamMsg(SymbolId symbol, int length) : length(length), QueryMsg(symbol) {
+        type_id = messageTypeId<QueryOrderStreamMsg>();
+    }
 
     std::string getName() const override {
         return "QueryOrderStreamMsg";
@@ -89,11 +106,20 @@ struct QueryOrderStreamMsg : public QueryMsg {
 
 struct QueryOrderStreamResponseMsg : QueryResponseMsg {
     /* Inherited Fields:
-       symbol: str
+       symbol: SymbolId
        mkt_closed: bool */
     int length;
     std::vector<std::unordered_map<std::string, int>> orders;
 
+    QueryOrderStreamResponseMsg(
+        SymbolId symbol,
+        bool mkt_closed,
+        int length,
+        std::vector<std::unordered_map<std::string, int>> orders
+    ) : QueryResponseMsg(symbol, mkt_closed), length(length), orders(std::move(orders)) {
+        type_id = messageTypeId<QueryOrderStreamResponseMsg>();
+    }
+
     std::string getName() const override {
         return "QueryOrderStreamResponseMsg";
     }
@@ -102,10 +128,10 @@ struct QueryOrderStreamResponseMsg : QueryResponseMsg {
 
 struct QueryTransactedVolMsg : public QueryMsg {
     // Inherited Fields:
-    // symbol: str
+    // symbol: SymbolId
     std::string lookback_period;
-    QueryTransactedVolMsg(std::string symbol, std::string lookback_period) : 
-    QueryMsg(symbol), lookback_period(lookback_period) {}
+    QueryTransactedVolMsg(SymbolId symbol, std::string lookback_period) : 
+    QueryMsg(symbol), lookback_period(lookback_period) { type_id = messageTypeId<QueryTransactedVolMsg>(); }
 
     std::string getName() const override {
         return "QueryTransactedVolMsg";
@@ -115,12 +141,14 @@ struct QueryTransactedVolMsg : public QueryMsg {
 
 struct QueryTransactedVolResponseMsg : QueryResponseMsg {
     /* Inherited Fields:
-       symbol: str
+       symbol: SymbolId
        mkt_closed: bool */
     int bid_volume;
     int ask_volume;
-    QueryTransactedVolResponseMsg(std::string symbol, bool mkt_closed, int bid_volume, int ask_volume)
-    : QueryResponseMsg(symbol, mkt_closed), bid_volume(bid_volume), ask_volume(ask_volume) {}
+    QueryTransactedVolResponseMsg(SymbolId symbol, bool mkt_closed, int bid_volume, int ask_volume)
+    : QueryResponseMsg(symbol, mkt_closed), bid_volume(bid_volume), ask_volume(ask_volume) {
+        type_id = messageTypeId<QueryTransactedVolResponseMsg>();
+    }
 
     std::string getName() const override {
         return "QueryTransactedVolResponseMsg";
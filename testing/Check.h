@@ -0,0 +1,25 @@
+#pragma once
+#include <iostream>
+
+/* Minimal assertion helpers shared by the tests in testing/.  A failed CHECK reports
+   its location and the test carries on; finishTests() turns the count into the exit
+   status that `make test` looks at. */
+
+inline int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+inline int finishTests(const char* name) {
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed." << std::endl;
+        return 1;
+    }
+    std::cout << "All " << name << " tests passed." << std::endl;
+    return 0;
+}
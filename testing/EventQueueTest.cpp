@@ -0,0 +1,373 @@
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "../util/queues/BinaryHeapQueue.h"
+#include "../util/queues/CalendarQueue.h"
+#include "../util/queues/TimerWheel.h"
+#include "Check.h"
+
+/* Randomised equivalence of CalendarQueue and TimerWheel against the reference
+   BinaryHeapQueue: they must yield exactly the same entries in the same (time, sequence)
+   order. */
+
+static int next_id = 0;
+
+static void pushBoth(EventQueue& calendar, EventQueue& heap, int64_t ns, uint64_t seq) {
+    QueueEntry entry(Timestamp(static_cast<long long>(ns)), seq, next_id++, 0, nullptr);
+    calendar.push(entry);
+    heap.push(entry);
+}
+
+static bool popBoth(EventQueue& calendar, EventQueue& heap) {
+    /*
+    Pops one entry from each queue and returns whether they agree.
+    */
+    if (calendar.size() != heap.size()) { return false; }
+    if (calendar.top().key != heap.top().key) { return false; }
+    QueueEntry a = calendar.pop();
+    QueueEntry b = heap.pop();
+    return a.key == b.key && a.senderId == b.senderId;
+}
+
+static void drainBoth(EventQueue& calendar, EventQueue& heap) {
+    while (!heap.empty()) {
+        if (!popBoth(calendar, heap)) {
+            CHECK(false);
+            return;
+        }
+    }
+    CHECK(calendar.empty());
+}
+
+
+static void testDenseForward(uint32_t seed) {
+    /*
+    Simulation-like traffic: pops advance the clock and pushes land a little ahead of it,
+    with many ties.  The queue grows to thousands of entries and shrinks back, so the
+    bucket count is resized both ways and the day width re-estimated.
+    */
+    std::mt19937_64 rng(seed);
+    CalendarQueue calendar(1000);
+    BinaryHeapQueue heap;
+    int64_t now = 0;
+    uint64_t seq = 0;
+    bool ok = true;
+
+    for (int phase = 0; phase < 6 && ok; phase++) {
+        double push_bias = phase % 2 == 0 ? 0.7 : 0.3;
+        for (int step = 0; step < 20000 && ok; step++) {
+            if (heap.empty() || std::uniform_real_distribution<double>(0, 1)(rng) < push_bias) {
+                int64_t delay = rng() % 4 == 0 ? 0 : static_cast<int64_t>(rng() % 5000);
+                pushBoth(calendar, heap, now + delay, seq++);
+            }
+            else {
+                now = queueKeyNanos(heap.top().key);
+                ok = popBoth(calendar, heap);
+            }
+        }
+    }
+    CHECK(ok);
+    drainBoth(calendar, heap);
+}
+
+
+static void testSparseAndOutOfOrder(uint32_t seed) {
+    /*
+    Gaps far wider than a calendar year force the direct search for the minimum, and
+    pushes earlier than the current scan position move the scan back.
+    */
+    std::mt19937_64 rng(seed);
+    CalendarQueue calendar(10);
+    BinaryHeapQueue heap;
+    uint64_t seq = 0;
+    bool ok = true;
+
+    for (int step = 0; step < 50000 && ok; step++) {
+        uint64_t r = rng() % 10;
+        if (r < 5) {
+            int64_t ns;
+            if (r == 0) { ns = static_cast<int64_t>(rng() % 1000000000000ull); }   // Years away.
+            else if (r == 1) { ns = static_cast<int64_t>(rng() % 1000); }          // Far in the past.
+            else { ns = static_cast<int64_t>(rng() % 100000); }
+            pushBoth(calendar, heap, ns, seq++);
+        }
+        else if (!heap.empty()) {
+            ok = popBoth(calendar, heap);
+        }
+    }
+    CHECK(ok);
+    drainBoth(calendar, heap);
+}
+
+
+static void testTiesBreakOnSequence() {
+    /*
+    Entries at the same nanosecond come out by sequence number whatever order they were
+    pushed in, including sequence numbers that use the whole 64 bits.
+    */
+    CalendarQueue calendar;
+    BinaryHeapQueue heap;
+    uint64_t seqs[] = {5, UINT64_MAX, 0, (uint64_t(7) << 32) | 3, 1, uint64_t(1) << 63};
+    for (uint64_t seq : seqs) {
+        pushBoth(calendar, heap, 4242, seq);
+        pushBoth(calendar, heap, 4241, seq);
+    }
+    uint64_t previous_time = 0;
+    uint64_t previous_seq = 0;
+    bool first = true;
+    while (!heap.empty()) {
+        QueueEntry entry = calendar.top();
+        uint64_t time = static_cast<uint64_t>(queueKeyNanos(entry.key));
+        if (!first) {
+            CHECK(time > previous_time || (time == previous_time && entry.seq() > previous_seq));
+        }
+        first = false;
+        previous_time = time;
+        previous_seq = entry.seq();
+        CHECK(popBoth(calendar, heap));
+    }
+}
+
+
+static void testLongLivedBucket() {
+    /*
+    One bucket keeps receiving entries for the following years while its earlier entries
+    are popped, so it never becomes empty.
+    */
+    CalendarQueue calendar(1000);
+    BinaryHeapQueue heap;
+    uint64_t seq = 0;
+    // Keep the queue small and the width fixed, so the year stays 16 days of 1000 ns.
+    const int64_t year = 16 * 1000;
+    for (int i = 0; i < 4; i++) { pushBoth(calendar, heap, i * year, seq++); }
+    bool ok = true;
+    for (int i = 4; i < 100000 && ok; i++) {
+        ok = popBoth(calendar, heap);
+        pushBoth(calendar, heap, i * year, seq++);
+    }
+    CHECK(ok);
+    drainBoth(calendar, heap);
+}
+
+
+struct WheelModel {
+    /*
+    Reference for a TimerWheel: a BinaryHeapQueue of every key each wakeup has been
+    given, skipping on pop the entries of wakeups since cancelled or moved.  Wakeups are
+    told apart by senderId.
+    */
+    BinaryHeapQueue heap;
+    std::unordered_map<int, QueueKey> pending;
+
+    void push(const QueueEntry& entry) {
+        heap.push(entry);
+        pending[entry.senderId] = entry.key;
+    }
+
+    void cancel(int id) {
+        pending.erase(id);
+    }
+
+    bool empty() {
+        while (!heap.empty()) {
+            auto it = pending.find(heap.top().senderId);
+            if (it != pending.end() && it->second == heap.top().key) { return false; }
+            heap.pop();
+        }
+        return true;
+    }
+
+    QueueEntry pop() {
+        empty();
+        QueueEntry entry = heap.pop();
+        pending.erase(entry.senderId);
+        return entry;
+    }
+};
+
+
+static int64_t wheelDelay(std::mt19937_64& rng) {
+    // Mostly near the clock, sometimes anywhere in the wheel's 2^36 ticks (2^46 ns) and
+    // sometimes past them.
+    switch (rng() % 8) {
+        case 0: return 0;
+        case 1: return static_cast<int64_t>(rng() % (uint64_t(1) << 30));
+        case 2: return static_cast<int64_t>(rng() % (uint64_t(1) << 46));
+        case 3: return (int64_t(1) << 46) + static_cast<int64_t>(rng() % (uint64_t(1) << 47));
+        default: return static_cast<int64_t>(rng() % 20000);
+    }
+}
+
+
+static void testTimerWheelRandom(uint32_t seed) {
+    /*
+    Random pushes, cancels, reschedules, pops and defers (as the Kernel does for a busy
+    agent), with the clock following the pops.  Handles of fired or cancelled wakeups
+    must be rejected, as must cancelling or moving a wakeup while it is firing.
+    */
+    std::mt19937_64 rng(seed);
+    TimerWheel wheel;
+    WheelModel model;
+    std::vector<WakeupHandle> handles;      // By wakeup id.
+    std::vector<int> live;                  // Ids of pending wakeups.
+    std::vector<std::size_t> live_pos;      // By wakeup id.
+    std::vector<WakeupHandle> stale;
+    int64_t now = 0;
+    uint64_t seq = 0;
+    bool ok = true;
+
+    auto removeLive = [&](int id) {
+        live[live_pos[id]] = live.back();
+        live_pos[live.back()] = live_pos[id];
+        live.pop_back();
+    };
+
+    for (int step = 0; step < 60000 && ok; step++) {
+        int op = static_cast<int>(rng() % 10);
+        if (op < 4 || live.empty()) {
+            int id = static_cast<int>(handles.size());
+            QueueEntry entry(Timestamp(static_cast<long long>(now + wheelDelay(rng))), seq++, id, 0, nullptr);
+            handles.push_back(wheel.push(entry));
+            model.push(entry);
+            live_pos.push_back(live.size());
+            live.push_back(id);
+        }
+        else if (op == 4) {
+            int id = live[rng() % live.size()];
+            QueueEntry cancelled;
+            ok = wheel.cancel(handles[id], cancelled) && cancelled.senderId == id;
+            model.cancel(id);
+            removeLive(id);
+            stale.push_back(handles[id]);
+        }
+        else if (op == 5) {
+            int id = live[rng() % live.size()];
+            QueueEntry entry(Timestamp(static_cast<long long>(now + wheelDelay(rng))), seq++, id, 0, nullptr);
+            ok = wheel.reschedule(handles[id], entry.key);
+            model.push(entry);
+        }
+        else {
+            if (model.empty()) { continue; }
+            ok = wheel.size() == model.pending.size() && wheel.top().key == model.heap.top().key;
+            WakeupHandle handle;
+            QueueEntry fired = wheel.pop(handle);
+            QueueEntry expected = model.pop();
+            ok = ok && fired.key == expected.key && fired.senderId == expected.senderId;
+            now = queueKeyNanos(fired.key);
+
+            // A firing wakeup can be neither cancelled nor moved.
+            QueueEntry cancelled;
+            ok = ok && !wheel.cancel(handle, cancelled) && !wheel.reschedule(handle, fired.key);
+
+            int id = fired.senderId;
+            if (rng() % 4 == 0) {
+                QueueEntry entry(Timestamp(static_cast<long long>(now + wheelDelay(rng))), seq++, id, 0, nullptr);
+                wheel.defer(handle, entry.key);
+                model.push(entry);
+            }
+            else {
+                wheel.finish(handle);
+                removeLive(id);
+                stale.push_back(handle);
+            }
+        }
+
+        if (!stale.empty() && rng() % 4 == 0) {
+            WakeupHandle handle = stale[rng() % stale.size()];
+            QueueEntry cancelled;
+            ok = ok && wheel.find(handle) == nullptr && !wheel.cancel(handle, cancelled)
+                 && !wheel.reschedule(handle, makeQueueKey(Timestamp(static_cast<long long>(now)), seq++));
+        }
+    }
+    CHECK(ok);
+
+    while (ok && !model.empty()) {
+        WakeupHandle handle;
+        QueueEntry fired = wheel.pop(handle);
+        QueueEntry expected = model.pop();
+        ok = fired.key == expected.key && fired.senderId == expected.senderId;
+        wheel.finish(handle);
+    }
+    CHECK(ok);
+    CHECK(wheel.empty());
+}
+
+
+static void testTimerWheelFarJumps() {
+    /*
+    Wakeups only ever more than 2^36 ticks apart, so each one waits in the overflow heap
+    and the wheel jumps to it once everything before has fired.  Some are moved between
+    the overflow and the wheel before they fire.
+    */
+    TimerWheel wheel;
+    WheelModel model;
+    const int64_t far = int64_t(1) << 47;
+    std::vector<WakeupHandle> handles;
+    uint64_t seq = 0;
+    for (int i = 0; i < 64; i++) {
+        QueueEntry entry(Timestamp(static_cast<long long>((64 - i) * far + i)), seq++, i, 0, nullptr);
+        handles.push_back(wheel.push(entry));
+        model.push(entry);
+    }
+    for (int i = 0; i < 64; i += 3) {
+        QueueEntry entry(Timestamp(static_cast<long long>(i * 1000)), seq++, i, 0, nullptr);
+        CHECK(wheel.reschedule(handles[i], entry.key));
+        model.push(entry);
+    }
+    QueueEntry cancelled;
+    CHECK(wheel.cancel(handles[1], cancelled) && cancelled.senderId == 1);
+    model.cancel(1);
+    CHECK(!wheel.cancel(handles[1], cancelled));
+
+    bool ok = true;
+    while (ok && !model.empty()) {
+        WakeupHandle handle;
+        QueueEntry fired = wheel.pop(handle);
+        QueueEntry expected = model.pop();
+        ok = fired.key == expected.key && fired.senderId == expected.senderId;
+        wheel.finish(handle);
+    }
+    CHECK(ok);
+    CHECK(wheel.empty());
+}
+
+
+static void testTimerWheelReusedNode() {
+    /*
+    A handle stays stale after its node is reused for a new wakeup, and clear()
+    invalidates every handle.
+    */
+    TimerWheel wheel;
+    WakeupHandle first = wheel.push(QueueEntry(Timestamp(5000ll), 0, 1, 0, nullptr));
+    WakeupHandle fired;
+    wheel.pop(fired);
+    wheel.finish(fired);
+
+    WakeupHandle second = wheel.push(QueueEntry(Timestamp(9000ll), 1, 2, 0, nullptr));
+    CHECK(second.index == first.index && second.generation != first.generation);
+    QueueEntry cancelled;
+    CHECK(wheel.find(first) == nullptr);
+    CHECK(!wheel.cancel(first, cancelled));
+    CHECK(!wheel.reschedule(first, makeQueueKey(Timestamp(1ll), 2)));
+    CHECK(wheel.find(second) != nullptr && wheel.find(second)->senderId == 2);
+    CHECK(wheel.size() == 1 && queueKeyNanos(wheel.top().key) == 9000);
+
+    wheel.clear();
+    CHECK(wheel.empty() && wheel.find(second) == nullptr);
+}
+
+int main() {
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        testDenseForward(seed);
+        testSparseAndOutOfOrder(seed);
+    }
+    testTiesBreakOnSequence();
+    testLongLivedBucket();
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        testTimerWheelRandom(seed);
+    }
+    testTimerWheelFarJumps();
+    testTimerWheelReusedNode();
+    return finishTests("event queue");
+}
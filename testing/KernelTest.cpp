@@ -0,0 +1,733 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "../BatchRunner.h"
+#include "../Kernel.h"
+#include "../agents/ExchangeAgent.h"
+#include "../message/market_data.h"
+#include "../message/order_book.h"
+#include "../util/OrderBook.h"
+#include "../util/oracles/SparseMeanRevertingOracle.h"
+#include "../util/util.h"
+#include "Check.h"
+
+/* Whole-simulation tests of the Kernel's run modes: a run must give the same results
+   whatever the number of logical processes, batched delivery must match delivering
+   messages one by one, a BatchRunner's results must not depend on its threads, and an
+   exchange must share one snapshot among the subscribers of a depth.  Run with
+   `make test`; exits non-zero if any check fails. */
+
+static const int64_t STOP_NS = 1000000;
+
+// One message or fill as seen by an agent: (time, sender, type, order id, quantity, price).
+typedef std::tuple<int64_t, int, int, OrderId, int, int> Seen;
+
+
+class TestExchange : public ExchangeAgent {
+    /*
+    An exchange that matches the orders it is sent in its order book.  There is no order
+    submission message yet, so traders submit a LimitOrder in an OrderAcceptedMsg.
+    */
+
+public:
+    std::vector<Seen> seen;
+
+    TestExchange(int id, Logger& logger)
+        : ExchangeAgent(id, Timestamp(0ll), Timestamp(STOP_NS), std::vector<std::string>{"TEST"}, logger, "exchange") {}
+
+    void receiveMessage(Timestamp currentTime, int senderId, const Message* message) override {
+        ExchangeAgent::receiveMessage(currentTime, senderId, message);
+        if (message->type_id != messageTypeId<OrderAcceptedMsg>()) { return; }
+
+        const LimitOrder& order = static_cast<const OrderAcceptedMsg*>(message)->order;
+        seen.emplace_back(currentTime.to_nanoseconds(), senderId, message->type_id,
+                          order.order_id.value(), order.quantity, order.limit_price);
+        getOrderBook(order.symbol)->handleLimitOrder(order);
+    }
+};
+
+
+class TestTrader : public Agent {
+    /*
+    Wakes at random intervals and sends the exchange (agent 0) a limit order near the
+    fundamental, half of them inserted by order id, and records every reply.
+    */
+
+    SymbolId symbol;
+    OracleCursor cursor;
+
+public:
+    std::vector<Seen> seen;
+
+    TestTrader(int id, Logger& logger, int random_state = 7)
+        : Agent(id, "trader_" + std::to_string(id), "TestTrader", random_state, logger, false),
+          symbol(SymbolTable::intern("TEST")) {}
+
+    void wakeup(Timestamp currentTime) override {
+        Agent::wakeup(currentTime);
+
+        Side side(random.uniformInt(0, 1) == 1 ? Side::Type::BID : Side::Type::ASK);
+        int price = kernel->oracle->observePrice(symbol, currentTime, 0, random, cursor) + random.uniformInt(-5, 5);
+        LimitOrder order(id, currentTime, symbol, random.uniformInt(1, 20), side,
+                         price, false, false, random.uniformInt(0, 1) == 1);
+        emplaceMessage<OrderAcceptedMsg>(0, 0, order);
+        setWakeup(currentTime + random.uniformInt(1, 4000));
+    }
+
+    void receiveMessage(Timestamp currentTime, int senderId, const Message* message) override {
+        Agent::receiveMessage(currentTime, senderId, message);
+        if (message->type_id == messageTypeId<OrderExecutedMsg>()) {
+            const Order& order = static_cast<const OrderExecutedMsg*>(message)->order;
+            seen.emplace_back(currentTime.to_nanoseconds(), senderId, message->type_id,
+                              order.order_id.value(), order.quantity, order.fill_price);
+        }
+        else if (message->type_id == messageTypeId<OrderAcceptedMsg>()) {
+            const LimitOrder& order = static_cast<const OrderAcceptedMsg*>(message)->order;
+            seen.emplace_back(currentTime.to_nanoseconds(), senderId, message->type_id,
+                              order.order_id.value(), order.quantity, order.limit_price);
+        }
+    }
+};
+
+
+class TestChatter : public Agent {
+    /*
+    Wakes every 100 ns and sends a plain Message to a few random agents, recording each
+    wakeup and message it gets.  With `batches` set it takes its messages in batches
+    (see Agent::receivesBatches) and also records each batch.  With `echo` set it instead
+    sends one message to itself on waking and one more per message it gets, up to
+    `echo` messages in all.
+    */
+
+    bool batches;
+    int n_agents;
+    int echo;
+    int sent = 0;
+    bool in_batch = false;
+
+public:
+    std::vector<std::pair<int64_t, int>> seen;                  // (time, sender); -1 for a wakeup.
+    std::vector<std::pair<int64_t, std::size_t>> batches_seen;  // (time, messages).
+    std::vector<std::pair<int64_t, std::size_t>> activations;   // (time, messages) per wakeup, batch or lone message.
+
+    TestChatter(int id, Logger& logger, bool batches, int n_agents, int echo = 0)
+        : Agent(id, "chatter_" + std::to_string(id), "TestChatter", 11, logger, false),
+          batches(batches), n_agents(n_agents), echo(echo) {}
+
+    bool receivesBatches() const override { return batches; }
+
+    void wakeup(Timestamp currentTime) override {
+        Agent::wakeup(currentTime);
+        seen.emplace_back(currentTime.to_nanoseconds(), -1);
+        activations.emplace_back(currentTime.to_nanoseconds(), 0);
+
+        if (echo > 0) {
+            if (sent == 0) { sendEcho(); }
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            emplaceMessage<Message>(random.uniformInt(0, n_agents - 1), 0);
+        }
+        setWakeup(currentTime + 100);
+    }
+
+    void receiveMessages(Timestamp currentTime, MessageBatch messages) override {
+        batches_seen.emplace_back(currentTime.to_nanoseconds(), messages.size());
+        activations.emplace_back(currentTime.to_nanoseconds(), messages.size());
+        in_batch = true;
+        Agent::receiveMessages(currentTime, messages);
+        in_batch = false;
+    }
+
+    void receiveMessage(Timestamp currentTime, int senderId, const Message* message) override {
+        Agent::receiveMessage(currentTime, senderId, message);
+        seen.emplace_back(currentTime.to_nanoseconds(), senderId);
+        if (!in_batch) { activations.emplace_back(currentTime.to_nanoseconds(), 1); }
+        if (sent > 0 && sent < echo) { sendEcho(); }
+    }
+
+    int messagesSent() const { return sent; }
+
+private:
+    void sendEcho() {
+        emplaceMessage<Message>(id, 0);
+        sent++;
+    }
+};
+
+static SparseMeanRevertingParams fundamental() {
+    // Moves by a few cents per grid step around 1000, so traders' prices keep changing.
+    SparseMeanRevertingParams params;
+    params.r_bar = 1000;
+    params.fund_vol = 1e-4;
+    params.megashock_lambda_a = 1e-5;
+    params.megashock_mean = 20;
+    params.megashock_var = 25;
+    params.grid = 10000;
+    return params;
+}
+
+
+static void testOracleOrderIndependent() {
+    /*
+    A fundamental's value at a time must not depend on the order it is queried in.
+    */
+    SymbolId symbol = SymbolTable::intern("TEST");
+    SparseMeanRevertingOracle forward(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 3);
+    SparseMeanRevertingOracle backward(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 3);
+
+    std::vector<int64_t> times;
+    for (int64_t t = 0; t < STOP_NS; t += 3331) { times.push_back(t); }
+    times.push_back(STOP_NS + 500);
+
+    std::vector<double> values;
+    for (int64_t t : times) { values.push_back(forward.getFundamental(symbol, Timestamp(t))); }
+    bool same = true;
+    for (std::size_t i = times.size(); i-- > 0;) {
+        same = same && backward.getFundamental(symbol, Timestamp(times[i])) == values[i];
+    }
+    CHECK(same);
+
+    // Jumping about, across the oracle's checkpoints in both directions.
+    SparseMeanRevertingOracle shuffled(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 3);
+    RandomStream order(17);
+    bool same_shuffled = true;
+    for (int q = 0; q < 2000; q++) {
+        std::size_t i = static_cast<std::size_t>(order.uniformInt(0, static_cast<int>(times.size()) - 1));
+        same_shuffled = same_shuffled && shuffled.getFundamental(symbol, Timestamp(times[i])) == values[i];
+    }
+    CHECK(same_shuffled);
+    CHECK(forward.getFundamental(symbol, Timestamp(0ll)) == 1000);
+    CHECK(values.back() == forward.getFundamental(symbol, Timestamp(STOP_NS - 1)));
+
+    double low = values[0], high = values[0];
+    for (double value : values) { low = std::min(low, value); high = std::max(high, value); }
+    CHECK(high - low > 10);
+}
+
+
+static std::vector<std::vector<Seen>> runMarket(Logger& logger, int num_lps, BinaryLogger* eventLog = nullptr) {
+    /*
+    Runs one exchange and eight traders on num_lps LPs and returns what each agent saw.
+    */
+    const int n_traders = 8;
+    Kernel kernel("kernel_test", 1, logger);
+    kernel.setParallelism(num_lps);
+    kernel.setEventLog(eventLog);
+
+    AgentRegistry agents;
+    TestExchange& exchange = agents.add<TestExchange>(0, logger);
+    std::vector<TestTrader*> traders;
+    for (int i = 1; i <= n_traders; i++) {
+        traders.push_back(&agents.add<TestTrader>(i, logger));
+    }
+    SparseMeanRevertingOracle oracle(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 1);
+    kernel.runner(agents, 0, STOP_NS, 1, 1, 50, 1000, true, oracle, "testing");
+
+    std::vector<std::vector<Seen>> seen{exchange.seen};
+    for (TestTrader* trader : traders) { seen.push_back(trader->seen); }
+    return seen;
+}
+
+
+static void testParallelMatchesSequential() {
+    /*
+    The same seed on 1, 2 and 4 LPs: every agent must see the same orders, order ids and
+    fills at the same times.  Orders inserted by id make the match order depend on the
+    id values too, and prices follow the oracle, which every LP queries concurrently.
+    */
+    Logger logger("testing/kernel_test.log");
+    std::vector<std::vector<Seen>> sequential = runMarket(logger, 1);
+
+    int fills = 0;
+    for (std::size_t i = 1; i < sequential.size(); i++) {
+        for (const Seen& seen : sequential[i]) {
+            fills += std::get<2>(seen) == messageTypeId<OrderExecutedMsg>();
+        }
+    }
+    CHECK(sequential[0].size() > 1000);
+    CHECK(fills > 100);
+
+    CHECK(runMarket(logger, 2) == sequential);
+    CHECK(runMarket(logger, 4) == sequential);
+}
+
+
+static std::string marketEventLog(Logger& logger, int num_lps) {
+    /*
+    Runs runMarket with an event log and returns the log decoded.
+    */
+    const std::string path = "testing/kernel_test_events.bin";
+    {
+        BinaryLogger eventLog(path, 1 << 12, 1 << 10, BinaryLogger::OverflowPolicy::BLOCK, 4);
+        runMarket(logger, num_lps, &eventLog);
+    }
+    std::ostringstream decoded;
+    BinaryLogger::decode(path, decoded);
+    std::remove(path.c_str());
+    return decoded.str();
+}
+
+
+static void testParallelEventLog() {
+    /*
+    Each LP records its agents' events as its own producer, without locking: decoded, the
+    log of a 4 LP run must match the sequential one record for record.  An event log
+    with fewer producers than LPs is refused.
+    */
+    Logger logger("testing/kernel_test.log");
+    std::string sequential = marketEventLog(logger, 1);
+    CHECK(std::count(sequential.begin(), sequential.end(), '\n') > 10000);
+    CHECK(marketEventLog(logger, 4) == sequential);
+
+    bool refused = false;
+    try {
+        BinaryLogger eventLog("testing/kernel_test_events.bin", 1 << 12, 1 << 10, BinaryLogger::OverflowPolicy::BLOCK, 2);
+        runMarket(logger, 4, &eventLog);
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    std::remove("testing/kernel_test_events.bin");
+    CHECK(refused);
+}
+
+
+struct ChatterStats {
+    std::size_t largest_batch = 0;
+    bool busy_after_batch = false;      // Some agent acted exactly one delay after a batch of several.
+};
+
+
+static std::vector<std::vector<std::pair<int64_t, int>>> runChatter(Logger& logger, bool batches, int delay,
+                                                                    ChatterStats* stats = nullptr) {
+    /*
+    Runs 24 chatters for 100 us with the given computation delay and 1 us latency and
+    returns what each saw; if `batches` is set, those with even ids take batches.  Checks
+    that every agent is charged its computation delay once per wakeup, batch or lone
+    message, so it acts again no sooner than `delay` later.
+    */
+    const int n = 24;
+    Kernel kernel("kernel_test", 1, logger);
+    AgentRegistry agents;
+    std::vector<TestChatter*> chatters;
+    for (int i = 0; i < n; i++) {
+        chatters.push_back(&agents.add<TestChatter>(i, logger, batches && i % 2 == 0, n));
+    }
+    SparseMeanRevertingOracle oracle(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 1);
+    kernel.runner(agents, 0, 100000, 1, 1, delay, 1000, true, oracle, "testing");
+
+    std::vector<std::vector<std::pair<int64_t, int>>> seen;
+    ChatterStats found;
+    bool spaced = true;
+    for (TestChatter* chatter : chatters) {
+        seen.push_back(chatter->seen);
+        const auto& acts = chatter->activations;
+        for (std::size_t i = 0; i < acts.size(); i++) {
+            found.largest_batch = std::max(found.largest_batch, acts[i].second);
+            if (i == 0) { continue; }
+            spaced = spaced && acts[i].first - acts[i - 1].first >= delay;
+            found.busy_after_batch = found.busy_after_batch
+                || (acts[i - 1].second > 1 && acts[i].first - acts[i - 1].first == delay);
+        }
+    }
+    CHECK(spaced);
+    if (stats != nullptr) { *stats = found; }
+    return seen;
+}
+
+
+static std::vector<std::pair<int64_t, int>> coalesced(const std::vector<std::pair<int64_t, int>>& seen) {
+    /*
+    What an agent that saw `seen` with single delivery sees when it takes batches: at
+    each time, all of its messages together where the first of them was, so wakeups
+    keyed between them come after the batch.
+    */
+    std::vector<std::pair<int64_t, int>> out;
+    for (std::size_t i = 0, end = 0; i < seen.size(); i = end) {
+        while (end < seen.size() && seen[end].first == seen[i].first) { end++; }
+        bool batched = false;
+        for (std::size_t j = i; j < end; j++) {
+            if (seen[j].second < 0) {
+                out.push_back(seen[j]);
+            }
+            else if (!batched) {
+                batched = true;
+                for (std::size_t m = j; m < end; m++) {
+                    if (seen[m].second >= 0) { out.push_back(seen[m]); }
+                }
+            }
+        }
+    }
+    return out;
+}
+
+
+static void testBatchMatchesSingleDelivery() {
+    /*
+    With no computation delay, agents that take batches must see the same messages and
+    wakeups at the same times as with single delivery, in the same order but for each
+    timestamp's messages arriving together; agents that do not are unaffected.
+    */
+    Logger logger("testing/kernel_test.log");
+    ChatterStats stats;
+    std::vector<std::vector<std::pair<int64_t, int>>> single = runChatter(logger, false, 0);
+    std::vector<std::vector<std::pair<int64_t, int>>> batched = runChatter(logger, true, 0, &stats);
+    CHECK(stats.largest_batch > 1);
+
+    bool same = batched.size() == single.size();
+    bool reordered = false;
+    for (std::size_t i = 0; same && i < single.size(); i++) {
+        std::vector<std::pair<int64_t, int>> expected = i % 2 == 0 ? coalesced(single[i]) : single[i];
+        same = batched[i] == expected;
+        reordered = reordered || expected != single[i];
+    }
+    CHECK(same);
+    // Some wakeup fell between two messages due at the same time.
+    CHECK(reordered);
+}
+
+
+static void testBatchComputationDelay() {
+    /*
+    With a computation delay, a batch costs it once: runChatter checks every agent acts
+    at most once per delay, and a batching agent must be free again one delay after a
+    batch of several messages, not one delay per message.
+    */
+    Logger logger("testing/kernel_test.log");
+    ChatterStats stats;
+    runChatter(logger, false, 50);
+    runChatter(logger, true, 50, &stats);
+    CHECK(stats.largest_batch > 1);
+    CHECK(stats.busy_after_batch);
+}
+
+
+static void testBatchSameTimeSend() {
+    /*
+    With no latency or delay, a message an agent sends itself can be due at the very
+    time it is handling: it must come in a later batch at that time, not be lost or
+    delivered early.
+    */
+    Logger logger("testing/kernel_test.log");
+    Kernel kernel("kernel_test", 1, logger);
+    AgentRegistry agents;
+    TestChatter& chatter = agents.add<TestChatter>(0, logger, true, 1, 400);
+    SparseMeanRevertingOracle oracle(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 1);
+    kernel.runner(agents, 0, 100000, 1, 1, 0, 0, true, oracle, "testing");
+
+    CHECK(chatter.messagesSent() == 400);
+    CHECK(static_cast<int>(chatter.seen.size()) == 1 + 400);
+    CHECK(chatter.batches_seen.size() == 400);
+
+    bool repeated = false;
+    for (std::size_t i = 1; i < chatter.batches_seen.size(); i++) {
+        repeated = repeated || chatter.batches_seen[i].first == chatter.batches_seen[i - 1].first;
+    }
+    CHECK(repeated);
+}
+
+class KeptExchange : public TestExchange {
+    /*
+    A TestExchange that copies what it saw out to `kept` when the kernel stops, since a
+    BatchRunner destroys each simulation's agents before returning.
+    */
+
+    std::vector<Seen>& kept;
+
+public:
+    KeptExchange(int id, Logger& logger, std::vector<Seen>& kept) : TestExchange(id, logger), kept(kept) {}
+
+    void kernelStopping() override {
+        TestExchange::kernelStopping();
+        kept = seen;
+    }
+};
+
+
+// What one simulation of a batch did, beyond its custom_state.
+struct BatchTrace {
+    OrderId first_order_id = 0;     // Id of an order made by the factory, outside any agent.
+    std::vector<Seen> exchange_seen;
+};
+
+
+static std::unique_ptr<Simulation> buildMarket(const SimulationContext& ctx, std::vector<BatchTrace>& traces) {
+    /*
+    A BatchRunner factory for a short runMarket-style simulation.  It draws the traders'
+    random_states from the thread's fallback stream and makes an order with an automatic
+    id, so its results depend on the per-thread state BatchRunner resets.
+    */
+    BatchTrace& trace = traces[ctx.sim];
+    SymbolId symbol = SymbolTable::intern("TEST");
+    trace.first_order_id = LimitOrder(-1, Timestamp(0ll), symbol, 1, Side(Side::Type::BID), 1000).order_id.value();
+
+    auto s = std::make_unique<Simulation>();
+    s->logger = std::make_unique<Logger>("testing/kernel_test.log");
+    s->kernel = std::make_unique<Kernel>("kernel_test", ctx.seed, *s->logger);
+    s->agents = std::make_unique<AgentRegistry>();
+    s->agents->add<KeptExchange>(0, *s->logger, trace.exchange_seen);
+    for (int i = 1; i <= 4; i++) {
+        s->agents->add<TestTrader>(i, *s->logger, static_cast<int>(genRandUniform() * 1000000));
+    }
+    s->oracle = std::make_unique<SparseMeanRevertingOracle>(
+        Timestamp(0ll), Timestamp(STOP_NS), std::unordered_map<std::string, SparseMeanRevertingParams>{{"TEST", fundamental()}}, ctx.seed);
+    s->startTime = 0;
+    s->stopTime = STOP_NS / 4;
+    s->defaultComputationalDelay = 50;
+    s->defaultLatency = 1000;
+    return s;
+}
+
+
+static void testBatchRunnerThreads() {
+    /*
+    The same batch on 1 and 4 threads: every simulation must report the same
+    custom_state (but for its wall clock time) and see the same orders and fills, though
+    with 4 threads simulations run concurrently and after others on the same thread.
+    */
+    const int n = 8;
+    std::vector<BatchTrace> one(n), four(n);
+    BatchRunner sequential([&](const SimulationContext& ctx) { return buildMarket(ctx, one); }, 1);
+    BatchRunner threaded([&](const SimulationContext& ctx) { return buildMarket(ctx, four); }, 4);
+    std::vector<SimulationResult> expected = sequential.run(n, 5, true, "testing");
+    std::vector<SimulationResult> results = threaded.run(n, 5, true, "testing");
+
+    CHECK(results.size() == n);
+    bool same = expected.size() == n;
+    bool traded = true;
+    for (int i = 0; same && i < n; i++) {
+        same = results[i].sim == i && results[i].error.empty() && expected[i].error.empty()
+            && results[i].seed == expected[i].seed && results[i].seed == BatchRunner::simulationSeed(5, i)
+            && results[i].custom_state.erase("kernel_event_queue_elapsed_wallclock") == 1
+            && expected[i].custom_state.erase("kernel_event_queue_elapsed_wallclock") == 1
+            && results[i].custom_state == expected[i].custom_state
+            && four[i].first_order_id == 0 && one[i].first_order_id == 0
+            && four[i].exchange_seen == one[i].exchange_seen;
+        traded = traded && one[i].exchange_seen.size() > 100;
+    }
+    CHECK(same);
+    CHECK(traded);
+    // Different seeds give different simulations.
+    CHECK(one[0].exchange_seen != one[1].exchange_seen);
+}
+
+
+static void testBatchRunnerErrors() {
+    /*
+    A simulation whose factory throws, or returns an incomplete Simulation, is reported
+    through its result's error; the rest of the batch still runs.
+    */
+    std::vector<BatchTrace> traces(4);
+    BatchRunner batch([&](const SimulationContext& ctx) -> std::unique_ptr<Simulation> {
+        if (ctx.sim == 1) { throw std::runtime_error("factory failed"); }
+        if (ctx.sim == 2) { return std::make_unique<Simulation>(); }
+        return buildMarket(ctx, traces);
+    }, 2);
+    std::vector<SimulationResult> results = batch.run(4, 9, true, "testing");
+
+    CHECK(results.size() == 4);
+    CHECK(results[0].error.empty() && results[3].error.empty());
+    CHECK(results[1].error == "factory failed");
+    CHECK(!results[2].error.empty());
+    CHECK(results[3].custom_state.count("kernel_slowest_agent_finish_time") == 1);
+}
+
+
+static void testBatchRunnerAggregate() {
+    /*
+    aggregate() summarises the keys numeric in every completed simulation and skips
+    failed ones.
+    */
+    std::vector<SimulationResult> results(4);
+    results[0].custom_state = {{"fills", "1"}, {"name", "a"}, {"partial", "5"}};
+    results[1].custom_state = {{"fills", "3"}, {"name", "2"}};
+    results[2].custom_state = {{"fills", "100"}, {"name", "4"}};
+    results[2].error = "failed";
+    results[3].custom_state = {{"fills", "2.5"}, {"name", "7"}, {"partial", "1"}};
+    for (std::size_t i = 0; i < results.size(); i++) { results[i].wallclock_seconds = 2.0 * i; }
+
+    std::unordered_map<std::string, std::string> summary = BatchRunner::aggregate(results);
+    CHECK(std::abs(std::stod(summary["fills_mean"]) - 6.5 / 3) < 1e-6);
+    CHECK(std::stod(summary["fills_min"]) == 1);
+    CHECK(std::stod(summary["fills_max"]) == 3);
+    CHECK(summary.count("name_mean") == 0);
+    CHECK(summary.count("partial_mean") == 0);
+    CHECK(summary["batch_simulations"] == "4");
+    CHECK(summary["batch_failed"] == "1");
+    CHECK(std::stod(summary["batch_mean_wallclock_seconds"]) == 3);
+    CHECK(summary.size() == 6);
+}
+
+
+class PublishingExchange : public ExchangeAgent {
+    /*
+    An exchange that fills its book on its first wakeup and publishes the book's data at
+    PUBLISH_TIMES.  It registers its subscribers straight into data_subscriptions, as no
+    subscription message is handled yet, and raises its best bid just before the third
+    publication.
+    */
+
+public:
+    static constexpr int64_t PUBLISH_TIMES[4] = {2000, 3000, 4000, 8000};
+
+    PublishingExchange(int id, Logger& logger)
+        : ExchangeAgent(id, Timestamp(0ll), Timestamp(STOP_NS), std::vector<std::string>{"TEST"}, logger, "exchange") {
+        std::vector<std::unique_ptr<BaseDataSubscription>>& subs = data_subscriptions[SymbolTable::intern("TEST")];
+        subs.push_back(std::make_unique<L2DataSubscription>(1, Timestamp(0ll), 0, 3));
+        subs.push_back(std::make_unique<L2DataSubscription>(2, Timestamp(0ll), 0, 3));
+        subs.push_back(std::make_unique<L3DataSubscription>(2, Timestamp(0ll), 0, 3));
+        subs.push_back(std::make_unique<L2DataSubscription>(3, Timestamp(0ll), 0, 5));
+        subs.push_back(std::make_unique<L3DataSubscription>(4, Timestamp(0ll), 0, 3));
+        subs.push_back(std::make_unique<L1DataSubscription>(5, Timestamp(0ll), 2500));
+        subs.push_back(std::make_unique<BookImbalanceDataSubscription>(5, Timestamp(0ll), false, 0.5f));
+        subs.push_back(std::make_unique<L2DataSubscription>(6, Timestamp(0ll), 2500, 3));
+    }
+
+    void wakeup(Timestamp currentTime) override {
+        ExchangeAgent::wakeup(currentTime);
+        SymbolId symbol = SymbolTable::intern("TEST");
+        OrderBook& book = *getOrderBook(symbol);
+        int64_t now = currentTime.to_nanoseconds();
+
+        if (now < PUBLISH_TIMES[0]) {
+            for (int i = 0; i < 6; i++) {
+                book.handleLimitOrder(LimitOrder(id, currentTime, symbol, 10 + i, Side(Side::Type::BID), 9900 - i));
+            }
+        }
+        else {
+            if (now == PUBLISH_TIMES[2]) {
+                book.handleLimitOrder(LimitOrder(id, currentTime, symbol, 1, Side(Side::Type::BID), 9901));
+            }
+            publishOrderBookData(symbol);
+        }
+        for (int64_t t : PUBLISH_TIMES) {
+            if (t > now) { setWakeup(Timestamp(t)); break; }
+        }
+    }
+};
+
+
+class DataSubscriber : public Agent {
+    /*
+    Records the market data it is sent.  It never wakes.
+    */
+
+public:
+    struct Received {
+        int64_t exchange_ts;
+        int type_id;
+        std::size_t depth;                      // 0 for L1.
+        std::shared_ptr<const void> snapshot;   // Null for L1.
+        int best_bid;
+    };
+    std::vector<Received> received;
+
+    DataSubscriber(int id, Logger& logger)
+        : Agent(id, "subscriber_" + std::to_string(id), "DataSubscriber", 5, logger, false) {}
+
+    void kernelStarting(Timestamp) override {}
+
+    void receiveMessage(Timestamp currentTime, int senderId, const Message* message) override {
+        Agent::receiveMessage(currentTime, senderId, message);
+        if (message->type_id == messageTypeId<L1DataMsg>()) {
+            const L1DataMsg& msg = *static_cast<const L1DataMsg*>(message);
+            received.push_back({msg.exchange_ts.to_nanoseconds(), msg.type_id, 0, nullptr, msg.bid[0]});
+        }
+        else if (message->type_id == messageTypeId<L2DataMsg>()) {
+            const L2DataMsg& msg = *static_cast<const L2DataMsg*>(message);
+            received.push_back({msg.exchange_ts.to_nanoseconds(), msg.type_id, msg.depth(), msg.snapshot,
+                                msg.bids()[0][0]});
+        }
+        else if (message->type_id == messageTypeId<L3DataMsg>()) {
+            const L3DataMsg& msg = *static_cast<const L3DataMsg*>(message);
+            received.push_back({msg.exchange_ts.to_nanoseconds(), msg.type_id, msg.depth(), msg.snapshot,
+                                std::get<0>(msg.bids()[0])});
+        }
+    }
+
+    std::vector<Received> ofType(int type_id) const {
+        std::vector<Received> out;
+        for (const Received& r : received) {
+            if (r.type_id == type_id) { out.push_back(r); }
+        }
+        return out;
+    }
+};
+
+
+static void testPublishOrderBookData() {
+    /*
+    Subscribers of one depth must be sent the very same snapshot, which is kept while the
+    book is unchanged; other depths and L3 get their own.  A subscription is served only
+    once its frequency has elapsed, and event-based ones not at all.
+    */
+    Logger logger("testing/kernel_test.log");
+    Kernel kernel("kernel_test", 1, logger);
+    AgentRegistry agents;
+    agents.add<PublishingExchange>(0, logger);
+    std::vector<DataSubscriber*> subscribers{nullptr};
+    for (int i = 1; i <= 6; i++) {
+        subscribers.push_back(&agents.add<DataSubscriber>(i, logger));
+    }
+    SparseMeanRevertingOracle oracle(Timestamp(0ll), Timestamp(STOP_NS), {{"TEST", fundamental()}}, 1);
+    kernel.runner(agents, 0, STOP_NS, 1, 1, 0, 1000, true, oracle, "testing");
+
+    const int L1 = messageTypeId<L1DataMsg>();
+    const int L2 = messageTypeId<L2DataMsg>();
+    const int L3 = messageTypeId<L3DataMsg>();
+    std::vector<DataSubscriber::Received> a = subscribers[1]->received;
+    std::vector<DataSubscriber::Received> b = subscribers[2]->ofType(L2);
+    std::vector<DataSubscriber::Received> b3 = subscribers[2]->ofType(L3);
+    std::vector<DataSubscriber::Received> deeper = subscribers[3]->received;
+    std::vector<DataSubscriber::Received> l3 = subscribers[4]->received;
+    CHECK(a.size() == 4 && b.size() == 4 && b3.size() == 4 && deeper.size() == 4 && l3.size() == 4);
+    CHECK(subscribers[2]->received.size() == 8);
+    if (a.size() != 4 || b.size() != 4 || b3.size() != 4 || deeper.size() != 4 || l3.size() != 4) { return; }
+
+    bool shared = true, separate = true;
+    for (int i = 0; i < 4; i++) {
+        shared = shared && a[i].exchange_ts == PublishingExchange::PUBLISH_TIMES[i] && a[i].type_id == L2
+                 && a[i].depth == 3 && b[i].snapshot == a[i].snapshot && b3[i].snapshot == l3[i].snapshot;
+        separate = separate && deeper[i].depth == 5 && deeper[i].snapshot != a[i].snapshot
+                   && l3[i].type_id == L3 && l3[i].depth == 3;
+    }
+    CHECK(shared);
+    CHECK(separate);
+
+    // Unchanged between the first two publications, changed before the third.
+    CHECK(a[1].snapshot == a[0].snapshot && a[3].snapshot == a[2].snapshot);
+    CHECK(a[2].snapshot != a[1].snapshot);
+    CHECK(a[1].best_bid == 9900 && a[2].best_bid == 9901 && l3[2].best_bid == 9901);
+
+    // Every 2500 ns from time 0: skipped at 2000 and 4000.
+    std::vector<DataSubscriber::Received> l1 = subscribers[5]->received;
+    std::vector<DataSubscriber::Received> slow = subscribers[6]->received;
+    CHECK(l1.size() == 2 && slow.size() == 2);
+    if (l1.size() != 2 || slow.size() != 2) { return; }
+    CHECK(l1[0].exchange_ts == 3000 && l1[1].exchange_ts == 8000 && l1[0].type_id == L1);
+    CHECK(l1[0].best_bid == 9900 && l1[1].best_bid == 9901);
+    CHECK(slow[0].exchange_ts == 3000 && slow[1].exchange_ts == 8000);
+    CHECK(slow[0].snapshot == a[1].snapshot && slow[1].snapshot == a[3].snapshot);
+}
+
+int main() {
+    testOracleOrderIndependent();
+    testParallelMatchesSequential();
+    testParallelEventLog();
+    testBatchMatchesSingleDelivery();
+    testBatchComputationDelay();
+    testBatchSameTimeSend();
+    testBatchRunnerThreads();
+    testBatchRunnerErrors();
+    testBatchRunnerAggregate();
+    testPublishOrderBookData();
+
+    return finishTests("kernel");
+}
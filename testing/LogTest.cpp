@@ -0,0 +1,338 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../util/BinaryLogger.h"
+#include "../util/EventLog.h"
+#include "../util/SpscRingBuffer.h"
+#include "Check.h"
+
+/* Round trips through the logging pieces: the SPSC ring must hand over every record in
+   order however often it wraps, a BinaryLogger file must decode to what was recorded,
+   and an agent's EventLog file must have the layout EventLog::writeTo() describes. */
+
+static const char* LOG_PATH = "testing/log_test.bin";
+static const char* EVENT_LOG_PATH = "testing/log_test.events";
+
+static std::vector<std::string> decodeLines(const std::string& path) {
+    std::ostringstream out;
+    BinaryLogger::decode(path, out);
+    std::vector<std::string> lines;
+    std::istringstream in(out.str());
+    for (std::string line; std::getline(in, line);) { lines.push_back(line); }
+    return lines;
+}
+
+
+static void testRingWraparound() {
+    /*
+    A small ring filled and drained by uneven amounts, so head and tail wrap the slots
+    many times at different offsets: it must refuse pushes only when full and give back
+    every item in order.
+    */
+    SpscRingBuffer<int> ring(3);
+    CHECK(ring.capacity() == 4);
+    CHECK(ring.empty());
+
+    int pushed = 0, popped = 0;
+    bool in_order = true;
+    bool full_only_at_capacity = true;
+    int out[4];
+    for (int round = 0; round < 1000; round++) {
+        int want = 1 + round % 5;
+        for (int i = 0; i < want; i++) {
+            bool ok = ring.tryPush(pushed);
+            full_only_at_capacity = full_only_at_capacity && ok == (pushed - popped < 4);
+            if (ok) { pushed++; }
+        }
+        std::size_t n = ring.popBatch(out, 1 + round % 3);
+        for (std::size_t i = 0; i < n; i++) { in_order = in_order && out[i] == popped++; }
+    }
+    while (std::size_t n = ring.popBatch(out, 4)) {
+        for (std::size_t i = 0; i < n; i++) { in_order = in_order && out[i] == popped++; }
+    }
+    CHECK(in_order);
+    CHECK(full_only_at_capacity);
+    CHECK(popped == pushed && pushed > 1000);
+    CHECK(ring.empty());
+}
+
+
+static void testRingAcrossThreads() {
+    /*
+    One producer and one consumer thread through a ring much smaller than the stream.
+    */
+    const int n = 200000;
+    SpscRingBuffer<int> ring(64);
+    std::thread producer([&] {
+        for (int i = 0; i < n; i++) {
+            while (!ring.tryPush(i)) { std::this_thread::yield(); }
+        }
+    });
+
+    int next = 0;
+    bool in_order = true;
+    int out[16];
+    while (next < n) {
+        std::size_t got = ring.popBatch(out, 16);
+        for (std::size_t i = 0; i < got; i++) { in_order = in_order && out[i] == next++; }
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(ring.empty());
+}
+
+
+static void testLoggerRoundTrip() {
+    /*
+    Records from several producer threads, each through a ring small enough to wrap,
+    must all decode, sorted by (time, agent id, seq) whatever order the writer drained
+    them in.
+    */
+    const int per_thread = 5000;
+    {
+        BinaryLogger log(LOG_PATH, 8, 4, BinaryLogger::OverflowPolicy::BLOCK, 3);
+        CHECK(log.producerCount() == 3);
+        std::vector<std::thread> threads;
+        for (int p = 0; p < 3; p++) {
+            threads.emplace_back([&log, p] {
+                // Agent p's records run backwards in seq within each time.
+                for (int i = 0; i < per_thread; i++) {
+                    log.recordFrom(p, per_thread - i, Timestamp(static_cast<long long>(i / 10)), p,
+                                   LogEvent::MESSAGE_SENT, i, -i);
+                }
+            });
+        }
+        for (std::thread& thread : threads) { thread.join(); }
+        log.close();
+        CHECK(log.droppedCount() == 0);
+    }
+
+    std::vector<std::string> lines = decodeLines(LOG_PATH);
+    CHECK(lines.size() == 3 * per_thread);
+
+    std::vector<std::string> expected;
+    for (int t = 0; t < per_thread / 10; t++) {
+        for (int p = 0; p < 3; p++) {
+            for (int i = 10 * t + 9; i >= 10 * t; i--) {
+                expected.push_back(std::to_string(t) + "," + std::to_string(p) + ",MESSAGE_SENT,2,"
+                                   + std::to_string(i) + "," + std::to_string(-i));
+            }
+        }
+    }
+    CHECK(lines == expected);
+}
+
+
+static void testLoggerRecordOrder() {
+    /*
+    record() numbers its records as made, so equal times and agents keep their order;
+    kernel (agent -1) and user event codes are named.
+    */
+    {
+        BinaryLogger log(LOG_PATH);
+        log.record(Timestamp(5ll), 2, LogEvent::WAKEUP);
+        log.record(Timestamp(5ll), 2, LogEvent::MESSAGE_DELIVERED, 1, 7);
+        log.record(Timestamp(5ll), -1, LogEvent::KERNEL_STOP, 0, 12);
+        log.record(Timestamp(3ll), 2, static_cast<uint16_t>(LogEvent::USER) + 4, 9);
+    }
+    std::vector<std::string> expected{
+        "3,2,USER,1028,9,0",
+        "5,-1,KERNEL_STOP,1,0,12",
+        "5,2,WAKEUP,5,0,0",
+        "5,2,MESSAGE_DELIVERED,3,1,7",
+    };
+    CHECK(decodeLines(LOG_PATH) == expected);
+}
+
+
+static void testLoggerDrop() {
+    /*
+    With DROP, records that find their ring full are counted and lost, never blocked on;
+    the rest still decode in order.
+    */
+    const int n = 100000;
+    uint64_t dropped;
+    {
+        BinaryLogger log(LOG_PATH, 4, 4, BinaryLogger::OverflowPolicy::DROP);
+        for (int i = 0; i < n; i++) {
+            log.record(Timestamp(static_cast<long long>(i)), 0, LogEvent::WAKEUP);
+        }
+        log.close();
+        dropped = log.droppedCount();
+    }
+    std::vector<std::string> lines = decodeLines(LOG_PATH);
+    CHECK(dropped > 0);
+    CHECK(lines.size() + dropped == n);
+
+    bool increasing = true;
+    long long last = -1;
+    for (const std::string& line : lines) {
+        long long time = std::stoll(line.substr(0, line.find(',')));
+        increasing = increasing && time > last;
+        last = time;
+    }
+    CHECK(increasing);
+}
+
+
+static void testDecodeRejects() {
+    /*
+    decode() refuses files that are not binary logs of this version.
+    */
+    auto rejected = [](const std::string& contents) {
+        std::FILE* file = std::fopen(LOG_PATH, "wb");
+        std::fwrite(contents.data(), 1, contents.size(), file);
+        std::fclose(file);
+        try {
+            decodeLines(LOG_PATH);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+
+    { BinaryLogger log(LOG_PATH); }
+    std::FILE* file = std::fopen(LOG_PATH, "rb");
+    std::string header(16, '\0');
+    CHECK(std::fread(&header[0], 1, header.size(), file) == header.size());
+    std::fclose(file);
+
+    CHECK(!rejected(header));
+    CHECK(rejected(""));
+    CHECK(rejected(header.substr(0, 10)));
+    std::string version = header;
+    version[8] = 1;
+    CHECK(rejected(version));
+    std::string magic = header;
+    magic[0] = 'X';
+    CHECK(rejected(magic));
+
+    bool missing = false;
+    try {
+        decodeLines("testing/no_such_log.bin");
+    } catch (const std::runtime_error&) {
+        missing = true;
+    }
+    CHECK(missing);
+}
+
+
+class FileReader {
+    /*
+    Reads fixed-width fields and length-prefixed strings back from a file, in order.
+    */
+    std::string bytes;
+    std::size_t pos = 0;
+
+public:
+    bool overrun = false;
+
+    explicit FileReader(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        char chunk[4096];
+        std::size_t got;
+        while (file != nullptr && (got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) { bytes.append(chunk, got); }
+        if (file != nullptr) { std::fclose(file); }
+    }
+
+    template <typename T>
+    T read() {
+        T value{};
+        if (pos + sizeof(T) > bytes.size()) { overrun = true; return value; }
+        std::memcpy(&value, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> column(std::size_t n) {
+        std::vector<T> values;
+        for (std::size_t i = 0; i < n; i++) { values.push_back(read<T>()); }
+        return values;
+    }
+
+    std::string string(std::size_t len) {
+        if (pos + len > bytes.size()) { overrun = true; return ""; }
+        std::string s = bytes.substr(pos, len);
+        pos += len;
+        return s;
+    }
+
+    std::string lengthPrefixed() { return string(read<uint32_t>()); }
+
+    bool atEnd() const { return pos == bytes.size(); }
+};
+
+
+static void testEventLogLayout() {
+    /*
+    Numeric and text rows written by writeTo() read back field by field: the type names
+    in id order, the six columns, then the texts the text column points into.
+    */
+    const EventType BEST_BID = EventTypes::intern("BEST_BID");
+    const EventType NOTE = EventTypes::intern("NOTE");
+    CHECK(EventTypes::intern("BEST_BID") == BEST_BID);
+    CHECK(EventTypes::name(NOTE) == "NOTE");
+    CHECK(EventTypes::name(UINT16_MAX) == "UNKNOWN");
+
+    EventLog log;
+    log.reserve(8);
+    log.append(Timestamp(100ll), BEST_BID, 10050, 300, 7);
+    log.appendText(Timestamp(150ll), NOTE, "first note");
+    log.append(Timestamp(200ll), BEST_BID, -1, -2, -3);
+    log.appendText(Timestamp(250ll), NOTE, "");
+    CHECK(log.size() == 4);
+    log.writeTo(EVENT_LOG_PATH);
+
+    FileReader in(EVENT_LOG_PATH);
+    CHECK(in.string(8) == "ABIDESEL");
+    CHECK(in.read<uint32_t>() == 1);
+
+    uint32_t n_types = in.read<uint32_t>();
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < n_types; i++) { names.push_back(in.lengthPrefixed()); }
+    CHECK(names == EventTypes::all());
+    CHECK(names.size() > NOTE && names[BEST_BID] == "BEST_BID" && names[NOTE] == "NOTE");
+
+    CHECK(in.read<uint64_t>() == 4);
+    CHECK((in.column<int64_t>(4) == std::vector<int64_t>{100, 150, 200, 250}));
+    CHECK((in.column<uint16_t>(4) == std::vector<uint16_t>{BEST_BID, NOTE, BEST_BID, NOTE}));
+    CHECK((in.column<int64_t>(4) == std::vector<int64_t>{10050, 0, -1, 0}));
+    CHECK((in.column<int64_t>(4) == std::vector<int64_t>{300, 0, -2, 0}));
+    CHECK((in.column<int64_t>(4) == std::vector<int64_t>{7, 0, -3, 0}));
+    CHECK((in.column<int32_t>(4) == std::vector<int32_t>{-1, 0, -1, 1}));
+
+    CHECK(in.read<uint32_t>() == 2);
+    CHECK(in.lengthPrefixed() == "first note");
+    CHECK(in.lengthPrefixed() == "");
+    CHECK(!in.overrun && in.atEnd());
+
+    // An empty log is just the header, the type names and two zero counts.
+    log.clear();
+    CHECK(log.empty());
+    log.writeTo(EVENT_LOG_PATH);
+    FileReader empty(EVENT_LOG_PATH);
+    empty.string(12);
+    for (uint32_t i = empty.read<uint32_t>(); i > 0; i--) { empty.lengthPrefixed(); }
+    CHECK(empty.read<uint64_t>() == 0);
+    CHECK(empty.read<uint32_t>() == 0);
+    CHECK(!empty.overrun && empty.atEnd());
+}
+
+int main() {
+    testRingWraparound();
+    testRingAcrossThreads();
+    testLoggerRoundTrip();
+    testLoggerRecordOrder();
+    testLoggerDrop();
+    testDecodeRejects();
+    testEventLogLayout();
+    std::remove(LOG_PATH);
+    std::remove(EVENT_LOG_PATH);
+
+    return finishTests("log");
+}
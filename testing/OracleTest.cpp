@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../util/oracles/ExternalFileOracle.h"
+#include "../util/oracles/FundamentalSeries.h"
+#include "../util/oracles/FundamentalStore.h"
+#include "Check.h"
+
+/* Tests of the external fundamental data path: the binary series format and its CSV
+   import must round-trip exactly and reject malformed files, cursor lookups must agree
+   with a plain binary search whichever way the queries move, and oracles must share
+   one copy of a file while overlaying their own noise. */
+
+static const std::string CSV_PATH = "testing/oracle_test.csv";
+static const std::string BIN_PATH = "testing/oracle_test.fs";
+static const std::string OTHER_BIN_PATH = "testing/oracle_test_other.fs";
+
+static const int64_t DAY = 86400LL * 1000000000LL;
+static const int64_t AUG_25_2016 = 1472083200LL * 1000000000LL;     // 25/08/2016 00:00 UTC.
+
+static void writeFile(const std::string& path, const std::string& contents) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    std::fwrite(contents.data(), 1, contents.size(), file);
+    std::fclose(file);
+}
+
+static std::string readFile(const std::string& path) {
+    std::string contents;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    char chunk[4096];
+    std::size_t got;
+    while ((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) { contents.append(chunk, got); }
+    std::fclose(file);
+    return contents;
+}
+
+template <typename F>
+static std::string errorOf(F&& load) {
+    // The message load() throws, or "" if it does not.
+    try {
+        load();
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+static bool sameSeries(const FundamentalSeries& a, const FundamentalSeries& b) {
+    if (a.size() != b.size()) { return false; }
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a.time(i) != b.time(i) || a.value(i) != b.value(i)) { return false; }
+    }
+    return true;
+}
+
+
+static void testBinaryRoundTrip() {
+    /*
+    write() then open() gives back exactly the series written, sorted by time, with the
+    file mapped rather than copied; so does converting the sample data.
+    */
+    FundamentalSeries series({30, 10, 20, 10}, {3.0, 1.0, 2.0, 1.5});
+    CHECK(series.time(0) == 10 && series.value(0) == 1.0 && series.value(1) == 1.5);
+    CHECK(series.time(3) == 30);
+    series.write(BIN_PATH);
+
+    CHECK(FundamentalSeries::isBinary(BIN_PATH));
+    FundamentalSeries mapped = FundamentalSeries::open(BIN_PATH);
+    CHECK(sameSeries(mapped, series));
+    CHECK(mapped.times() != series.times());
+    CHECK(sameSeries(FundamentalSeries::load(BIN_PATH), series));
+
+    FundamentalSeries moved(std::move(mapped));
+    CHECK(mapped.empty() && sameSeries(moved, series));
+
+    FundamentalSeries().write(BIN_PATH);
+    FundamentalSeries empty = FundamentalSeries::open(BIN_PATH);
+    CHECK(empty.empty());
+    CHECK(std::isnan(empty.interpolate(0)));
+
+    FundamentalSeries aapl = FundamentalSeries::importCsv("data/AAPL.csv");
+    CHECK(aapl.size() > 500);
+    CHECK(aapl.time(0) == AUG_25_2016 && aapl.value(0) == -0.009330167);
+    CHECK(FundamentalSeries::convertCsv("data/AAPL.csv", BIN_PATH) == aapl.size());
+    CHECK(sameSeries(FundamentalSeries::open(BIN_PATH), aapl));
+    CHECK(!FundamentalSeries::isBinary("data/AAPL.csv"));
+}
+
+
+static void testOpenRejects() {
+    /*
+    open() refuses anything but a complete version 1 file with ascending times.
+    */
+    FundamentalSeries({10, 20, 30}, {1.0, 2.0, 3.0}).write(BIN_PATH);
+    const std::string good = readFile(BIN_PATH);
+    auto opened = [](const std::string& contents) {
+        writeFile(BIN_PATH, contents);
+        return errorOf([] { FundamentalSeries::open(BIN_PATH); });
+    };
+
+    CHECK(opened(good) == "");
+    CHECK(errorOf([] { FundamentalSeries::open("testing/no_such_series.fs"); }).find("Unable to open") == 0);
+    CHECK(opened(good.substr(0, 20)).find("Not a fundamental series file") == 0);
+
+    std::string magic = good;
+    magic[7] = 'X';
+    CHECK(opened(magic).find("Not a version 1") == 0);
+    std::string version = good;
+    version[8] = 2;
+    CHECK(opened(version).find("Not a version 1") == 0);
+
+    CHECK(opened(good.substr(0, good.size() - 8)).find("Truncated") == 0);
+    CHECK(opened(good + std::string(8, '\0')).find("Truncated") == 0);
+    std::string huge = good;
+    huge[23] = 0x7f;
+    CHECK(opened(huge).find("Truncated") == 0);
+
+    // Swap the first two times.
+    std::string unsorted = good;
+    std::memcpy(&unsorted[24], &good[32], 8);
+    std::memcpy(&unsorted[32], &good[24], 8);
+    CHECK(opened(unsorted).find("Fundamental series file is not sorted") == 0);
+}
+
+
+static void testCsvImport() {
+    /*
+    importCsv() skips blank lines and a header line, accepts CRLF endings and times of
+    day, sorts the points, and reports the line of anything else it cannot parse.
+    */
+    writeFile(CSV_PATH, "time,value\r\n"
+                        "26/08/2016,2.5\r\n"
+                        "\r\n"
+                        "25/08/2016 09:30:15.25,-1e-3\r\n"
+                        "25/08/2016,1\n"
+                        "25/08/2016T09:30,4  \n");
+    FundamentalSeries series = FundamentalSeries::importCsv(CSV_PATH);
+    CHECK(series.size() == 4);
+    CHECK(series.time(0) == AUG_25_2016 && series.value(0) == 1);
+    CHECK(series.time(1) == AUG_25_2016 + 34200LL * 1000000000LL && series.value(1) == 4);
+    CHECK(series.time(2) == AUG_25_2016 + 34215250000000LL && series.value(2) == -1e-3);
+    CHECK(series.time(3) == AUG_25_2016 + DAY && series.value(3) == 2.5);
+    CHECK(sameSeries(FundamentalSeries::load(CSV_PATH), series));
+
+    auto imported = [](const std::string& contents) {
+        writeFile(CSV_PATH, contents);
+        return errorOf([] { FundamentalSeries::importCsv(CSV_PATH); });
+    };
+    CHECK(imported("") == "");
+    CHECK(imported("25/08/2016,1\n26/08/2016,abc\n") == CSV_PATH + ":2: bad value");
+    CHECK(imported("25/08/2016,1\n26/08/2016,2x\n") == CSV_PATH + ":2: bad value");
+    CHECK(imported("25/08/2016,\n") == CSV_PATH + ":1: bad value");
+    CHECK(imported("time,value\n25/08/2016,1\n2016-08-26,2\n") == CSV_PATH + ":3: bad timestamp");
+    CHECK(imported("25/08/2016,1\ntime,value\n") == CSV_PATH + ":2: bad timestamp");
+    CHECK(imported("32/08/2016,1\n") == CSV_PATH + ":1: bad timestamp");
+    CHECK(imported("25/08/2016 9,1\n") == CSV_PATH + ":1: bad timestamp");
+    CHECK(imported("25/08/2016 1\n") == CSV_PATH + ":1: bad timestamp");
+    CHECK(errorOf([] { FundamentalSeries::importCsv("testing/no_such_series.csv"); }).find("Unable to open") == 0);
+}
+
+
+static FundamentalSeries randomSeries(std::mt19937_64& rng, std::size_t n) {
+    // n points with gaps of 0 (repeated times) to 99 ns, starting at 1000.
+    std::vector<int64_t> times;
+    std::vector<double> values;
+    int64_t t = 1000;
+    for (std::size_t i = 0; i < n; i++) {
+        t += rng() % 100;
+        times.push_back(t);
+        values.push_back(static_cast<double>(rng() % 10000) / 7);
+    }
+    return FundamentalSeries(std::move(times), std::move(values));
+}
+
+
+static void testCursorMatchesSearch(uint32_t seed) {
+    /*
+    Random queries through one cursor: small steps forward (resolved by stepping), long
+    jumps forward (stepping gives up and searches), steps back, repeats and times
+    outside the series.  Each must give exactly the cursorless value and leave the
+    cursor on the segment holding the time.
+    */
+    std::mt19937_64 rng(seed);
+    FundamentalSeries series = randomSeries(rng, 2000);
+    const int64_t first = series.time(0);
+    const int64_t last = series.time(series.size() - 1);
+
+    SeriesCursor cursor;
+    int64_t t = first;
+    bool same = true;
+    bool on_segment = true;
+    int steps = 0, jumps = 0, backs = 0;
+    for (int q = 0; q < 20000; q++) {
+        switch (rng() % 6) {
+            case 0: case 1: t += rng() % 200; steps++; break;
+            case 2: t += 1000 + rng() % 20000; jumps++; break;
+            case 3: t -= rng() % 2000; backs++; break;
+            case 4: break;
+            default: t = first - 500 + static_cast<int64_t>(rng() % static_cast<uint64_t>(last - first + 1000)); break;
+        }
+        if (t > last + 500) { t = first - 100; }
+
+        same = same && series.interpolate(t, cursor) == series.interpolate(t);
+        std::size_t i = cursor.index;
+        on_segment = on_segment && i < series.size()
+            && (series.time(i) <= t || i == 0)
+            && (i + 1 == series.size() || series.time(i + 1) > t);
+    }
+    CHECK(same);
+    CHECK(on_segment);
+    CHECK(steps > 0 && jumps > 0 && backs > 0);
+
+    // A cursor from a longer series is out of range here.
+    SeriesCursor stale{series.size() + 5};
+    CHECK(series.interpolate(last - 1, stale) == series.interpolate(last - 1));
+    CHECK(stale.index < series.size());
+}
+
+
+static void testCursorEdges() {
+    /*
+    Values are held flat outside the series and interpolated linearly inside, with a
+    repeated time resolving to its last point, with or without a cursor.
+    */
+    FundamentalSeries series({100, 200, 200, 300}, {1.0, 2.0, 4.0, 8.0});
+    SeriesCursor cursor;
+    CHECK(series.interpolate(0, cursor) == 1.0 && cursor.index == 0);
+    CHECK(series.interpolate(150, cursor) == 1.5 && cursor.index == 0);
+    CHECK(series.interpolate(200, cursor) == 4.0 && cursor.index == 2);
+    CHECK(series.interpolate(250, cursor) == 6.0);
+    CHECK(series.interpolate(1000, cursor) == 8.0 && cursor.index == 3);
+    CHECK(series.interpolate(199, cursor) == 1.99 && cursor.index == 0);
+    CHECK(series.interpolate(200) == 4.0);
+
+    SeriesCursor empty_cursor;
+    CHECK(std::isnan(FundamentalSeries().interpolate(5, empty_cursor)));
+}
+
+
+static void testBatchQueries() {
+    /*
+    The batch lookups, of the series and of an ExternalFileOracle with and without noise,
+    must match one query at a time, for sorted and unsorted times.
+    */
+    std::mt19937_64 rng(11);
+    auto series = std::make_shared<const FundamentalSeries>(randomSeries(rng, 500));
+    const int64_t first = series->time(0);
+    const int64_t span = series->time(series->size() - 1) - first;
+
+    std::vector<int64_t> times;
+    for (int k = 0; k < 3000; k++) { times.push_back(first - 50 + static_cast<int64_t>(rng() % (span + 100))); }
+    std::vector<int64_t> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const std::vector<int64_t>* ts : {&times, &sorted}) {
+        std::vector<double> out(ts->size());
+        SeriesCursor cursor;
+        series->interpolate(ts->data(), ts->size(), out.data(), cursor);
+        bool same = true;
+        for (std::size_t k = 0; k < ts->size(); k++) { same = same && out[k] == series->interpolate((*ts)[k]); }
+        CHECK(same);
+    }
+
+    for (double noise_sd : {0.0, 2.0}) {
+        ExternalFileOracle oracle("CURSOR", series, noise_sd, 3);
+        SymbolId symbol = SymbolTable::intern("CURSOR");
+        std::vector<Timestamp> stamps;
+        for (int64_t t : times) { stamps.push_back(Timestamp(static_cast<long long>(t))); }
+        std::vector<double> out(stamps.size());
+        SeriesCursor cursor;
+        oracle.getFundamentals(stamps.data(), stamps.size(), out.data(), cursor);
+
+        OracleCursor agent_cursor;
+        bool same = true;
+        for (std::size_t k = 0; k < stamps.size(); k++) {
+            double value = oracle.getFundamental(stamps[k]);
+            same = same && out[k] == value
+                && oracle.getFundamental(symbol, stamps[k], agent_cursor) == value
+                && oracle.getFundamental(symbol, stamps[k]) == value;
+        }
+        CHECK(same);
+    }
+}
+
+static void testStoreSharing() {
+    /*
+    Loads of one path share one series while anyone holds it, including oracles built
+    from the path; once the last owner is gone the next load reads the file again.
+    */
+    FundamentalSeries({10, 20}, {1.0, 2.0}).write(BIN_PATH);
+    {
+        std::shared_ptr<const FundamentalSeries> a = FundamentalStore::load(BIN_PATH);
+        std::shared_ptr<const FundamentalSeries> b = FundamentalStore::load(BIN_PATH);
+        ExternalFileOracle oracle("SHARED", BIN_PATH);
+        CHECK(a == b);
+        CHECK(&oracle.series() == a.get());
+        CHECK(a.use_count() == 3);
+        CHECK(a->value(0) == 1.0);
+
+        FundamentalSeries({10, 20}, {1.0, 2.0}).write(OTHER_BIN_PATH);
+        CHECK(FundamentalStore::load(OTHER_BIN_PATH) != a);
+    }
+
+    // Nothing holds the old series, so the rewritten file is what loads now.
+    FundamentalSeries({10, 20}, {5.0, 6.0}).write(BIN_PATH);
+    std::shared_ptr<const FundamentalSeries> reloaded = FundamentalStore::load(BIN_PATH);
+    CHECK(reloaded->value(0) == 5.0);
+    CHECK(FundamentalStore::load(BIN_PATH) == reloaded);
+}
+
+
+static void testNoiseOverlay() {
+    /*
+    Oracles over one shared series: noise_sd 0 gives the series itself, the same noise
+    seed the same path, and different seeds different paths, all without copying it.
+    */
+    std::mt19937_64 rng(5);
+    auto series = std::make_shared<const FundamentalSeries>(randomSeries(rng, 300));
+    ExternalFileOracle raw("NOISE", series);
+    ExternalFileOracle plain("NOISE", series, 0.0, 1);
+    ExternalFileOracle first("NOISE", series, 1.5, 1);
+    ExternalFileOracle again("NOISE", series, 1.5, 1);
+    ExternalFileOracle second("NOISE", series, 1.5, 2);
+    CHECK(&first.series() == series.get() && &second.series() == series.get());
+
+    bool raw_matches = true, same_seed = true;
+    int differ_from_raw = 0, differ_between_seeds = 0, queries = 0;
+    double sum_sq = 0;
+    for (int64_t t = series->time(0) - 20; t <= series->time(series->size() - 1) + 20; t += 7) {
+        Timestamp time(static_cast<long long>(t));
+        double value = series->interpolate(t);
+        raw_matches = raw_matches && raw.getFundamental(time) == value && plain.getFundamental(time) == value;
+        same_seed = same_seed && first.getFundamental(time) == again.getFundamental(time);
+        differ_from_raw += first.getFundamental(time) != value;
+        differ_between_seeds += first.getFundamental(time) != second.getFundamental(time);
+        sum_sq += (first.getFundamental(time) - value) * (first.getFundamental(time) - value);
+        queries++;
+    }
+    CHECK(raw_matches);
+    CHECK(same_seed);
+    CHECK(differ_from_raw == queries);
+    CHECK(differ_between_seeds == queries);
+
+    // Interpolating between points shrinks it a little, but it is of the size asked for.
+    double rms = std::sqrt(sum_sq / queries);
+    CHECK(rms > 0.75 && rms < 2.0);
+}
+
+int main() {
+    testBinaryRoundTrip();
+    testOpenRejects();
+    testCsvImport();
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        testCursorMatchesSearch(seed);
+    }
+    testCursorEdges();
+    testBatchQueries();
+    testStoreSharing();
+    testNoiseOverlay();
+    std::remove(CSV_PATH.c_str());
+    std::remove(BIN_PATH.c_str());
+    std::remove(OTHER_BIN_PATH.c_str());
+
+    return finishTests("oracle");
+}
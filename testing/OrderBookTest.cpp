@@ -0,0 +1,246 @@
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../Kernel.h"
+#include "../agents/ExchangeAgent.h"
+#include "../util/OrderBook.h"
+#include "../util/oracles/SparseMeanRevertingOracle.h"
+#include "Check.h"
+
+/* Tests of the order book data structures: PriceLevel, PriceLadder and OrderBook.
+   Run with `make test`; exits non-zero if any check fails. */
+
+static const Side BID(Side::Type::BID);
+static const Side ASK(Side::Type::ASK);
+
+static LimitOrder limit(SymbolId symbol, Side side, int price, int quantity, OrderId order_id, bool hidden = false) {
+    return LimitOrder(0, Timestamp(0ll), symbol, quantity, side, price, hidden, false, false, false, order_id);
+}
+
+static std::vector<std::pair<int, int>> l2(OrderBook& book, Side side, std::size_t depth = 100) {
+    std::vector<std::pair<int, int>> out;
+    if (side.is_bid()) { book.getL2BidData(out, depth); } else { book.getL2AskData(out, depth); }
+    return out;
+}
+
+
+static void testPriceLevelCancelModify() {
+    SymbolId symbol = SymbolTable::intern("TEST");
+    OrderNodePool pool;
+    OrderIndex index;
+    QuantityTotals side_totals;
+    PriceLevel level(pool, index, 100, BID, &side_totals);
+
+    level.addOrder(limit(symbol, BID, 100, 10, 1));
+    level.addOrder(limit(symbol, BID, 100, 20, 2));
+    level.addOrder(limit(symbol, BID, 100, 30, 3));
+    level.addOrder(limit(symbol, BID, 100, 5, 4, true));
+    CHECK(level.totalQuantity() == 60);
+    CHECK(level.hiddenQuantity() == 5);
+    CHECK(level.orderCount() == 4);
+    CHECK(side_totals.visible_quantity == 60 && side_totals.hidden_quantity == 5);
+
+    // Cancel from the middle of the queue.
+    std::optional<RestingOrder> removed = level.removeOrder(2);
+    CHECK(removed.has_value() && removed->quantity == 20);
+    CHECK(!level.removeOrder(2).has_value());
+    CHECK(level.totalQuantity() == 40);
+    CHECK(side_totals.visible_quantity == 40);
+
+    // Reducing keeps queue position; increasing moves the order to the back.
+    CHECK(level.updateOrderQuantity(1, 8));
+    CHECK(level.peek().order_id == 1);
+    CHECK(level.updateOrderQuantity(1, 50));
+    CHECK(level.peek().order_id == 3);
+    CHECK(level.totalQuantity() == 80);
+    CHECK(!level.updateOrderQuantity(1, 0));
+    CHECK(!level.updateOrderQuantity(99, 10));
+
+    // Visible orders go first, then hidden ones.
+    CHECK(level.pop().order_id == 3);
+    CHECK(level.pop().order_id == 1);
+    CHECK(level.pop().order_id == 4);
+    CHECK(level.isEmpty());
+    CHECK(side_totals.visible_quantity == 0 && side_totals.hidden_quantity == 0);
+    CHECK(side_totals.visible_count == 0 && side_totals.hidden_count == 0);
+}
+
+
+static void testPriceLadderWalkRecenter() {
+    SymbolId symbol = SymbolTable::intern("TEST");
+    OrderNodePool pool;
+    OrderIndex index;
+    PriceLadder bids(BID, 8);
+
+    // Spread well past the initial 8-tick window, so the ladder re-centres and grows.
+    int prices[] = {1000, 1003, 990, 1100, 5, 1001};
+    int id = 0;
+    for (int price : prices) {
+        bids.addOrder(pool, index, limit(symbol, BID, price, 10, id++));
+    }
+    bids.addOrder(pool, index, limit(symbol, BID, 1000, 5, id++));
+    CHECK(bids.size() == 6);
+
+    std::vector<int> walked;
+    for (PriceLevel* level = bids.best(); level != nullptr; level = bids.worse(*level)) {
+        walked.push_back(level->price);
+    }
+    CHECK((walked == std::vector<int>{1100, 1003, 1001, 1000, 990, 5}));
+
+    CHECK(bids.find(1000) != nullptr && bids.find(1000)->totalQuantity() == 15);
+    CHECK(bids.find(1002) == nullptr);
+    CHECK(bids.atOrWorse(1002) != nullptr && bids.atOrWorse(1002)->price == 1001);
+    CHECK(bids.atOrWorse(4) == nullptr);
+    CHECK(bids.depthQuantity(3) == 30);
+    CHECK(bids.quantityThrough(1000) == 45);
+    CHECK(bids.sideTotals().visible_quantity == 65);
+
+    PriceLevel* top = bids.best();
+    top->pop();
+    bids.eraseIfEmpty(*top);
+    CHECK(bids.size() == 5);
+    CHECK(bids.best()->price == 1003);
+}
+
+
+static void testPriceLadderFarPrices() {
+    SymbolId symbol = SymbolTable::intern("TEST");
+    OrderNodePool pool;
+    OrderIndex index;
+    PriceLadder bids(BID);
+    PriceLadder asks(ASK);
+
+    // The TradingAgent MKT_BUY / MKT_SELL sentinels rest next to ordinary prices
+    // without the window stretching to cover them.
+    const int MKT_BUY = std::numeric_limits<int>::max();
+    const int MKT_SELL = 0;
+    bids.addOrder(pool, index, limit(symbol, BID, 100000, 10, 1));
+    bids.addOrder(pool, index, limit(symbol, BID, MKT_BUY, 20, 2));
+    bids.addOrder(pool, index, limit(symbol, BID, MKT_SELL, 30, 3));
+    bids.addOrder(pool, index, limit(symbol, BID, 99990, 40, 4));
+    asks.addOrder(pool, index, limit(symbol, ASK, MKT_BUY, 5, 5));
+    asks.addOrder(pool, index, limit(symbol, ASK, 100010, 6, 6));
+    asks.addOrder(pool, index, limit(symbol, ASK, MKT_SELL, 7, 7));
+
+    std::vector<int> walked;
+    for (PriceLevel* level = bids.best(); level != nullptr; level = bids.worse(*level)) {
+        walked.push_back(level->price);
+    }
+    CHECK((walked == std::vector<int>{MKT_BUY, 100000, 99990, MKT_SELL}));
+    walked.clear();
+    for (PriceLevel* level = asks.best(); level != nullptr; level = asks.worse(*level)) {
+        walked.push_back(level->price);
+    }
+    CHECK((walked == std::vector<int>{MKT_SELL, 100010, MKT_BUY}));
+
+    CHECK(bids.find(MKT_BUY) != nullptr && bids.find(MKT_BUY)->totalQuantity() == 20);
+    CHECK(bids.atOrWorse(99995)->price == 99990);
+    CHECK(bids.atOrWorse(50000)->price == MKT_SELL);
+    CHECK(asks.atOrWorse(100011)->price == MKT_BUY);
+    CHECK(bids.quantityThrough(99990) == 70);
+    CHECK(asks.depthQuantity(2) == 13);
+
+    PriceLevel* top = bids.best();
+    top->pop();
+    bids.eraseIfEmpty(*top);
+    CHECK(bids.best()->price == 100000);
+    CHECK(bids.size() == 3);
+}
+
+
+static void testPriceToComply(OrderBook& book, SymbolId symbol) {
+    book.handleLimitOrder(limit(symbol, ASK, 10100, 50, 100));
+
+    // A price to comply bid at the ask would lock the market: it rests hidden at its
+    // limit, with a visible half one tick lower.
+    LimitOrder ptc(0, Timestamp(0ll), symbol, 10, BID, 10100, false, true, false, false, 101);
+    book.enterOrder(ptc);
+    CHECK((l2(book, BID) == std::vector<std::pair<int, int>>{{10099, 10}}));
+
+    // Selling into it executes against the hidden half and shrinks the visible half.
+    book.handleMarketOrder(MarketOrder(0, Timestamp(0ll), symbol, 4, ASK, 102));
+    CHECK((l2(book, BID) == std::vector<std::pair<int, int>>{{10099, 6}}));
+
+    // Filling the rest removes both halves.
+    book.handleMarketOrder(MarketOrder(0, Timestamp(0ll), symbol, 6, ASK, 103));
+    CHECK(l2(book, BID).empty());
+    CHECK(book.getImbalance().first == 1.0);
+    CHECK((l2(book, ASK) == std::vector<std::pair<int, int>>{{10100, 50}}));
+
+    // Clear the ask for the next test.
+    book.handleMarketOrder(MarketOrder(0, Timestamp(0ll), symbol, 50, BID, 104));
+    CHECK(l2(book, ASK).empty());
+}
+
+
+static void testRunningTotals(OrderBook& book, SymbolId symbol) {
+    book.handleLimitOrder(limit(symbol, BID, 9990, 10, 200));
+    book.handleLimitOrder(limit(symbol, BID, 9980, 20, 201));
+    book.handleLimitOrder(limit(symbol, BID, 9980, 7, 202, true));
+    book.handleLimitOrder(limit(symbol, ASK, 10010, 40, 203));
+
+    // Totals only count visible quantity: 30 bid against 40 ask.
+    std::pair<double, std::optional<Side>> imbalance = book.getImbalance();
+    CHECK(imbalance.second.has_value() && imbalance.second->is_ask());
+    CHECK(std::abs(imbalance.first - 0.25) < 1e-12);
+
+    // A marketable sell takes the whole best bid and part of the next level.
+    book.handleLimitOrder(limit(symbol, ASK, 9980, 15, 204));
+    CHECK((l2(book, BID) == std::vector<std::pair<int, int>>{{9980, 15}}));
+    CHECK(book.getLastTrade() == 9987);     // 10 @ 99.90 and 5 @ 99.80.
+
+    // The sell after that exhausts the visible bids and then fills 5 of the hidden 7.
+    book.handleLimitOrder(limit(symbol, ASK, 9980, 20, 205));
+    CHECK(l2(book, BID).empty());
+    CHECK((l2(book, ASK) == std::vector<std::pair<int, int>>{{10010, 40}}));
+    book.handleLimitOrder(limit(symbol, ASK, 9980, 3, 206));
+    CHECK((l2(book, ASK) == std::vector<std::pair<int, int>>{{9980, 1}, {10010, 40}}));
+    CHECK(book.getImbalance().second.has_value() && book.getImbalance().second->is_ask());
+}
+
+
+static void testSnapshots(OrderBook& book, SymbolId symbol) {
+    for (int i = 0; i < 5; i++) {
+        book.handleLimitOrder(limit(symbol, BID, 9900 - i, 10 + i, 300 + i));
+    }
+    std::shared_ptr<const L2Snapshot> first = book.getL2Snapshot(3);
+    CHECK(first == book.getL2Snapshot(3));
+    CHECK(first->bids->size() == 3 && (*first->bids)[0] == (L2Level{9900, 10}));
+
+    // A change beyond the shown levels keeps the side shared.
+    book.handleLimitOrder(limit(symbol, BID, 9800, 5, 310));
+    std::shared_ptr<const L2Snapshot> second = book.getL2Snapshot(3);
+    CHECK(second->bids == first->bids);
+
+    // A change within them rebuilds it.
+    book.handleLimitOrder(limit(symbol, BID, 9899, 1, 311));
+    std::shared_ptr<const L2Snapshot> third = book.getL2Snapshot(3);
+    CHECK(third->bids != first->bids);
+    CHECK((*third->bids)[1] == (L2Level{9899, 12}));
+}
+
+
+int main() {
+    testPriceLevelCancelModify();
+    testPriceLadderWalkRecenter();
+    testPriceLadderFarPrices();
+
+    // The book notifies agents through the Kernel, so run an (empty) simulation to set one up.
+    // Every test order is placed by the exchange itself, the only agent that exists.
+    Logger logger("testing/order_book_test.log");
+    Kernel kernel("order_book_test", 1, logger);
+    AgentRegistry agents;
+    ExchangeAgent& exchange = agents.add<ExchangeAgent>(
+        0, Timestamp(0ll), Timestamp(1000ll), std::vector<std::string>{"TEST"}, logger);
+    SparseMeanRevertingOracle oracle(Timestamp(0ll), Timestamp(1000ll), {{"TEST", SparseMeanRevertingParams()}}, 1);
+    kernel.runner(agents, 0, 0, 1, 1, 0, 0, true, oracle, "testing");
+
+    SymbolId symbol = SymbolTable::intern("TEST");
+    OrderBook& book = *exchange.getOrderBook(symbol);
+    testPriceToComply(book, symbol);
+    testRunningTotals(book, symbol);
+    testSnapshots(book, symbol);
+
+    return finishTests("order book");
+}
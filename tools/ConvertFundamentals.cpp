@@ -0,0 +1,28 @@
+#include <iostream>
+#include "../util/oracles/FundamentalSeries.h"
+
+/* Converts a fundamental series CSV file ("dd/mm/yyyy[ HH:MM[:SS[.fff]]],value" per line)
+   to the binary format that ExternalFileOracle memory-maps.
+
+   Usage: convert_fundamentals <csv file> <output file> */
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <csv file> <output file>" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        std::size_t n = FundamentalSeries::convertCsv(argv[1], argv[2]);
+        std::cerr << "Converted " << n << " points." << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
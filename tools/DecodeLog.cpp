@@ -0,0 +1,40 @@
+#include <iostream>
+#include <fstream>
+#include "../util/BinaryLogger.h"
+
+/* Decodes a BinaryLogger file to CSV text.
+
+   Usage: decode_log <binary log> [output file]
+   Writes to stdout if no output file is given. */
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log> [output file]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        std::size_t n;
+        if (argc == 3)
+        {
+            std::ofstream out(argv[2]);
+            out << "time,agent_id,event,code,payload0,payload1\n";
+            n = BinaryLogger::decode(argv[1], out);
+        }
+        else
+        {
+            std::cout << "time,agent_id,event,code,payload0,payload1\n";
+            n = BinaryLogger::decode(argv[1], std::cout);
+        }
+        std::cerr << "Decoded " << n << " records." << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SpscRingBuffer.h"
+#include "timestamping.h"
+
+/* Event codes for binary log records.  Codes below USER are reserved for the kernel;
+   agents may define their own from USER upwards. */
+enum class LogEvent : uint16_t {
+    KERNEL_START = 0,
+    KERNEL_STOP,
+    MESSAGE_SENT,        // payload: recipient id, message type id
+    MESSAGE_DELIVERED,   // payload: sender id, message type id
+    MESSAGE_REQUEUED,    // payload: sender id, requeued delivery time (ns)
+    WAKEUP,              // payload: unused
+    WAKEUP_REQUEUED,     // payload: requeued wakeup time (ns)
+    USER = 1024
+};
+
+inline const char* logEventName(uint16_t code) {
+    switch (static_cast<LogEvent>(code)) {
+        case LogEvent::KERNEL_START: return "KERNEL_START";
+        case LogEvent::KERNEL_STOP: return "KERNEL_STOP";
+        case LogEvent::MESSAGE_SENT: return "MESSAGE_SENT";
+        case LogEvent::MESSAGE_DELIVERED: return "MESSAGE_DELIVERED";
+        case LogEvent::MESSAGE_REQUEUED: return "MESSAGE_REQUEUED";
+        case LogEvent::WAKEUP: return "WAKEUP";
+        case LogEvent::WAKEUP_REQUEUED: return "WAKEUP_REQUEUED";
+        default: return code >= static_cast<uint16_t>(LogEvent::USER) ? "USER" : "UNKNOWN";
+    }
+}
+
+struct LogRecord {
+    int64_t time;        // Simulation time, ns since epoch.
+    int32_t agent_id;
+    uint16_t event;
+    uint16_t reserved;
+    uint64_t seq;        // Orders the records of one agent at one time (see recordFrom).
+    int64_t payload[2];
+};
+
+
+class BinaryLogger {
+    /*
+    Asynchronous binary event log.
+
+    Each producer thread appends fixed-size LogRecords to its own lock-free SPSC ring
+    buffer; a background thread drains them all in large batches and writes them to disk
+    with a single fwrite per batch, so producers never touch the file or each other.
+    Should the disk fall behind far enough to fill a ring, a record either waits for
+    space (BLOCK, the default; nothing is lost) or is discarded and counted (DROP).
+
+    File layout: a 16-byte header ("ABIDESBL", format version, record size) followed by
+    raw LogRecords, in the order the writer drained them.  Use BinaryLogger::decode() (or
+    tools/DecodeLog) to render it as text, sorted by (time, agent id, seq).
+
+    Producer p's records must only be written from one thread at a time; record() writes
+    as producer 0.  A parallel Kernel needs one producer per logical process.
+    */
+
+public:
+    enum class OverflowPolicy { BLOCK, DROP };
+
+private:
+    static constexpr char MAGIC[8] = {'A', 'B', 'I', 'D', 'E', 'S', 'B', 'L'};
+    static constexpr uint32_t VERSION = 2;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+    };
+
+    struct Producer {
+        SpscRingBuffer<LogRecord> ring;
+        uint64_t next_seq = 0;      // Sequence for record(), which does not take one.
+
+        explicit Producer(std::size_t capacity) : ring(capacity) {}
+    };
+
+    std::vector<std::unique_ptr<Producer>> producers;
+    std::vector<LogRecord> batch;
+    OverflowPolicy policy;
+    std::FILE* file;
+    std::thread writer;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> dropped;
+
+    void writerLoop() {
+        while (true) {
+            // Read the flag before draining so records pushed before close() are never missed.
+            bool stop = !running.load(std::memory_order_acquire);
+            std::size_t written = 0;
+            for (auto& producer : producers) {
+                std::size_t n = producer->ring.popBatch(batch.data(), batch.size());
+                std::fwrite(batch.data(), sizeof(LogRecord), n, file);
+                written += n;
+            }
+            if (written > 0) { continue; }
+            if (stop) { break; }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        std::fflush(file);
+    }
+
+public:
+    BinaryLogger(
+        const std::string& filepath,
+        std::size_t capacity = 1 << 20,
+        std::size_t batch_size = 1 << 14,
+        OverflowPolicy policy = OverflowPolicy::BLOCK,
+        std::size_t num_producers = 1
+    ) : batch(batch_size), policy(policy), running(true), dropped(0) {
+        /*
+        Arguments:
+            filepath: Output file, truncated if it exists.
+            capacity: Ring buffer size in records per producer (rounded up to a power of two).
+            batch_size: Maximum records written per fwrite.
+            policy: What a record does when its producer's ring is full.
+            num_producers: Number of threads that may record concurrently, one ring each.
+        */
+        if (num_producers < 1) {
+            throw std::invalid_argument("BinaryLogger needs at least one producer.");
+        }
+        for (std::size_t p = 0; p < num_producers; p++) {
+            producers.emplace_back(new Producer(capacity));
+        }
+
+        file = std::fopen(filepath.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Unable to open binary log file: " + filepath);
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+        FileHeader header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.record_size = sizeof(LogRecord);
+        std::fwrite(&header, sizeof(header), 1, file);
+
+        writer = std::thread(&BinaryLogger::writerLoop, this);
+    }
+
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    ~BinaryLogger() {
+        close();
+    }
+
+    void recordFrom(std::size_t producer, uint64_t seq, const Timestamp& time, int agent_id, uint16_t event,
+                    int64_t a = 0, int64_t b = 0) {
+        /*
+        Appends a record to the given producer's ring.  seq breaks ties between records
+        with the same time and agent when decoding, so a caller that numbers each agent's
+        records gets the same decoded log however they were spread over producers.
+        */
+        LogRecord rec;
+        rec.time = time.to_nanoseconds();
+        rec.agent_id = agent_id;
+        rec.event = event;
+        rec.reserved = 0;
+        rec.seq = seq;
+        rec.payload[0] = a;
+        rec.payload[1] = b;
+
+        SpscRingBuffer<LogRecord>& ring = producers[producer]->ring;
+        while (!ring.tryPush(rec)) {
+            if (policy == OverflowPolicy::DROP) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void recordFrom(std::size_t producer, uint64_t seq, const Timestamp& time, int agent_id, LogEvent event,
+                    int64_t a = 0, int64_t b = 0) {
+        recordFrom(producer, seq, time, agent_id, static_cast<uint16_t>(event), a, b);
+    }
+
+    void record(const Timestamp& time, int agent_id, uint16_t event, int64_t a = 0, int64_t b = 0) {
+        // As producer 0, numbering records in the order they are made.
+        recordFrom(0, producers[0]->next_seq++, time, agent_id, event, a, b);
+    }
+
+    void record(const Timestamp& time, int agent_id, LogEvent event, int64_t a = 0, int64_t b = 0) {
+        record(time, agent_id, static_cast<uint16_t>(event), a, b);
+    }
+
+    void close() {
+        /*
+        Drains all pending records, stops the writer thread and closes the file.
+        */
+        if (!writer.joinable()) { return; }
+        running.store(false, std::memory_order_release);
+        writer.join();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    std::size_t producerCount() const {
+        return producers.size();
+    }
+
+    static std::size_t decode(const std::string& filepath, std::ostream& out) {
+        /*
+        Writes a binary log as text, one record per line:
+            <time ns>,<agent id>,<event name>,<event code>,<payload 0>,<payload 1>
+        Records are sorted by (time, agent id, seq), which undoes the interleaving of
+        producers, so a parallel run's log reads the same as a sequential one's.  The whole
+        log is held in memory to sort it.  Returns the number of records decoded.
+        */
+        std::FILE* in = std::fopen(filepath.c_str(), "rb");
+        if (in == nullptr) {
+            throw std::runtime_error("Unable to open binary log file: " + filepath);
+        }
+
+        FileHeader header;
+        if (std::fread(&header, sizeof(header), 1, in) != 1
+            || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+            || header.version != VERSION
+            || header.record_size != sizeof(LogRecord)) {
+            std::fclose(in);
+            throw std::runtime_error("Not a binary log file (or incompatible version): " + filepath);
+        }
+
+        std::vector<LogRecord> records;
+        std::vector<LogRecord> buf(1 << 14);
+        std::size_t n;
+        while ((n = std::fread(buf.data(), sizeof(LogRecord), buf.size(), in)) > 0) {
+            records.insert(records.end(), buf.begin(), buf.begin() + n);
+        }
+        std::fclose(in);
+
+        std::sort(records.begin(), records.end(), [](const LogRecord& x, const LogRecord& y) {
+            if (x.time != y.time) { return x.time < y.time; }
+            if (x.agent_id != y.agent_id) { return x.agent_id < y.agent_id; }
+            return x.seq < y.seq;
+        });
+        for (const LogRecord& r : records) {
+            out << r.time << ',' << r.agent_id << ',' << logEventName(r.event) << ','
+                << r.event << ',' << r.payload[0] << ',' << r.payload[1] << '\n';
+        }
+        return records.size();
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// One L2 level: (price, visible quantity).
+typedef std::array<int, 2> L2Level;
+
+// One L3 level: (price, visible order quantities in queue order).
+typedef std::tuple<int, std::vector<int>> L3Level;
+
+inline int levelPrice(const L2Level& level) { return level[0]; }
+inline int levelPrice(const L3Level& level) { return std::get<0>(level); }
+
+template <typename Level>
+struct BookSnapshot {
+    /*
+    Immutable picture of the best `depth` visible levels of each side of one order book,
+    best first.
+
+    Snapshots are built by OrderBook::getL2Snapshot / getL3Snapshot and handed out by
+    shared pointer: every subscriber of the same depth receives the same object, and a
+    side that has not changed since the previous snapshot is shared with it rather than
+    copied.  Never modify a snapshot once it has been published.
+    */
+    typedef std::vector<Level> Levels;
+
+    std::size_t depth;
+    std::shared_ptr<const Levels> bids;
+    std::shared_ptr<const Levels> asks;
+};
+
+typedef BookSnapshot<L2Level> L2Snapshot;
+typedef BookSnapshot<L3Level> L3Snapshot;
@@ -0,0 +1,181 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "timestamping.h"
+
+typedef uint16_t EventType;
+
+class EventTypes {
+    /*
+    Process-wide table of interned event type names ("BEST_BID", "ORDER_SUBMITTED", ...).
+
+    Interning takes a lock, so hot paths should intern once and keep the id:
+
+        static const EventType BEST_BID = EventTypes::intern("BEST_BID");
+    */
+
+    std::mutex mutex;
+    std::unordered_map<std::string, EventType> ids;
+    std::vector<std::string> names;
+
+    static EventTypes& instance() {
+        static EventTypes table;
+        return table;
+    }
+
+public:
+    static EventType intern(const std::string& name) {
+        EventTypes& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) { return it->second; }
+
+        if (table.names.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many distinct event types.");
+        }
+        EventType id = static_cast<EventType>(table.names.size());
+        table.ids.emplace(name, id);
+        table.names.push_back(name);
+        return id;
+    }
+
+    static std::string name(EventType id) {
+        EventTypes& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return id < table.names.size() ? table.names[id] : "UNKNOWN";
+    }
+
+    static std::vector<std::string> all() {
+        EventTypes& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.names;
+    }
+};
+
+
+class EventLog {
+    /*
+    Columnar, fixed-schema event log kept by each agent.
+
+    Every event is one row across parallel columns: time (int64 ns), type (interned
+    uint16) and three int64 numeric payload fields whose meaning depends on the type
+    (e.g. BEST_BID: price, quantity).  Logging a numeric event is a handful of stores
+    into pre-grown vectors with no string formatting.  Events that only have a textual
+    description (rare: final holdings and the like) keep the text in a side table and
+    reference it from the `text` column, which is -1 otherwise.
+
+    writeTo() dumps the columns as-is; see the file layout there.
+    */
+
+    std::vector<int64_t> time;
+    std::vector<EventType> type;
+    std::vector<int64_t> v0;
+    std::vector<int64_t> v1;
+    std::vector<int64_t> v2;
+    std::vector<int32_t> text;
+    std::vector<std::string> texts;
+
+    template <typename T>
+    static void writeColumn(std::FILE* f, const std::vector<T>& column) {
+        if (!column.empty()) { std::fwrite(column.data(), sizeof(T), column.size(), f); }
+    }
+
+    static void writeString(std::FILE* f, const std::string& s) {
+        uint32_t len = static_cast<uint32_t>(s.size());
+        std::fwrite(&len, sizeof(len), 1, f);
+        std::fwrite(s.data(), 1, len, f);
+    }
+
+public:
+    void append(const Timestamp& eventTime, EventType eventType, int64_t a = 0, int64_t b = 0, int64_t c = 0) {
+        time.push_back(eventTime.to_nanoseconds());
+        type.push_back(eventType);
+        v0.push_back(a);
+        v1.push_back(b);
+        v2.push_back(c);
+        text.push_back(-1);
+    }
+
+    void appendText(const Timestamp& eventTime, EventType eventType, std::string event) {
+        append(eventTime, eventType);
+        text.back() = static_cast<int32_t>(texts.size());
+        texts.push_back(std::move(event));
+    }
+
+    std::size_t size() const {
+        return time.size();
+    }
+
+    bool empty() const {
+        return time.empty();
+    }
+
+    void reserve(std::size_t n) {
+        time.reserve(n);
+        type.reserve(n);
+        v0.reserve(n);
+        v1.reserve(n);
+        v2.reserve(n);
+        text.reserve(n);
+    }
+
+    void clear() {
+        time.clear();
+        type.clear();
+        v0.clear();
+        v1.clear();
+        v2.clear();
+        text.clear();
+        texts.clear();
+    }
+
+    void writeTo(const std::string& filepath) const {
+        /*
+        File layout (little-endian, native widths):
+            char[8]  "ABIDESEL"
+            uint32   format version (1)
+            uint32   number of event type names N_t, then N_t strings
+            uint64   number of events N
+            int64[N] time, uint16[N] type, int64[N] v0, int64[N] v1, int64[N] v2, int32[N] text
+            uint32   number of texts N_s, then N_s strings
+        Strings are a uint32 length followed by that many bytes.  Type names are written
+        in id order so the type column can be resolved without the running process.
+        */
+        std::FILE* f = std::fopen(filepath.c_str(), "wb");
+        if (f == nullptr) {
+            throw std::runtime_error("Unable to open event log file: " + filepath);
+        }
+
+        const char magic[8] = {'A', 'B', 'I', 'D', 'E', 'S', 'E', 'L'};
+        uint32_t version = 1;
+        std::fwrite(magic, 1, sizeof(magic), f);
+        std::fwrite(&version, sizeof(version), 1, f);
+
+        std::vector<std::string> names = EventTypes::all();
+        uint32_t n_types = static_cast<uint32_t>(names.size());
+        std::fwrite(&n_types, sizeof(n_types), 1, f);
+        for (const std::string& name : names) { writeString(f, name); }
+
+        uint64_t n = time.size();
+        std::fwrite(&n, sizeof(n), 1, f);
+        writeColumn(f, time);
+        writeColumn(f, type);
+        writeColumn(f, v0);
+        writeColumn(f, v1);
+        writeColumn(f, v2);
+        writeColumn(f, text);
+
+        uint32_t n_texts = static_cast<uint32_t>(texts.size());
+        std::fwrite(&n_texts, sizeof(n_texts), 1, f);
+        for (const std::string& s : texts) { writeString(f, s); }
+
+        std::fclose(f);
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../message/Message.h"
+
+class MessagePool {
+    /*
+    Slab allocator for in-flight messages, owned by the Kernel.
+
+    Messages are constructed in place in fixed-size blocks carved from 64 KiB slabs, one
+    free list per size class (multiples of 64 bytes).  A small header in front of every
+    block records its size class, so a message can be destroyed and its block recycled
+    from just the `const Message*` held in the event queue, without knowing its concrete
+    type.  Blocks are never returned to the system until the pool is destroyed, so in
+    steady state sending a message performs no heap allocation of its own.
+
+    Messages must derive from Message through single, non-virtual inheritance (every
+    message in message/ does), so the Message subobject sits at the start of the block.
+
+    The pool is not thread-safe.  Destroying the pool does not run destructors of
+    messages that were never released.
+
+    The header also records the pool that owns the block.  A message released into
+    another pool (the parallel Kernel releases into the recipient's pool) is destroyed
+    at once, but its block is held until returnForeign() hands it back to its owner, so
+    a pool's free lists only ever hold its own blocks and each pool is only touched by
+    the thread using it.
+    */
+
+    struct alignas(alignof(std::max_align_t)) BlockHeader {
+        MessagePool* owner;
+        uint32_t size_class;
+    };
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr std::size_t GRANULE = 64;
+    static constexpr std::size_t NUM_CLASSES = 16;
+    static constexpr std::size_t SLAB_BYTES = 64 * 1024;
+    static constexpr uint32_t LARGE_CLASS = NUM_CLASSES;
+
+    FreeBlock* free_lists[NUM_CLASSES] = {};
+    std::vector<std::unique_ptr<char[]>> slabs;
+    std::size_t live = 0;
+    // Blocks of other pools whose messages were released here, awaiting returnForeign().
+    std::vector<BlockHeader*> foreign;
+
+    static constexpr uint32_t sizeClassFor(std::size_t object_bytes) {
+        return static_cast<uint32_t>((sizeof(BlockHeader) + object_bytes + GRANULE - 1) / GRANULE - 1);
+    }
+
+    void refill(uint32_t size_class) {
+        std::size_t block_bytes = (size_class + 1) * GRANULE;
+        std::size_t n_blocks = SLAB_BYTES / block_bytes;
+
+        slabs.emplace_back(new char[n_blocks * block_bytes]);
+        char* slab = slabs.back().get();
+
+        for (std::size_t i = n_blocks; i-- > 0;) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * block_bytes);
+            block->next = free_lists[size_class];
+            free_lists[size_class] = block;
+        }
+    }
+
+    void recycle(BlockHeader* header) {
+        uint32_t size_class = header->size_class;
+        live--;
+        if (size_class == LARGE_CLASS) {
+            ::operator delete(header);
+        }
+        else {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(header);
+            block->next = free_lists[size_class];
+            free_lists[size_class] = block;
+        }
+    }
+
+    void* allocate(uint32_t size_class, std::size_t object_bytes) {
+        void* block;
+        if (size_class >= NUM_CLASSES) {
+            size_class = LARGE_CLASS;
+            block = ::operator new(sizeof(BlockHeader) + object_bytes);
+        }
+        else {
+            if (free_lists[size_class] == nullptr) { refill(size_class); }
+            FreeBlock* head = free_lists[size_class];
+            free_lists[size_class] = head->next;
+            block = head;
+        }
+        static_cast<BlockHeader*>(block)->owner = this;
+        static_cast<BlockHeader*>(block)->size_class = size_class;
+        live++;
+        return static_cast<char*>(block) + sizeof(BlockHeader);
+    }
+
+public:
+    MessagePool() = default;
+    MessagePool(const MessagePool&) = delete;
+    MessagePool& operator=(const MessagePool&) = delete;
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        /*
+        Constructs a T in a pooled block.  The pool keeps ownership; hand the pointer to
+        the Kernel (which releases it after delivery) or call release() yourself.
+        */
+        static_assert(std::is_base_of<Message, T>::value, "MessagePool only holds Message subclasses.");
+        static_assert(alignof(T) <= alignof(BlockHeader), "Over-aligned messages are not supported.");
+
+        void* mem = allocate(sizeClassFor(sizeof(T)), sizeof(T));
+        return ::new (mem) T(std::forward<Args>(args)...);
+    }
+
+    void release(const Message* msg) {
+        /*
+        Destroys a message and recycles its block, or holds the block for
+        returnForeign() if another pool created the message.
+        */
+        if (msg == nullptr) { return; }
+
+        char* mem = reinterpret_cast<char*>(const_cast<Message*>(msg));
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(mem - sizeof(BlockHeader));
+
+        msg->~Message();
+
+        if (header->owner == this) {
+            recycle(header);
+        }
+        else {
+            foreign.push_back(header);
+        }
+    }
+
+    void returnForeign() {
+        /*
+        Hands the blocks of messages released here, but created by other pools, back to
+        the pools that own them.  Only call it while no other thread is using those pools
+        (the parallel Kernel does so at every window barrier).
+        */
+        for (BlockHeader* header : foreign) {
+            header->owner->recycle(header);
+        }
+        foreign.clear();
+    }
+
+    std::size_t liveCount() const {
+        return live;
+    }
+};
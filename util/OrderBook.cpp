@@ -1,55 +1,56 @@
 #include "OrderBook.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <sstream>
 #include "../message/order_book.h"
+#include "../Kernel.h"
 
-OrderBook::OrderBook(ExchangeAgent owner, std::string symbol) 
-    : owner(owner), symbol(symbol) {
+OrderBook::OrderBook(ExchangeAgent& owner, SymbolId symbol) 
+    : owner(&owner), symbol(symbol), bids(Side::Type::BID), asks(Side::Type::ASK), last_trade(0) {
     last_update_ts = owner.mkt_open;
 }
 
 void OrderBook::handleLimitOrder(LimitOrder order, bool quiet) {
     if (order.symbol != symbol) {
-        owner.logger->log(order.symbol + " order discarded. Does not match OrderBook symbol: " + symbol);
+        owner->logger->log(SymbolTable::name(order.symbol) + " order discarded. Does not match OrderBook symbol: " + SymbolTable::name(symbol));
         return;
     }
 
     if (order.quantity <= 0 || int(order.quantity) != order.quantity) {
-        owner.logger->log(order.symbol + " order discarded.Quantity (" + std::to_string(order.quantity) + ") must be a positive integer.");
+        owner->logger->log(SymbolTable::name(order.symbol) + " order discarded.Quantity (" + std::to_string(order.quantity) + ") must be a positive integer.");
         return;
     }
 
     if (order.limit_price < 0 || int(order.limit_price != order.limit_price)) {
-        owner.logger->log(order.symbol + " order discarded. Limit price (" + std::to_string(order.limit_price) + ") must be a positive integer.");
+        owner->logger->log(SymbolTable::name(order.symbol) + " order discarded. Limit price (" + std::to_string(order.limit_price) + ") must be a positive integer.");
         return;
     }
 
-    std::vector<std::tuple<int,int>> executed;
+    fills.clear();
 
     while (true) {
-        std::optional<Order> matched_order = executeOrder(order);
-
-        if (matched_order.has_value()) {
-            // Accumulate the volume and average share price of the currently executing inbound trade.
-            assert(matched_order.value().fill_price != -1);
-
-            executed.push_back(std::make_tuple(matched_order.value().quantity, matched_order.value().fill_price));
-
+        if (executeOrder(order)) {
+            // The fill has been recorded in `fills`; keep going until the order is used up.
             if (order.quantity <= 0) {
                 break;
             }
         }
         else {
             // No matching order was found, so the new order enters the order book. Notify the agent.
-            enterOrder(order, quiet=quiet);
+            enterOrder(order, quiet);
 
-            std::ostringstream oss;
-            oss << "ACCEPTED: new order " << order;
-            owner.logger->log(oss.str());
+            if (owner->logger->enabled(LogLevel::DEBUG)) {
+                std::ostringstream oss;
+                oss << "ACCEPTED: new order " << order;
+                owner->logger->log(oss.str());
+            }
 
-            owner.logger->log("SENT: notifications of order acceptance to agent " + str(order.agentID) 
-                              + " for order " + str(order.order_id));
+            LOG_DEBUG(*owner->logger, "SENT: notifications of order acceptance to agent " + str(order.agentID) 
+                              + " for order " + str(*order.order_id));
 
             if (!quiet) {
-                owner.sendMessage(order.agentID, OrderAcceptedMsg(order));
+                owner->emplaceMessage<OrderAcceptedMsg>(order.agentID, 0, order);
             }
 
             break;
@@ -57,31 +58,30 @@ void OrderBook::handleLimitOrder(LimitOrder order, bool quiet) {
     }
 
     // Now that we are done executing or accepting this order, log the new best bid and ask.
+    static const EventType BEST_BID = EventTypes::intern("BEST_BID");
+    static const EventType BEST_ASK = EventTypes::intern("BEST_ASK");
+
     if (!bids.empty()) {
-        std::ostringstream oss;
-        oss << symbol << ", " << bids[0].price << ", " << bids[0].totalQuantity();
-        owner.logEvent("BEST_BID", oss.str());
+        owner->logEvent(BEST_BID, bids.best()->price, bids.best()->totalQuantity(), symbol);
     }
 
     if (!asks.empty()) {
-        std::ostringstream oss;
-        oss << symbol << ", " << asks[0].price << ", " << asks[0].totalQuantity();
-        owner.logEvent("BEST_ASK", oss.str());
+        owner->logEvent(BEST_ASK, asks.best()->price, asks.best()->totalQuantity(), symbol);
     }
 
     // Also log the last trade (total share quantity, average share price).
-    if (!executed.empty()) {
-        int trade_qty = 0;
-        int trade_price = 0;
-
-        for (const auto& [q, p] : executed) {
-            owner.logger->log("Executed: " + str(q) + " @ " + str(p));
-            trade_qty += q;
-            trade_price += p*q;
+    if (!fills.empty()) {
+        long long trade_qty = 0;
+        long long trade_price = 0;
+
+        for (const Fill& fill : fills) {
+            LOG_DEBUG(*owner->logger, "Executed: " + str(fill.quantity) + " @ " + str(fill.price));
+            trade_qty += fill.quantity;
+            trade_price += static_cast<long long>(fill.price) * fill.quantity;
         }
 
-        int avg_price = int(round(trade_price/trade_qty));
-        owner.logger->log("Avg: " + str(trade_qty) + " @ $" + str(avg_price));
+        int avg_price = int(std::llround(double(trade_price) / trade_qty));
+        LOG_DEBUG(*owner->logger, "Avg: " + str(trade_qty) + " @ $" + str(avg_price));
 
         last_trade = avg_price;
     }
@@ -90,156 +90,313 @@ void OrderBook::handleLimitOrder(LimitOrder order, bool quiet) {
 void OrderBook::handleMarketOrder(const MarketOrder& order) {
 
     if (order.symbol != symbol) {
-        owner.logger->log(order.symbol + " order discarded. Does not match OrderBook symbol: " + symbol);
+        owner->logger->log(SymbolTable::name(order.symbol) + " order discarded. Does not match OrderBook symbol: " + SymbolTable::name(symbol));
         return;
     }
 
     if (order.quantity <= 0 || int(order.quantity) != order.quantity) {
-        owner.logger->log(symbol + " order discarded. Quantity (" + str(order.quantity) + ") must be a positive integer.");
+        owner->logger->log(SymbolTable::name(symbol) + " order discarded. Quantity (" + str(order.quantity) + ") must be a positive integer.");
         return;
     }
 
-    while (order.quantity > 0) {
-        if (executeOrder(order) == std::nullopt) {
+    fills.clear();
+
+    // The order's quantity counts down as it fills, so work on one copy of it.
+    MarketOrder remaining = order;
+    while (remaining.quantity > 0) {
+        if (!executeOrder(remaining)) {
             break;
         }
     }
 }
 
-std::optional<Order> OrderBook::executeOrder(Order order) {
-    // Track which (if any) existing order was matched with the current order.
-    std::vector<PriceLevel> book = order.side.is_bid() ? asks : bids;
+bool OrderBook::executeOrder(LimitOrder& order) {
+    return matchBest(order, &order);
+}
+
+bool OrderBook::executeOrder(MarketOrder& order) {
+    return matchBest(order, nullptr);
+}
+
+bool OrderBook::matchBest(Order& order, const LimitOrder* limit) {
+    PriceLadder& book = order.side.is_bid() ? asks : bids;
+    PriceLevel* level = book.best();
 
     // First, examine the correct side of the order book for a match.
-    if (book.empty()) {
+    if (level == nullptr) {
         // No orders on this side.
-        return std::nullopt;
-    }
-
-    else if (order.getName() == )
-
-    
-    
-
-        # First, examine the correct side of the order book for a match.
-        if len(book) == 0:
-            # No orders on this side.
-            return None
-        elif isinstance(order, LimitOrder) and not book[0].order_is_match(order):
-            # There were orders on the right side, but the prices do not overlap.
-            # Or: bid could not match with best ask, or vice versa.
-            # Or: bid offer is below the lowest asking price, or vice versa.
-            return None
-        elif order.tag in ["MR_preprocess_ADD", "MR_preprocess_REPLACE"]:
-            # if an order enters here it means it was going to execute at entry
-            # but instead it was caught by MR_preprocess_add
-            self.owner.logEvent(order.tag + "_POST_ONLY", {"order_id": order.order_id})
-            return None
-        else:
-            # There are orders on the right side, and the new order's price does fall
-            # somewhere within them.  We can/will only match against the oldest order
-            # among those with the best price.  (i.e. best price, then FIFO)
-
-            # The matched order might be only partially filled. (i.e. new order is smaller)
-            is_ptc_exec = False
-            if order.quantity >= book[0].peek()[0].quantity:
-                # Consume entire matched order.
-                matched_order, matched_order_metadata = book[0].pop()
-
-                # If the order is a part of a price to comply pair, also remove the other
-                # half of the order from the book.
-                if matched_order.is_price_to_comply:
-                    is_ptc_exec = True
-                    if matched_order_metadata["ptc_hidden"] == False:
-                        raise Exception(
-                            "Should not be executing on the visible half of a price to comply order!"
-                        )
-
-                    assert book[1].remove_order(matched_order.order_id) is not None
-
-                    if book[1].is_empty:
-                        del book[1]
-
-                # If the matched price now has no orders, remove it completely.
-                if book[0].is_empty:
-                    del book[0]
-            else:
-                # Consume only part of matched order.
-                book_order, book_order_metadata = book[0].peek()
-
-                matched_order = deepcopy(book_order)
-                matched_order.quantity = order.quantity
-
-                book_order.quantity -= matched_order.quantity
-
-                # If the order is a part of a price to comply pair, also adjust the
-                # quantity of the other half of the pair.
-                if book_order.is_price_to_comply:
-                    is_ptc_exec = True
-                    if book_order_metadata["ptc_hidden"] == False:
-                        raise Exception(
-                            "Should not be executing on the visible half of a price to comply order!"
-                        )
-
-                    book_order_metadata[
-                        "ptc_other_half"
-                    ].quantity -= matched_order.quantity
-
-            # When two limit orders are matched, they execute at the price that
-            # was being "advertised" in the order book.
-            matched_order.fill_price = matched_order.limit_price
-
-            if order.side.is_bid():
-                self.buy_transactions.append(
-                    (self.owner.current_time, matched_order.quantity)
-                )
-            else:
-                self.sell_transactions.append(
-                    (self.owner.current_time, matched_order.quantity)
-                )
-
-            self.history.append(
-                dict(
-                    time=self.owner.current_time,
-                    type="EXEC",
-                    order_id=matched_order.order_id,
-                    agent_id=matched_order.agent_id,
-                    oppos_order_id=order.order_id,
-                    oppos_agent_id=order.agent_id,
-                    side="SELL"
-                    if order.side.is_bid()
-                    else "BUY",  # by def exec if from point of view of passive order being exec
-                    quantity=matched_order.quantity,
-                    price=matched_order.limit_price if is_ptc_exec else None,
-                )
-            )
-
-            filled_order = deepcopy(order)
-            filled_order.quantity = matched_order.quantity
-            filled_order.fill_price = matched_order.fill_price
-
-            order.quantity -= filled_order.quantity
-
-            logger.debug(
-                "MATCHED: new order {} vs old order {}", filled_order, matched_order
-            )
-            logger.debug(
-                "SENT: notifications of order execution to agents {} and {} for orders {} and {}",
-                filled_order.agent_id,
-                matched_order.agent_id,
-                filled_order.order_id,
-                matched_order.order_id,
-            )
-
-            self.owner.send_message(
-                matched_order.agent_id, OrderExecutedMsg(matched_order)
-            )
-            self.owner.send_message(order.agent_id, OrderExecutedMsg(filled_order))
-
-            if self.owner.book_logging == True:
-                # append current OB state to book_log2
-                self.append_book_log2()
-
-            # Return (only the executed portion of) the matched order.
-            return matched_order
-}
\ No newline at end of file
+        return false;
+    }
+    else if (limit != nullptr && !level->orderIsMatch(*limit)) {
+        // There were orders on the right side, but the prices do not overlap.
+        // Or: bid could not match with best ask, or vice versa.
+        // Or: bid offer is below the lowest asking price, or vice versa.
+        return false;
+    }
+
+    // There are orders on the right side, and the new order's price does fall
+    // somewhere within them.  We can/will only match against the oldest order
+    // among those with the best price.  (i.e. best price, then FIFO)
+    OrderNode* node = level->front();
+    RestingOrder& book_order = node->order;
+
+    // The matched order might be only partially filled. (i.e. new order is smaller)
+    int quantity = std::min(order.quantity, book_order.quantity);
+
+    // When two limit orders are matched, they execute at the price that
+    // was being "advertised" in the order book.
+    int fill_price = book_order.price;
+
+    // If the order is a part of a price to comply pair, the other half is the visible
+    // order with the same id, one tick away; it shrinks (or goes) with this one.
+    auto ptc = book_order.isPriceToComply() ? ptc_pairs.find(book_order.order_id) : ptc_pairs.end();
+    bool is_ptc_exec = ptc != ptc_pairs.end();
+    if (is_ptc_exec) {
+        if (!book_order.isHidden()) {
+            throw std::runtime_error("Should not be executing on the visible half of a price to comply order!");
+        }
+        PriceLevel* other_level = book.find(ptc->second.visible_price);
+        assert(other_level != nullptr);
+        if (quantity == book_order.quantity) {
+            other_level->removeOrder(book_order.order_id);
+            book.eraseIfEmpty(*other_level);
+            ptc_pairs.erase(ptc);
+        }
+        else {
+            other_level->reduceQuantity(order_index.find(book_order.order_id, false), quantity);
+        }
+    }
+
+    if (order.side.is_bid()) {
+        buy_transactions.emplace_back(owner->getCurrentTime(), quantity);
+    }
+    else {
+        sell_transactions.emplace_back(owner->getCurrentTime(), quantity);
+    }
+
+    history.push_back(BookHistoryEntry{
+        owner->getCurrentTime(),
+        BookHistoryEntry::Type::EXEC,
+        book_order.order_id,
+        book_order.agent_id,
+        *order.order_id,
+        order.agentID,
+        // By definition the execution is from the point of view of the passive order.
+        book_order.side(),
+        quantity,
+        is_ptc_exec ? book_order.price : -1
+    });
+
+    fills.push_back(Fill{book_order.order_id, book_order.agent_id, quantity, fill_price});
+
+    LOG_DEBUG(*owner->logger, "MATCHED: new order " + str(*order.order_id) + " vs old order "
+                             + str(book_order.order_id) + " for " + str(quantity) + " @ " + str(fill_price));
+    LOG_DEBUG(*owner->logger, "SENT: notifications of order execution to agents " + str(order.agentID)
+                             + " and " + str(book_order.agent_id));
+
+    // Report only the executed portion of each order; the messages copy it straight
+    // into pooled storage.
+    owner->emplaceMessage<OrderExecutedMsg>(book_order.agent_id, 0, book_order, symbol, quantity, fill_price);
+    owner->emplaceMessage<OrderExecutedMsg>(order.agentID, 0, order, quantity, fill_price);
+
+    order.quantity -= quantity;
+
+    if (quantity == book_order.quantity) {
+        // Consume entire matched order.  If the price now has no orders, remove it completely.
+        level->pop();
+        book.eraseIfEmpty(*level);
+    }
+    else {
+        // Consume only part of matched order.
+        level->reduceQuantity(node, quantity);
+    }
+
+    return true;
+}
+
+void OrderBook::enterOrder(const LimitOrder& order, bool quiet) {
+    PriceLadder& same_side = order.side.is_bid() ? bids : asks;
+    PriceLadder& other_side = order.side.is_bid() ? asks : bids;
+    PriceLevel* touch = other_side.best();
+
+    auto record = [&](const LimitOrder& entered) {
+        if (quiet) { return; }
+        history.push_back(BookHistoryEntry{
+            owner->getCurrentTime(),
+            BookHistoryEntry::Type::LIMIT,
+            *entered.order_id,
+            entered.agentID,
+            -1,
+            -1,
+            entered.side,
+            entered.quantity,
+            entered.limit_price
+        });
+    };
+
+    if (order.is_price_to_comply && touch != nullptr && order.limit_price == touch->price) {
+        LimitOrder hidden_order = order;
+        hidden_order.is_hidden = true;
+
+        LimitOrder visible_order = order;
+        visible_order.limit_price += order.side.is_bid() ? -1 : 1;
+
+        same_side.addOrder(order_pool, order_index, hidden_order);
+        same_side.addOrder(order_pool, order_index, visible_order);
+        ptc_pairs[*order.order_id] = PriceToComplyPair{hidden_order.limit_price, visible_order.limit_price};
+        record(hidden_order);
+        record(visible_order);
+    }
+    else {
+        same_side.addOrder(order_pool, order_index, order);
+        record(order);
+    }
+}
+
+std::optional<std::pair<int, int>> OrderBook::getL1BidData() {
+    PriceLevel* level = bids.best();
+    if (level == nullptr) { return std::nullopt; }
+    return std::make_pair(level->price, level->totalQuantity());
+}
+
+std::optional<std::pair<int, int>> OrderBook::getL1AskData() {
+    PriceLevel* level = asks.best();
+    if (level == nullptr) { return std::nullopt; }
+    return std::make_pair(level->price, level->totalQuantity());
+}
+
+void OrderBook::getL2BidData(std::vector<std::pair<int, int>>& out, std::size_t depth) {
+    getL2Data(bids, out, depth);
+}
+
+void OrderBook::getL2AskData(std::vector<std::pair<int, int>>& out, std::size_t depth) {
+    getL2Data(asks, out, depth);
+}
+
+void OrderBook::getL2Data(PriceLadder& book, std::vector<std::pair<int, int>>& out, std::size_t depth) {
+    out.clear();
+    for (PriceLevel* level = book.best(); level != nullptr && out.size() < depth; level = book.worse(*level)) {
+        // Levels holding only hidden orders are not shown.
+        if (level->totalQuantity() > 0) {
+            out.emplace_back(level->price, level->totalQuantity());
+        }
+    }
+}
+
+static void appendLevel(std::vector<L2Level>& out, const PriceLevel& level) {
+    out.push_back(L2Level{level.price, level.totalQuantity()});
+}
+
+static void appendLevel(std::vector<L3Level>& out, const PriceLevel& level) {
+    std::vector<int> quantities;
+    quantities.reserve(level.totals.visible_count);
+    for (const OrderNode* node = level.visible_orders.head; node != nullptr; node = node->next) {
+        quantities.push_back(node->order.quantity);
+    }
+    out.emplace_back(level.price, std::move(quantities));
+}
+
+std::shared_ptr<const L2Snapshot> OrderBook::getL2Snapshot(std::size_t depth) {
+    return getSnapshot(l2_snapshots, depth);
+}
+
+std::shared_ptr<const L3Snapshot> OrderBook::getL3Snapshot(std::size_t depth) {
+    return getSnapshot(l3_snapshots, depth);
+}
+
+template <typename Level>
+std::shared_ptr<const BookSnapshot<Level>> OrderBook::getSnapshot(std::vector<SnapshotCache<Level>>& cache, std::size_t depth) {
+    // Subscribers use a handful of distinct depths, so a linear search is enough.
+    auto entry = std::find_if(cache.begin(), cache.end(),
+                              [depth](const SnapshotCache<Level>& c) { return c.depth == depth; });
+    if (entry == cache.end()) {
+        cache.push_back(SnapshotCache<Level>{depth, nullptr, 0, 0});
+        entry = cache.end() - 1;
+    }
+
+    uint64_t bids_end = bids.changes().end();
+    uint64_t asks_end = asks.changes().end();
+    if (entry->snapshot && entry->bids_seen == bids_end && entry->asks_seen == asks_end) {
+        return entry->snapshot;
+    }
+
+    std::shared_ptr<BookSnapshot<Level>> snapshot = std::make_shared<BookSnapshot<Level>>();
+    snapshot->depth = depth;
+    snapshot->bids = refreshSide<Level>(bids, entry->snapshot ? entry->snapshot->bids : nullptr, entry->bids_seen, depth);
+    snapshot->asks = refreshSide<Level>(asks, entry->snapshot ? entry->snapshot->asks : nullptr, entry->asks_seen, depth);
+
+    entry->snapshot = snapshot;
+    entry->bids_seen = bids_end;
+    entry->asks_seen = asks_end;
+    return snapshot;
+}
+
+template <typename Level>
+std::shared_ptr<const std::vector<Level>> OrderBook::refreshSide(
+    PriceLadder& book, const std::shared_ptr<const std::vector<Level>>& previous, uint64_t seen, std::size_t depth) {
+    const LevelJournal& journal = book.changes();
+    if (previous && seen == journal.end()) {
+        return previous;
+    }
+
+    // The best price touched since `previous` was built.  Without it (no previous
+    // snapshot, or the journal has moved past `seen`) the side is read in full.
+    std::optional<int> from;
+    std::size_t keep = 0;
+    if (previous && seen >= journal.base) {
+        for (std::size_t i = static_cast<std::size_t>(seen - journal.base); i < journal.prices.size(); i++) {
+            if (!from || book.better(journal.prices[i], *from)) {
+                from = journal.prices[i];
+            }
+        }
+
+        // A full side shows nothing beyond its last level, so changes past it are invisible.
+        if (previous->size() >= depth && (previous->empty() || book.better(levelPrice(previous->back()), *from))) {
+            return previous;
+        }
+
+        while (keep < previous->size() && book.better(levelPrice((*previous)[keep]), *from)) {
+            keep++;
+        }
+    }
+
+    std::shared_ptr<std::vector<Level>> levels = std::make_shared<std::vector<Level>>();
+    levels->reserve(std::min(depth, book.size()));
+    if (keep > 0) {
+        levels->insert(levels->end(), previous->begin(), previous->begin() + keep);
+    }
+
+    PriceLevel* level = from ? book.atOrWorse(*from) : book.best();
+    for (; level != nullptr && levels->size() < depth; level = book.worse(*level)) {
+        // Levels holding only hidden orders are not shown.
+        if (level->totalQuantity() > 0) {
+            appendLevel(*levels, *level);
+        }
+    }
+    return levels;
+}
+
+int OrderBook::getLastTrade() const {
+    return last_trade;
+}
+
+std::pair<double, std::optional<Side>> OrderBook::getImbalance() const {
+    long long bid_vol = bids.sideTotals().visible_quantity;
+    long long ask_vol = asks.sideTotals().visible_quantity;
+
+    if (bid_vol == ask_vol) {
+        return std::make_pair(0.0, std::nullopt);
+    }
+    else if (bid_vol == 0) {
+        return std::make_pair(1.0, Side(Side::Type::ASK));
+    }
+    else if (ask_vol == 0) {
+        return std::make_pair(1.0, Side(Side::Type::BID));
+    }
+    else if (bid_vol < ask_vol) {
+        return std::make_pair(1.0 - double(bid_vol) / ask_vol, Side(Side::Type::ASK));
+    }
+    else {
+        return std::make_pair(1.0 - double(ask_vol) / bid_vol, Side(Side::Type::BID));
+    }
+}
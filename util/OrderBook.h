@@ -2,7 +2,43 @@
 #include <set>
 #include <string>
 #include "../agents/ExchangeAgent.h"
-#include "PriceLevel.h"
+#include "BookSnapshot.h"
+#include "PriceLadder.h"
+
+struct Fill {
+    /*
+    One execution against a resting order, as recorded in OrderBook::fills.
+    */
+    OrderId order_id;   // The resting (passive) order.
+    int agent_id;
+    int quantity;
+    int price;
+};
+
+struct PriceToComplyPair {
+    /*
+    Where the two halves of a split price to comply order rest (same order id).
+    */
+    int hidden_price;
+    int visible_price;
+};
+
+struct BookHistoryEntry {
+    /*
+    One row of OrderBook::history.  Fields that do not apply to a type are -1.
+    */
+    enum class Type : uint8_t { LIMIT, EXEC, CANCEL, MODIFY, REPLACE };
+
+    Timestamp time;
+    Type type;
+    OrderId order_id;
+    int agent_id;
+    OrderId oppos_order_id;
+    int oppos_agent_id;
+    Side side;
+    int quantity;
+    int price;
+};
 
 class OrderBook {
     /*
@@ -14,24 +50,38 @@ class OrderBook {
 
     Attributes:
         owner: The agent this order book belongs to.
-        symbol: The symbol of the stock or security that is traded on this order book.
-        bids: List of bid price levels (index zero is best bid), stored as a PriceLevel object.
-        asks: List of ask price levels (index zero is best ask), stored as a PriceLevel object.
+        symbol: The interned symbol of the stock or security that is traded on this order book.
+        order_pool: Allocator for the nodes holding resting orders.
+        order_index: Map from order id to resting order node, for O(1) cancel and modify.
+        ptc_pairs: Side table of the price to comply orders currently split in two,
+            keyed by order id.  Kept out of the resting order records since it is rare.
+        bids: Bid price levels indexed by tick; bids.best() is the best bid.
+        asks: Ask price levels indexed by tick; asks.best() is the best ask.
         last_trade: The price that the last trade was made at.
         book_log: Log of the full order book depth (price and volume) each time it changes.
         book_log2: TODO
         quotes_seen: TODO
         history: A truncated history of previous trades.
+        fills: Executions produced by the order currently being handled.  Reused
+            between orders so matching does not allocate.
+        l2_snapshots, l3_snapshots: The last market data snapshot built for each
+            requested depth, and how far into each side's change journal it reflects.
         last_update_ts: The last timestamp the order book was updated.
         buy_transactions: An ordered list of all previous buy transaction timestamps and quantities.
         sell_transactions: An ordered list of all previous sell transaction timestamps and quantities.
     */
 
-    ExchangeAgent owner;
-    std::string symbol;
+    ExchangeAgent* owner;
+    SymbolId symbol;
 
-    std::vector<PriceLevel> bids;
-    std::vector<PriceLevel> asks;
+    // Resting order storage shared by all price levels; declared before the levels so
+    // it outlives them.
+    OrderNodePool order_pool;
+    OrderIndex order_index;
+    std::unordered_map<OrderId, PriceToComplyPair> ptc_pairs;
+
+    PriceLadder bids;
+    PriceLadder asks;
     int last_trade;
 
     // Create an empty list of dictionaries to log the full order book depth (price and volume) each time it changes.
@@ -39,20 +89,35 @@ class OrderBook {
     std::set<int> quotes_seen;  
 
     // Create an order history for the exchange to report to certain agent types.
-    std::vector<std::unordered_map<std::string, int>> history;
+    std::vector<BookHistoryEntry> history;
+
+    std::vector<Fill> fills;
+
+    template <typename Level>
+    struct SnapshotCache {
+        std::size_t depth;
+        std::shared_ptr<const BookSnapshot<Level>> snapshot;
+        uint64_t bids_seen;
+        uint64_t asks_seen;
+    };
+
+    std::vector<SnapshotCache<L2Level>> l2_snapshots;
+    std::vector<SnapshotCache<L3Level>> l3_snapshots;
 
     Timestamp last_update_ts;
     std::vector<std::tuple<Timestamp, int>> buy_transactions;
     std::vector<std::tuple<Timestamp, int>> sell_transactions;
 
 public:
-    OrderBook(ExchangeAgent owner, std::string symbol);
+    OrderBook(ExchangeAgent& owner, SymbolId symbol);
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
         /*
         Creates a new OrderBook class instance for a single symbol.
 
         Arguments:
             owner: The agent this order book belongs to, usually an `ExchangeAgent`.
-            symbol: The symbol of the stock or security that is traded on this order book.
+            symbol: The interned symbol of the stock or security that is traded on this order book.
         */
 
     void handleLimitOrder(LimitOrder order, bool quiet = false);
@@ -78,18 +143,95 @@ public:
             order: The market order to process.
         */
 
-    std::optional<Order> executeOrder(Order order);
+    bool executeOrder(LimitOrder& order);
+    bool executeOrder(MarketOrder& order);
         /*
         Finds a single best match for this order, without regard for quantity.
 
-        Returns the matched order or None if no match found.  DOES remove,
-        or decrement quantity from, the matched order from the order book
-        (i.e. executes at least a partial trade, if possible).
+        Returns true if a match was found.  DOES remove, or decrement quantity from,
+        the matched order in the order book (i.e. executes at least a partial trade,
+        if possible), decrements the inbound order's quantity by the amount filled,
+        appends the execution to `fills` and notifies both agents.
+
+        The match happens in place on the book: nothing is copied and, once the
+        history and fill buffers have grown to their working size, nothing is allocated.
 
         Arguments:
             order: The order to execute.
         */
 
-    
-       
+    void enterOrder(const LimitOrder& order, bool quiet = false);
+        /*
+        Enters a limit order into the order book in the correct location.
+
+        This function assumes the order is not immediately executable.  A price to
+        comply order that would lock the market is split into a hidden half at its
+        limit price and a visible half one tick less aggressive.
+
+        Arguments:
+            order: The limit order to enter into the order book.
+            quiet: If True messages will not be sent to agents and entries will not be added to
+                history. Used when this function is a part of a more complex order.
+        */
+
+    std::optional<std::pair<int, int>> getL1BidData();
+    std::optional<std::pair<int, int>> getL1AskData();
+        /*
+        Returns the (price, visible quantity) of the best bid or ask, or None if that
+        side is empty.  O(1).
+        */
+
+    void getL2BidData(std::vector<std::pair<int, int>>& out, std::size_t depth);
+    void getL2AskData(std::vector<std::pair<int, int>>& out, std::size_t depth);
+        /*
+        Fills `out` (cleared first, so it can be reused between calls) with the
+        (price, visible quantity) of up to `depth` levels, best first.  Costs one step
+        per level; quantities come from each level's running totals.
+        */
+
+    std::shared_ptr<const L2Snapshot> getL2Snapshot(std::size_t depth);
+    std::shared_ptr<const L3Snapshot> getL3Snapshot(std::size_t depth);
+        /*
+        Returns an immutable snapshot of the best `depth` visible levels of each side:
+        (price, visible quantity) for L2, (price, visible order quantities) for L3.
+
+        Each depth's last snapshot is kept.  If the book has not changed since, that same
+        snapshot is returned, so all subscribers of one depth share it.  Otherwise only
+        what changed is rebuilt: each side's change journal gives the best price touched
+        since the last snapshot.  A side with no change within its shown levels is
+        shared with the last snapshot as is.  Otherwise the levels ahead of that price
+        are copied and the side is re-read from the ladder from that price on.
+        */
+
+    int getLastTrade() const;
+        /*
+        Returns the price of the last trade (0 before the first).
+        */
+
+    std::pair<double, std::optional<Side>> getImbalance() const;
+        /*
+        Returns a measure of book side total volume imbalance, from the whole-side
+        running totals.
+
+        Returns:
+            A tuple containing the volume imbalance value and the side the order
+            book is in imbalance to.
+
+        Examples:
+            - Both sides of the book have equal volume: (0.0, None)
+            - Bid side has no volume and ask side has some: (1.0, ASK)
+            - Bid side has 4 shares and ask side has 2: (0.5, BID)
+        */
+
+private:
+    bool matchBest(Order& order, const LimitOrder* limit);
+
+    void getL2Data(PriceLadder& book, std::vector<std::pair<int, int>>& out, std::size_t depth);
+
+    template <typename Level>
+    std::shared_ptr<const BookSnapshot<Level>> getSnapshot(std::vector<SnapshotCache<Level>>& cache, std::size_t depth);
+
+    template <typename Level>
+    std::shared_ptr<const std::vector<Level>> refreshSide(
+        PriceLadder& book, const std::shared_ptr<const std::vector<Level>>& previous, uint64_t seen, std::size_t depth);
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "../message/orders.h"
+
+struct OrderNode {
+    /*
+    A resting order as stored in a PriceLevel queue.
+
+    Nodes are linked intrusively (prev/next) into their level's visible or hidden FIFO,
+    so unlinking a node found through the OrderIndex is O(1) and never moves any other
+    order.  Nodes are allocated from, and returned to, an OrderNodePool.
+    */
+    RestingOrder order;
+    OrderNode* prev;
+    OrderNode* next;
+
+    explicit OrderNode(const RestingOrder& order) : order(order), prev(nullptr), next(nullptr) {}
+};
+
+
+class OrderNodePool {
+    /*
+    Free-list allocator for OrderNodes, shared by every PriceLevel of one OrderBook.
+
+    Nodes are carved out of fixed-size chunks that are never returned to the system
+    until the pool is destroyed, so in steady state (orders arriving and cancelling at
+    a similar rate) adding an order to the book does not touch the heap.
+    */
+    static constexpr std::size_t CHUNK = 256;
+    typedef typename std::aligned_storage<sizeof(OrderNode), alignof(OrderNode)>::type Slot;
+
+    union FreeSlot {
+        FreeSlot* next;
+        Slot storage;
+    };
+
+    std::vector<std::unique_ptr<FreeSlot[]>> chunks;
+    FreeSlot* free_list = nullptr;
+    std::size_t live = 0;
+
+    void grow() {
+        chunks.emplace_back(new FreeSlot[CHUNK]);
+        FreeSlot* chunk = chunks.back().get();
+        for (std::size_t i = 0; i < CHUNK; i++) {
+            chunk[i].next = free_list;
+            free_list = &chunk[i];
+        }
+    }
+
+public:
+    OrderNodePool() = default;
+    OrderNodePool(const OrderNodePool&) = delete;
+    OrderNodePool& operator=(const OrderNodePool&) = delete;
+
+    OrderNode* create(const RestingOrder& order) {
+        if (free_list == nullptr) { grow(); }
+        FreeSlot* slot = free_list;
+        free_list = slot->next;
+        live++;
+        return ::new (static_cast<void*>(slot)) OrderNode(order);
+    }
+
+    void release(OrderNode* node) {
+        node->~OrderNode();
+        FreeSlot* slot = reinterpret_cast<FreeSlot*>(node);
+        slot->next = free_list;
+        free_list = slot;
+        live--;
+    }
+
+    std::size_t liveCount() const {
+        return live;
+    }
+};
+
+
+class OrderIndex {
+    /*
+    Book-wide map from order id to the node holding that order.
+
+    The two halves of a price-to-comply order share an order id (one visible, one
+    hidden, at different prices), so entries are keyed by (order id, hidden).  Automatic
+    ids are below 2^63, so doubling them loses nothing.
+    */
+    std::unordered_map<uint64_t, OrderNode*> nodes;
+
+    static uint64_t key(OrderId order_id, bool hidden) {
+        return (static_cast<uint64_t>(order_id) << 1) | (hidden ? 1 : 0);
+    }
+
+public:
+    OrderNode* find(OrderId order_id, bool hidden) const {
+        auto it = nodes.find(key(order_id, hidden));
+        return it == nodes.end() ? nullptr : it->second;
+    }
+
+    void insert(OrderNode* node) {
+        nodes[key(node->order.order_id, node->order.isHidden())] = node;
+    }
+
+    void erase(const OrderNode* node) {
+        nodes.erase(key(node->order.order_id, node->order.isHidden()));
+    }
+
+    void reserve(std::size_t n) {
+        nodes.reserve(n);
+    }
+
+    std::size_t size() const {
+        return nodes.size();
+    }
+};
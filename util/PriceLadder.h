@@ -0,0 +1,445 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include "PriceLevel.h"
+
+class TickBitmap {
+    /*
+    Hierarchical bitmap over a fixed number of slots.
+
+    Layer 0 has one bit per slot; each word of layer k+1 summarises 64 words of layer k
+    (bit set = that word is non-zero), up to a single top word.  Finding the first or
+    last set slot, or the next set slot on either side of a position, is one
+    count-trailing/leading-zeros per layer: two layers cover 4096 slots, three 262144.
+    */
+
+    std::vector<std::vector<uint64_t>> layers;
+
+    static std::size_t lowest(uint64_t word) { return static_cast<std::size_t>(__builtin_ctzll(word)); }
+    static std::size_t highest(uint64_t word) { return 63 - static_cast<std::size_t>(__builtin_clzll(word)); }
+
+    std::size_t descendLowest(std::size_t layer, std::size_t pos) const {
+        while (layer-- > 0) { pos = (pos << 6) + lowest(layers[layer][pos]); }
+        return pos;
+    }
+
+    std::size_t descendHighest(std::size_t layer, std::size_t pos) const {
+        while (layer-- > 0) { pos = (pos << 6) + highest(layers[layer][pos]); }
+        return pos;
+    }
+
+public:
+    static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+
+    explicit TickBitmap(std::size_t slots = 64) {
+        reset(slots);
+    }
+
+    void reset(std::size_t slots) {
+        layers.clear();
+        std::size_t words = (slots + 63) / 64;
+        if (words == 0) { words = 1; }
+        while (true) {
+            layers.emplace_back(words, 0);
+            if (words == 1) { break; }
+            words = (words + 63) / 64;
+        }
+    }
+
+    void set(std::size_t i) {
+        for (std::vector<uint64_t>& layer : layers) {
+            uint64_t& word = layer[i >> 6];
+            bool summarised = word != 0;
+            word |= uint64_t(1) << (i & 63);
+            if (summarised) { break; }
+            i >>= 6;
+        }
+    }
+
+    void clear(std::size_t i) {
+        for (std::vector<uint64_t>& layer : layers) {
+            uint64_t& word = layer[i >> 6];
+            word &= ~(uint64_t(1) << (i & 63));
+            if (word != 0) { break; }
+            i >>= 6;
+        }
+    }
+
+    bool test(std::size_t i) const {
+        return (layers[0][i >> 6] >> (i & 63)) & 1;
+    }
+
+    bool any() const {
+        return layers.back()[0] != 0;
+    }
+
+    std::size_t first() const {
+        return any() ? descendLowest(layers.size() - 1, lowest(layers.back()[0])) : NPOS;
+    }
+
+    std::size_t last() const {
+        return any() ? descendHighest(layers.size() - 1, highest(layers.back()[0])) : NPOS;
+    }
+
+    std::size_t after(std::size_t i) const {
+        /*
+        Returns the lowest set slot above i, or NPOS.
+        */
+        for (std::size_t layer = 0; layer < layers.size(); layer++) {
+            std::size_t bit = i & 63;
+            uint64_t above = bit == 63 ? 0 : layers[layer][i >> 6] & (~uint64_t(0) << (bit + 1));
+            if (above != 0) {
+                return descendLowest(layer, ((i >> 6) << 6) + lowest(above));
+            }
+            i >>= 6;
+        }
+        return NPOS;
+    }
+
+    std::size_t before(std::size_t i) const {
+        /*
+        Returns the highest set slot below i, or NPOS.
+        */
+        for (std::size_t layer = 0; layer < layers.size(); layer++) {
+            std::size_t bit = i & 63;
+            uint64_t below = layers[layer][i >> 6] & ((uint64_t(1) << bit) - 1);
+            if (below != 0) {
+                return descendHighest(layer, ((i >> 6) << 6) + highest(below));
+            }
+            i >>= 6;
+        }
+        return NPOS;
+    }
+};
+
+
+class PriceLadder {
+    /*
+    One side of an order book, with price levels indexed directly by tick.
+
+    Prices are int cents, so a level's slot is simply (price - base).  The ladder covers
+    a window of `capacity` ticks starting at `base`; a TickBitmap marks which slots hold
+    a non-empty level, so the best level and the next level away from the touch are
+    found in a few instructions, and creating or deleting a level is O(1) with no other
+    level moving.
+
+    An order priced outside the window re-centres it on the occupied range (doubling
+    the capacity if that range no longer fits in half of it).  That costs O(capacity)
+    but only happens when the market drifts a long way, so stays rare for the price
+    bands simulations actually use.
+
+    The window never grows past MAX_CAPACITY ticks, and stays anchored to the best
+    price it holds.  Levels more than MAX_CAPACITY / 2 ticks from that (e.g. orders
+    resting at the MKT_BUY / MKT_SELL sentinels) are kept in a sorted `overflow` map
+    instead and walked in price order together with the window, so a far-away price
+    costs a map lookup rather than a window spanning it.
+
+    Levels are walked best-first:
+
+        for (PriceLevel* level = bids.best(); level != nullptr; level = bids.worse(*level)) { ... }
+
+    Every level reports quantity changes into the ladder's `totals`, so whole-side
+    volume is O(1) and cumulative depth costs one step per level, not per order, and
+    the price of every visible change into the ladder's `journal`.
+    */
+
+    Side side;
+    int base;
+    std::size_t capacity;
+    // Declared ahead of the slots and overflow, since levels still report into both as
+    // they are destroyed.
+    LevelJournal journal;
+    QuantityTotals totals;
+    std::vector<std::optional<PriceLevel>> slots;
+    TickBitmap occupied;
+    std::map<int, PriceLevel> overflow;
+    std::size_t level_count;
+
+    std::size_t nextSlot(std::size_t slot) const {
+        // The next occupied slot away from the touch.
+        return side.is_bid() ? occupied.before(slot) : occupied.after(slot);
+    }
+
+    std::size_t bestSlot() const {
+        return side.is_bid() ? occupied.last() : occupied.first();
+    }
+
+    bool inWindow(int64_t price) const {
+        return price >= base && price - base < static_cast<int64_t>(capacity);
+    }
+
+    std::size_t slotOf(int64_t price) const {
+        return static_cast<std::size_t>(price - base);
+    }
+
+    int64_t priceOf(std::size_t slot) const {
+        return static_cast<int64_t>(base) + static_cast<int64_t>(slot);
+    }
+
+    const PriceLevel* levelAt(std::size_t slot) const {
+        return slot == TickBitmap::NPOS ? nullptr : &*slots[slot];
+    }
+
+    const PriceLevel* bestLevel() const {
+        const PriceLevel* level = levelAt(bestSlot());
+        if (!overflow.empty()) {
+            const PriceLevel& far = side.is_bid() ? overflow.rbegin()->second : overflow.begin()->second;
+            if (level == nullptr || better(far.price, level->price)) { level = &far; }
+        }
+        return level;
+    }
+
+    const PriceLevel* worseThan(int price) const {
+        /*
+        Returns the best level priced strictly further from the touch than `price`, or nullptr.
+        */
+        std::size_t slot = TickBitmap::NPOS;
+        int64_t end = priceOf(capacity);
+        if (side.is_bid()) {
+            if (price >= end) { slot = occupied.last(); }
+            else if (price > base) { slot = occupied.before(slotOf(price)); }
+        } else {
+            if (price < base) { slot = occupied.first(); }
+            else if (price < end - 1) { slot = occupied.after(slotOf(price)); }
+        }
+        const PriceLevel* level = levelAt(slot);
+        if (overflow.empty()) { return level; }
+
+        const PriceLevel* far = nullptr;
+        if (side.is_bid()) {
+            auto it = overflow.lower_bound(price);
+            if (it != overflow.begin()) { far = &std::prev(it)->second; }
+        } else {
+            auto it = overflow.upper_bound(price);
+            if (it != overflow.end()) { far = &it->second; }
+        }
+        if (level == nullptr || (far != nullptr && better(far->price, level->price))) { return far; }
+        return level;
+    }
+
+    const PriceLevel* findLevel(int price) const {
+        if (inWindow(price)) {
+            return occupied.test(slotOf(price)) ? &*slots[slotOf(price)] : nullptr;
+        }
+        auto it = overflow.find(price);
+        return it == overflow.end() ? nullptr : &it->second;
+    }
+
+    const PriceLevel* worseLevel(const PriceLevel& level) const {
+        if (overflow.empty()) { return levelAt(nextSlot(slotOf(level.price))); }
+        return worseThan(level.price);
+    }
+
+    int64_t windowTouch() const {
+        // The best price held in the window, which the window stays anchored to.
+        return occupied.any() ? priceOf(bestSlot()) : -1;
+    }
+
+    void recenter(int price) {
+        /*
+        Moves the window so it covers `price`, growing it up to MAX_CAPACITY.  Window
+        levels that fall outside the new window move to `overflow`, and overflow levels
+        inside it move into the window.
+        */
+        int64_t touch = windowTouch();
+        if (touch < 0) { touch = price; }
+        int64_t lo = price;
+        int64_t hi = price;
+        if (occupied.any()) {
+            lo = std::min(lo, priceOf(occupied.first()));
+            hi = std::max(hi, priceOf(occupied.last()));
+        }
+        // Keep the window within MAX_CAPACITY ticks around the new price and the touch.
+        int64_t centre = (price + touch) / 2;
+        int64_t half = static_cast<int64_t>(MAX_CAPACITY / 2);
+        lo = std::max(lo, centre - half);
+        hi = std::min(hi, centre + half - 1);
+        std::size_t span = static_cast<std::size_t>(hi - lo) + 1;
+
+        std::size_t new_capacity = capacity;
+        while (span > new_capacity / 2 && new_capacity < MAX_CAPACITY) { new_capacity *= 2; }
+        int64_t new_base = lo - static_cast<int64_t>((new_capacity - span) / 2);
+
+        std::vector<std::optional<PriceLevel>> new_slots(new_capacity);
+        TickBitmap new_occupied(new_capacity);
+        auto fits = [&](int64_t p) { return p >= new_base && p - new_base < static_cast<int64_t>(new_capacity); };
+        for (std::size_t slot = occupied.first(); slot != TickBitmap::NPOS; slot = occupied.after(slot)) {
+            int64_t level_price = priceOf(slot);
+            if (fits(level_price)) {
+                std::size_t moved = static_cast<std::size_t>(level_price - new_base);
+                new_slots[moved].emplace(std::move(*slots[slot]));
+                new_occupied.set(moved);
+            } else {
+                overflow.emplace(static_cast<int>(level_price), std::move(*slots[slot]));
+            }
+        }
+        auto it = overflow.lower_bound(static_cast<int>(new_base));
+        while (it != overflow.end() && fits(it->first)) {
+            std::size_t moved = static_cast<std::size_t>(it->first - new_base);
+            new_slots[moved].emplace(std::move(it->second));
+            new_occupied.set(moved);
+            it = overflow.erase(it);
+        }
+
+        slots.swap(new_slots);
+        occupied = std::move(new_occupied);
+        capacity = new_capacity;
+        base = static_cast<int>(new_base);
+    }
+
+public:
+    // Widest window, in ticks (cents), kept around the touch.
+    static constexpr std::size_t MAX_CAPACITY = std::size_t(1) << 18;
+
+    PriceLadder(Side side, std::size_t capacity = 4096)
+        : side(side), base(0), capacity(capacity), slots(capacity), occupied(capacity), level_count(0) {
+        /*
+        Arguments:
+            side: BID ladders rank higher prices first, ASK ladders lower prices first.
+            capacity: Initial window width in ticks (cents).  Must be between 2 and MAX_CAPACITY.
+        */
+        if (capacity < 2 || capacity > MAX_CAPACITY) {
+            throw std::invalid_argument("PriceLadder capacity must be between 2 and MAX_CAPACITY ticks.");
+        }
+    }
+
+    PriceLadder(const PriceLadder&) = delete;
+    PriceLadder& operator=(const PriceLadder&) = delete;
+
+    bool empty() const {
+        return level_count == 0;
+    }
+
+    std::size_t size() const {
+        /*
+        Returns the number of non-empty price levels.
+        */
+        return level_count;
+    }
+
+    PriceLevel* best() {
+        return const_cast<PriceLevel*>(bestLevel());
+    }
+
+    PriceLevel* worse(const PriceLevel& level) {
+        /*
+        Returns the next level away from the touch, or nullptr if this is the last one.
+        */
+        return const_cast<PriceLevel*>(worseLevel(level));
+    }
+
+    PriceLevel* atOrWorse(int price) {
+        /*
+        Returns the best level priced at `price` or further from the touch, or nullptr.
+        */
+        if (level_count == 0) { return nullptr; }
+        const PriceLevel* level = findLevel(price);
+        return const_cast<PriceLevel*>(level != nullptr ? level : worseThan(price));
+    }
+
+    bool better(int price, int other) const {
+        /*
+        Returns true if `price` ranks ahead of `other` on this side.
+        */
+        return side.is_bid() ? price > other : price < other;
+    }
+
+    const LevelJournal& changes() const {
+        /*
+        Returns the journal of prices whose visible orders have changed.
+        */
+        return journal;
+    }
+
+    PriceLevel* find(int price) {
+        return const_cast<PriceLevel*>(findLevel(price));
+    }
+
+    PriceLevel& addOrder(OrderNodePool& pool, OrderIndex& index, const LimitOrder& order) {
+        /*
+        Adds an order at its limit price, creating the level if needed, and returns the level.
+        */
+        int price = order.limit_price;
+        if (price < 0) {
+            throw std::invalid_argument("PriceLadder prices must be non-negative.");
+        }
+        if (!inWindow(price)) {
+            int64_t touch = windowTouch();
+            if (touch < 0 || std::abs(price - touch) < static_cast<int64_t>(MAX_CAPACITY / 2)) {
+                recenter(price);
+            }
+        }
+        if (!inWindow(price)) {
+            // Too far from the touch for the window.
+            auto it = overflow.find(price);
+            if (it == overflow.end()) {
+                it = overflow.emplace(std::piecewise_construct, std::forward_as_tuple(price),
+                                      std::forward_as_tuple(pool, index, price, side, &totals, &journal)).first;
+                level_count++;
+            }
+            it->second.addOrder(order);
+            return it->second;
+        }
+
+        std::size_t slot = slotOf(price);
+        if (!occupied.test(slot)) {
+            slots[slot].emplace(pool, index, order.limit_price, side, &totals, &journal);
+            occupied.set(slot);
+            level_count++;
+        }
+        slots[slot]->addOrder(order);
+        return *slots[slot];
+    }
+
+    const QuantityTotals& sideTotals() const {
+        /*
+        Returns the visible and hidden quantity and order count across the whole side.
+        */
+        return totals;
+    }
+
+    long long depthQuantity(std::size_t levels) const {
+        /*
+        Returns the cumulative visible quantity of the best `levels` price levels.
+        */
+        long long quantity = 0;
+        for (const PriceLevel* level = bestLevel(); level != nullptr && levels > 0; level = worseLevel(*level), levels--) {
+            quantity += level->totals.visible_quantity;
+        }
+        return quantity;
+    }
+
+    long long quantityThrough(int price) const {
+        /*
+        Returns the cumulative visible quantity at prices at least as good as `price`,
+        i.e. what a marketable order limited at `price` could take.
+        */
+        long long quantity = 0;
+        for (const PriceLevel* level = bestLevel(); level != nullptr; level = worseLevel(*level)) {
+            if (better(price, level->price)) { break; }
+            quantity += level->totals.visible_quantity;
+        }
+        return quantity;
+    }
+
+    void eraseIfEmpty(PriceLevel& level) {
+        /*
+        Deletes the level if its last order has gone.  `level` is invalid afterwards if so.
+        */
+        if (!level.isEmpty()) { return; }
+        if (inWindow(level.price)) {
+            std::size_t slot = slotOf(level.price);
+            slots[slot].reset();
+            occupied.clear(slot);
+        } else {
+            overflow.erase(level.price);
+        }
+        level_count--;
+    }
+};
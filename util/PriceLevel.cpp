@@ -1,130 +1,179 @@
 #include "PriceLevel.h"
 #include <stdexcept>
 
-PriceLevel::PriceLevel(OrderList orders) {
+PriceLevel::PriceLevel(OrderNodePool& pool, OrderIndex& index, OrderList orders)
+    : pool(&pool), index(&index), side_totals(nullptr), journal(nullptr) {
     if (orders.empty()) {
         throw std::invalid_argument("At least one LimitOrder must be given when initialising a PriceLevel.");
     }
-    price = std::get<0>(orders[0]).limit_price;
-    side = std::get<0>(orders[0]).side;
+    price = orders[0].limit_price;
+    side = orders[0].side;
 
-    for (const auto& tup : orders) {
-        // (order, metadata)
-        addOrder(std::get<0>(tup), std::get<1>(tup));
+    for (const LimitOrder& order : orders) {
+        addOrder(order);
     }
 }
 
-void PriceLevel::addOrder(const LimitOrder& order, std::optional<std::unordered_map<std::string, int>> metadata) {
-    if (order.is_hidden) {
-        hidden_orders.push_back(std::make_tuple(order, *metadata));
-    }
-    else if (order.insert_by_id) {
-        int insert_index = 0;
-        for (const auto& tup : visible_orders) {
-            LimitOrder order2 = std::get<0>(tup);
-            if (order2.order_id > order.order_id) {
-                break;
-            }
-            insert_index ++;
-        }
-        visible_orders.insert(visible_orders.begin() + insert_index, std::make_tuple(order, *metadata));
-    }
-    else {
-        visible_orders.push_back(std::make_tuple(order, metadata));
-    }
+PriceLevel::PriceLevel(OrderNodePool& pool, OrderIndex& index, int price, Side side, QuantityTotals* side_totals,
+                       LevelJournal* journal)
+    : price(price), side(side), pool(&pool), index(&index), side_totals(side_totals), journal(journal) {}
+
+PriceLevel::PriceLevel(PriceLevel&& other) noexcept
+    : visible_orders(other.visible_orders), hidden_orders(other.hidden_orders),
+      price(other.price), side(other.side), pool(other.pool), index(other.index),
+      totals(other.totals), side_totals(other.side_totals), journal(other.journal) {
+    other.visible_orders = OrderQueue();
+    other.hidden_orders = OrderQueue();
+    other.totals = QuantityTotals();
 }
 
-bool PriceLevel::updateOrderQuantity(int order_id, int new_quantity) {
-    if (new_quantity == 0) {
-        return false;
+PriceLevel& PriceLevel::operator=(PriceLevel&& other) noexcept {
+    if (this != &other) {
+        releaseAll();
+        visible_orders = other.visible_orders;
+        hidden_orders = other.hidden_orders;
+        price = other.price;
+        side = other.side;
+        pool = other.pool;
+        index = other.index;
+        totals = other.totals;
+        side_totals = other.side_totals;
+        journal = other.journal;
+        other.visible_orders = OrderQueue();
+        other.hidden_orders = OrderQueue();
+        other.totals = QuantityTotals();
     }
+    return *this;
+}
 
-    for (size_t i=0; i<visible_orders.size(); i++) {
-        auto& [order, metadata] = visible_orders[i];
-        if (order.order_id == order_id) {
-            if (new_quantity <= order.quantity) {
-                order.quantity = new_quantity;
-            }
-            else {
-                visible_orders.erase(visible_orders.begin() + i);
-                order.quantity = new_quantity;
-                visible_orders.push_back(std::make_tuple(order, metadata));
-            }
-            return true;
+PriceLevel::~PriceLevel() {
+    releaseAll();
+}
+
+void PriceLevel::releaseAll() {
+    for (OrderQueue* queue : {&visible_orders, &hidden_orders}) {
+        OrderNode* node = queue->head;
+        while (node != nullptr) {
+            OrderNode* next = node->next;
+            account(node->order, -node->order.quantity, -1);
+            index->erase(node);
+            pool->release(node);
+            node = next;
         }
+        *queue = OrderQueue();
     }
-    
-    for (size_t i=0; i<hidden_orders.size(); i++) {
-        auto& [order, metadata] = hidden_orders[i];
-        if (order.order_id == order_id) {
-            if (new_quantity <= order.quantity) {
-                order.quantity = new_quantity;
-            }
-            else {
-                hidden_orders.erase(hidden_orders.begin() + i);
-                order.quantity = new_quantity;
-                hidden_orders.push_back(std::make_tuple(order, metadata));
-            }
-            return true;
+}
+
+OrderNode* PriceLevel::findNode(OrderId order_id) {
+    // The index is book-wide, so check the node really belongs to this level.
+    for (bool hidden : {false, true}) {
+        OrderNode* node = index->find(order_id, hidden);
+        if (node != nullptr && node->order.price == price && node->order.side() == side) {
+            return node;
         }
     }
-    return false;
+    return nullptr;
 }
 
-std::optional<OrderTuple> PriceLevel::removeOrder(int order_id) {
-    for (size_t i=0; i<visible_orders.size(); i++) {
-        auto& [book_order, _] = visible_orders[i];
-        if (book_order.order_id == order_id) {
-            auto removed_order = visible_orders[i];
-            visible_orders.erase(visible_orders.begin() + i);
+OrderQueue& PriceLevel::queueFor(const OrderNode* node) {
+    return node->order.isHidden() ? hidden_orders : visible_orders;
+}
 
-            return removed_order;
-        }
+void PriceLevel::account(const RestingOrder& order, long long quantity, long long count) {
+    totals.add(order.isHidden(), quantity, count);
+    if (side_totals != nullptr) {
+        side_totals->add(order.isHidden(), quantity, count);
+    }
+    // Hidden orders never appear in market data, so only visible changes are journalled.
+    if (journal != nullptr && !order.isHidden()) {
+        journal->touch(price);
     }
+}
 
-    for (size_t i=0; i<hidden_orders.size(); i++) {
-        auto& [book_order, _] = hidden_orders[i];
-        if (book_order.order_id == order_id) {
-            auto removed_order = hidden_orders[i];
-            hidden_orders.erase(hidden_orders.begin() + i);
+void PriceLevel::addOrder(const LimitOrder& order) {
+    OrderNode* node = pool->create(RestingOrder(order));
+    index->insert(node);
+    account(node->order, order.quantity, 1);
 
-            return removed_order;
+    if (order.is_hidden) {
+        hidden_orders.pushBack(node);
+    }
+    else if (order.insert_by_id) {
+        OrderNode* position = visible_orders.head;
+        while (position != nullptr && position->order.order_id <= node->order.order_id) {
+            position = position->next;
         }
+        visible_orders.insertBefore(position, node);
+    }
+    else {
+        visible_orders.pushBack(node);
     }
-    return std::nullopt;
 }
 
-OrderTuple PriceLevel::peek() {
-    if (!visible_orders.empty()) {
-        return visible_orders.front();
+bool PriceLevel::updateOrderQuantity(OrderId order_id, int new_quantity) {
+    if (new_quantity == 0) {
+        return false;
+    }
+
+    OrderNode* node = findNode(order_id);
+    if (node == nullptr) {
+        return false;
     }
-    else if (!hidden_orders.empty()) {
-        return hidden_orders.front();
+
+    if (new_quantity > node->order.quantity) {
+        // Increasing the quantity loses queue priority.
+        OrderQueue& queue = queueFor(node);
+        queue.unlink(node);
+        queue.pushBack(node);
     }
-    else {
-        throw std::runtime_error("Can't peek at LimitOrder in PriceLevel as it contains no orders");
+    account(node->order, new_quantity - node->order.quantity, 0);
+    node->order.quantity = new_quantity;
+    return true;
+}
+
+std::optional<RestingOrder> PriceLevel::removeOrder(OrderId order_id) {
+    OrderNode* node = findNode(order_id);
+    if (node == nullptr) {
+        return std::nullopt;
     }
+
+    queueFor(node).unlink(node);
+    account(node->order, -node->order.quantity, -1);
+    index->erase(node);
+    RestingOrder removed_order = node->order;
+    pool->release(node);
+
+    return removed_order;
 }
 
-OrderTuple PriceLevel::pop() {
-    if (!visible_orders.empty()) {
-        auto removed_order = visible_orders.front();
-        visible_orders.erase(visible_orders.begin());
+OrderNode* PriceLevel::front() {
+    return visible_orders.head != nullptr ? visible_orders.head : hidden_orders.head;
+}
 
-        return removed_order;
+RestingOrder PriceLevel::peek() {
+    OrderNode* node = front();
+    if (node == nullptr) {
+        throw std::runtime_error("Can't peek at LimitOrder in PriceLevel as it contains no orders");
     }
-    else if (!hidden_orders.empty()) {
-        auto removed_order = hidden_orders.front();
-        hidden_orders.erase(hidden_orders.begin());
+    return node->order;
+}
 
-        return removed_order;
-    }
-    else {
+RestingOrder PriceLevel::pop() {
+    OrderNode* node = front();
+    if (node == nullptr) {
         throw std::runtime_error("Can't pop LimitOrder from PriceLevel as it contains no orders");
     }
+
+    queueFor(node).unlink(node);
+    account(node->order, -node->order.quantity, -1);
+    index->erase(node);
+    RestingOrder removed_order = node->order;
+    pool->release(node);
+
+    return removed_order;
 }
 
-bool PriceLevel::orderIsMatch(LimitOrder order) {
+bool PriceLevel::orderIsMatch(const LimitOrder& order) {
     if (order.side == side) {
         throw std::runtime_error("Attempted to compare order on wrong side of book.");
     }
@@ -138,8 +187,8 @@ bool PriceLevel::orderIsMatch(LimitOrder order) {
     }
     
     if (
-        order.side.is_bid() 
-        && order.limit_price >= price
+        order.side.is_ask() 
+        && order.limit_price <= price
         && !(order.is_post_only && totalQuantity() == 0)
     ) {
         return true;
@@ -148,7 +197,7 @@ bool PriceLevel::orderIsMatch(LimitOrder order) {
     return false;
 }
 
-bool PriceLevel::orderHasBetterPrice(LimitOrder order) {
+bool PriceLevel::orderHasBetterPrice(const LimitOrder& order) {
     if (order.side != side) {
         throw std::runtime_error("Attempted to compare order on wrong side of book.");
     }
@@ -165,7 +214,7 @@ bool PriceLevel::orderHasBetterPrice(LimitOrder order) {
     return false;
 }
 
-bool PriceLevel::orderHasWorsePrice(LimitOrder order) {
+bool PriceLevel::orderHasWorsePrice(const LimitOrder& order) {
     if (order.side != side) {
         throw std::runtime_error("Attempted to compare order on wrong side of book.");
     }
@@ -181,7 +230,7 @@ bool PriceLevel::orderHasWorsePrice(LimitOrder order) {
     return false;
 }
 
-bool PriceLevel::orderHasEqualPrice(LimitOrder order) {
+bool PriceLevel::orderHasEqualPrice(const LimitOrder& order) {
     if (order.side != side) {
         throw std::runtime_error("Attempted to compare order on wrong side of book.");
     }
@@ -189,13 +238,21 @@ bool PriceLevel::orderHasEqualPrice(LimitOrder order) {
     return order.limit_price == price;
 }
 
-int PriceLevel::totalQuantity() {
-    int sum = 0;
-    for (size_t i=0; i<visible_orders.size(); i++) {
-        auto& [order, _] = visible_orders[i];
-        sum += order.quantity;
-    }
-    return sum;
+void PriceLevel::reduceQuantity(OrderNode* node, int quantity) {
+    account(node->order, -quantity, 0);
+    node->order.quantity -= quantity;
+}
+
+int PriceLevel::totalQuantity() const {
+    return static_cast<int>(totals.visible_quantity);
+}
+
+int PriceLevel::hiddenQuantity() const {
+    return static_cast<int>(totals.hidden_quantity);
+}
+
+std::size_t PriceLevel::orderCount() const {
+    return totals.visible_count + totals.hidden_count;
 }
 
 bool PriceLevel::isEmpty() {
@@ -1,10 +1,93 @@
-#include <tuple>
+#pragma once
 #include <vector>
 #include <optional>
 #include "../message/orders.h"
+#include "OrderNodePool.h"
 
-typedef std::tuple<LimitOrder, std::optional<std::unordered_map<std::string, int>>> OrderTuple;
-typedef std::vector<OrderTuple> OrderList;
+typedef std::vector<LimitOrder> OrderList;
+
+struct OrderQueue {
+    /*
+    Intrusive FIFO of OrderNodes.  Does not own its nodes; the PriceLevel does.
+    */
+    OrderNode* head = nullptr;
+    OrderNode* tail = nullptr;
+    std::size_t count = 0;
+
+    bool empty() const {
+        return head == nullptr;
+    }
+
+    void pushBack(OrderNode* node) {
+        insertBefore(nullptr, node);
+    }
+
+    void insertBefore(OrderNode* position, OrderNode* node) {
+        // Inserts node ahead of position, or at the back if position is null.
+        node->next = position;
+        node->prev = position != nullptr ? position->prev : tail;
+        if (node->prev != nullptr) { node->prev->next = node; } else { head = node; }
+        if (position != nullptr) { position->prev = node; } else { tail = node; }
+        count++;
+    }
+
+    void unlink(OrderNode* node) {
+        if (node->prev != nullptr) { node->prev->next = node->next; } else { head = node->next; }
+        if (node->next != nullptr) { node->next->prev = node->prev; } else { tail = node->prev; }
+        node->prev = nullptr;
+        node->next = nullptr;
+        count--;
+    }
+};
+
+struct QuantityTotals {
+    /*
+    Running order quantities and counts, kept per PriceLevel and per book side.
+    */
+    long long visible_quantity = 0;
+    long long hidden_quantity = 0;
+    std::size_t visible_count = 0;
+    std::size_t hidden_count = 0;
+
+    void add(bool hidden, long long quantity, long long count) {
+        if (hidden) {
+            hidden_quantity += quantity;
+            hidden_count += count;
+        }
+        else {
+            visible_quantity += quantity;
+            visible_count += count;
+        }
+    }
+};
+
+struct LevelJournal {
+    /*
+    Prices whose visible orders have changed, in the order they changed, for one book
+    side.  Readers remember the sequence number (end()) they last caught up to and read
+    the prices touched since; see OrderBook::getL2Snapshot.
+
+    The journal is bounded: once it holds MAX_ENTRIES prices it is emptied and `base`
+    moves past them, so a reader whose sequence number is below `base` has missed
+    changes and must start over.
+    */
+    static constexpr std::size_t MAX_ENTRIES = 4096;
+
+    std::vector<int> prices;
+    uint64_t base = 0;      // Sequence number of prices[0].
+
+    void touch(int price) {
+        if (prices.size() >= MAX_ENTRIES) {
+            base += prices.size();
+            prices.clear();
+        }
+        prices.push_back(price);
+    }
+
+    uint64_t end() const {
+        return base + prices.size();
+    }
+};
 
 struct PriceLevel {
     /*
@@ -15,40 +98,77 @@ struct PriceLevel {
 
     Visible orders are consumed first, followed by any hidden orders.
 
+    Orders live in nodes drawn from the book's OrderNodePool and linked into intrusive
+    FIFOs; every node is also registered in the book's OrderIndex, so removing or
+    resizing an order by id never scans the level.  A PriceLevel owns its nodes and
+    can be moved but not copied.
+
+    Visible and hidden quantities and order counts are maintained as orders are added,
+    executed, cancelled or modified, both for the level and (through side_totals) for
+    the whole side of the book, so none of the quantity queries walk the orders.
+    Change a resting order's quantity only through this class (e.g. reduceQuantity),
+    never by writing to the node directly.
+
     Attributes:
-        visible_orders: A list of visible orders, where the order with index=0 is first
-            in the queue and will be exexcuted first.
-        hidden_orders: A list of hidden orders, where the order with index=0 is first
-            in the queue and will be exexcuted first.
+        visible_orders: A queue of visible orders, where the head is first in the
+            queue and will be exexcuted first.
+        hidden_orders: A queue of hidden orders, where the head is first in the
+            queue and will be exexcuted first.
         price: The price this PriceLevel represents.
         side: The side of the market this PriceLevel represents.
+        totals: Quantities and counts of the orders at this level.
+        side_totals: The book side's totals, updated alongside `totals`; may be null.
+        journal: The book side's change journal, told of every change to this level's
+            visible orders; may be null.
     */
-    OrderList visible_orders;
-    OrderList hidden_orders;
+    OrderQueue visible_orders;
+    OrderQueue hidden_orders;
     int price;
     Side side;
+    OrderNodePool* pool;
+    OrderIndex* index;
+    QuantityTotals totals;
+    QuantityTotals* side_totals;
+    LevelJournal* journal;
 
-    PriceLevel(OrderList orders);
+    PriceLevel(OrderNodePool& pool, OrderIndex& index, OrderList orders);
     /*
     Arguments:
+        pool: The book's node allocator.
+        index: The book's order id index.
         orders: A list of orders, containing both visible and hidden orders that
             will be correctly allocated on initialisation. At least one order must
             be given.
     */
+
+    PriceLevel(OrderNodePool& pool, OrderIndex& index, int price, Side side, QuantityTotals* side_totals = nullptr,
+               LevelJournal* journal = nullptr);
+    /*
+    Creates an empty price level; add orders to it with addOrder().
+    */
+
+    PriceLevel(PriceLevel&& other) noexcept;
+    PriceLevel& operator=(PriceLevel&& other) noexcept;
+    PriceLevel(const PriceLevel&) = delete;
+    PriceLevel& operator=(const PriceLevel&) = delete;
+    ~PriceLevel();
+    /*
+    Destroying a level releases its remaining orders and removes them from the index.
+    */
     
-    void addOrder(const LimitOrder& order, std::optional<std::unordered_map<std::string, int>> metadata = std::nullopt);
+    void addOrder(const LimitOrder& order);
     /*
     Adds an order to the correct queue in the price level.
 
-    Orders are added to the back of their respective queue.
+    Orders are added to the back of their respective queue.  Only the order's
+    RestingOrder record is kept; the symbol is implied by the book.
 
     Arguments:
         order: The `LimitOrder` to add, can be visible or hidden.
-        metadata: Optional dict of metadata values to associate with the order.
     */
 
 
-    bool updateOrderQuantity(int order_id, int new_quantity);
+    bool updateOrderQuantity(OrderId order_id, int new_quantity);
     /*
     Updates the quantity of an order.
 
@@ -71,7 +191,7 @@ struct PriceLevel {
     */
 
 
-    std::optional<OrderTuple> removeOrder(int order_id);
+    std::optional<RestingOrder> removeOrder(OrderId order_id);
     /*
     Attempts to remove an order from the price level.
 
@@ -83,7 +203,7 @@ struct PriceLevel {
     */
 
 
-    OrderTuple peek();
+    RestingOrder peek();
     /*
     Returns the highest priority order in the price level. Visible orders are returned first,
     followed by hidden orders if no visible order exist.
@@ -91,7 +211,13 @@ struct PriceLevel {
     Raises a ValueError exception if the price level has no orders.
     */
 
-    OrderTuple pop();
+    OrderNode* front();
+    /*
+    Like peek(), but returns the node itself so the order can be modified in place.
+    Returns nullptr if the price level has no orders.
+    */
+
+    RestingOrder pop();
     /*
     Removes the highest priority order in the price level and returns it. Visible
     orders are returned first, followed by hidden orders if no visible order exist.
@@ -99,7 +225,7 @@ struct PriceLevel {
     Raises a ValueError exception if the price level has no orders.
     */
     
-    bool orderIsMatch(LimitOrder order);
+    bool orderIsMatch(const LimitOrder& order);
     /*
     Checks if an order on the opposite side of the book is a match with this price
     level.
@@ -113,7 +239,7 @@ struct PriceLevel {
         True if the order is a match.
     */
 
-    bool orderHasBetterPrice(LimitOrder order);
+    bool orderHasBetterPrice(const LimitOrder& order);
     /*
     Checks if an order on this side of the book has a better price than this price
     level.
@@ -125,7 +251,7 @@ struct PriceLevel {
         True if the given order has a better price.
     */
     
-    bool orderHasWorsePrice(LimitOrder order);
+    bool orderHasWorsePrice(const LimitOrder& order);
     /*
     Checks if an order on this side of the book has a worse price than this price
     level.
@@ -137,7 +263,7 @@ struct PriceLevel {
         True if the given order has a worse price.
     */
 
-    bool orderHasEqualPrice(LimitOrder order);
+    bool orderHasEqualPrice(const LimitOrder& order);
     /*
     Checks if an order on this side of the book has an equal price to this price
     level.
@@ -150,11 +276,28 @@ struct PriceLevel {
     */
 
     
-    int totalQuantity();
+    void reduceQuantity(OrderNode* node, int quantity);
+    /*
+    Reduces a resting order's quantity in place (e.g. after a partial execution),
+    keeping its queue position.  The order must keep a positive quantity; use
+    pop() or removeOrder() to take it out entirely.
+    */
+
+    int totalQuantity() const;
     /*
     Returns the total visible order quantity of this price level.
     */    
 
+    int hiddenQuantity() const;
+    /*
+    Returns the total hidden order quantity of this price level.
+    */
+
+    std::size_t orderCount() const;
+    /*
+    Returns the number of orders, visible and hidden, at this price level.
+    */
+
 
     bool isEmpty();
     /*
@@ -171,5 +314,16 @@ struct PriceLevel {
     //         and self.hidden_orders == other.hidden_orders
     //     )
 
+private:
+    OrderNode* findNode(OrderId order_id);
+    /*
+    Returns this level's node for the order id (visible half first), or nullptr.
+    */
+
+    OrderQueue& queueFor(const OrderNode* node);
+
+    void releaseAll();
+
+    void account(const RestingOrder& order, long long quantity, long long count);
 };
         
\ No newline at end of file
@@ -0,0 +1,241 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+class RandomStream {
+    /*
+    Counter-based random number stream (Philox4x32-10).
+
+    A stream is identified by a 64-bit seed (the Philox key) and a 64-bit stream id; its
+    n-th block of four 32-bit words is simply Philox(key = seed, counter = (n, stream id)).
+    There is no hidden state beyond the position, so:
+      - streams for different ids are independent, and any number of them can be created
+        cheaply, e.g. one per agent from (random_state, agent id);
+      - the same (seed, stream id) always produces the same sequence, on any thread and
+        whatever other streams have drawn;
+      - blocks are independent of each other, so the batch fill*() calls generate many at
+        once in a plain loop the compiler can vectorise.
+
+    Scalar draws and batch draws consume the same underlying words in the same way, so
+    filling n uniforms gives exactly the values n calls to uniform() would have.
+
+        RandomStream rng(seed, agent_id);
+        int size = rng.uniformInt(20, 49);      // 20..49 inclusive
+        double wait = rng.exponential(mean_wait);
+        rng.fillNormal(noise, 256, 0.0, sigma);
+    */
+
+    static constexpr uint32_t M0 = 0xD2511F53;
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9;
+    static constexpr uint32_t W1 = 0xBB67AE85;
+
+    static constexpr std::size_t SCRATCH = 256;     // Words per bulk generation chunk.
+
+    uint32_t key[2];
+    uint32_t stream_id[2];
+    uint64_t block;          // Index of the next block to generate.
+    uint32_t buffer[4];      // Current block; words [pos, 4) not yet consumed.
+    unsigned pos;
+    bool has_spare_normal;
+    double spare_normal;
+
+    static void philox(uint64_t counter, const uint32_t stream[2], const uint32_t seed[2], uint32_t out[4]) {
+        uint32_t c0 = static_cast<uint32_t>(counter);
+        uint32_t c1 = static_cast<uint32_t>(counter >> 32);
+        uint32_t c2 = stream[0];
+        uint32_t c3 = stream[1];
+        uint32_t k0 = seed[0];
+        uint32_t k1 = seed[1];
+
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = static_cast<uint64_t>(M0) * c0;
+            uint64_t p1 = static_cast<uint64_t>(M1) * c2;
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(p1);
+            c3 = static_cast<uint32_t>(p0);
+            c0 = n0;
+            c2 = n2;
+            k0 += W0;
+            k1 += W1;
+        }
+
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+    }
+
+    void refill() {
+        philox(block++, stream_id, key, buffer);
+        pos = 0;
+    }
+
+    void fillWords(uint32_t* out, std::size_t n) {
+        /*
+        Writes the next n words of the stream, generating whole blocks straight into out.
+        */
+        while (n > 0 && pos < 4) { *out++ = buffer[pos++]; n--; }
+
+        std::size_t blocks = n / 4;
+        for (std::size_t b = 0; b < blocks; b++) {
+            philox(block + b, stream_id, key, out + 4 * b);
+        }
+        block += blocks;
+        out += 4 * blocks;
+        n -= 4 * blocks;
+
+        while (n > 0) { *out++ = nextWord(); n--; }
+    }
+
+    static double toUnit(uint32_t hi, uint32_t lo) {
+        // 53 random bits -> [0, 1).
+        uint64_t bits = (static_cast<uint64_t>(hi) << 32) | lo;
+        return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    static void boxMuller(double u1, double u2, double& z0, double& z1) {
+        // u1 in [0, 1) is flipped to (0, 1] so the log is finite.
+        double r = std::sqrt(-2.0 * std::log(1.0 - u1));
+        double theta = 6.283185307179586 * u2;
+        z0 = r * std::cos(theta);
+        z1 = r * std::sin(theta);
+    }
+
+public:
+    explicit RandomStream(uint64_t seed = 0, uint64_t stream = 0) {
+        /*
+        Arguments:
+            seed: Selects the family of streams (e.g. a simulation or agent random_state).
+            stream: Selects one stream within it (e.g. an agent id).
+        */
+        key[0] = static_cast<uint32_t>(seed);
+        key[1] = static_cast<uint32_t>(seed >> 32);
+        stream_id[0] = static_cast<uint32_t>(stream);
+        stream_id[1] = static_cast<uint32_t>(stream >> 32);
+        block = 0;
+        pos = 4;
+        has_spare_normal = false;
+        spare_normal = 0;
+    }
+
+    void seek(uint64_t block) {
+        /*
+        Moves to the start of the stream's block-th block of four words, dropping any
+        buffered words and spare normal.  Lets a caller index its draws by position (e.g.
+        a fixed range of blocks per time step) rather than by how much was drawn before.
+        */
+        this->block = block;
+        pos = 4;
+        has_spare_normal = false;
+    }
+
+    uint32_t nextWord() {
+        if (pos == 4) { refill(); }
+        return buffer[pos++];
+    }
+
+    uint64_t nextU64() {
+        uint64_t hi = nextWord();
+        return (hi << 32) | nextWord();
+    }
+
+    double uniform() {
+        /*
+        Returns a draw from [0, 1).
+        */
+        uint32_t hi = nextWord();
+        return toUnit(hi, nextWord());
+    }
+
+    int uniformInt(int min, int max) {
+        /*
+        Returns an integer drawn uniformly from [min, max] (inclusive), without modulo bias.
+        */
+        if (max < min) {
+            throw std::invalid_argument("uniformInt requires min <= max.");
+        }
+        uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+        if (range > UINT32_MAX) {
+            return static_cast<int>(static_cast<int64_t>(min) + static_cast<int64_t>(nextU64() % range));
+        }
+
+        // Lemire's multiply-shift with rejection of the few biased products.
+        uint32_t r = static_cast<uint32_t>(range);
+        uint64_t m = static_cast<uint64_t>(nextWord()) * r;
+        if (static_cast<uint32_t>(m) < r) {
+            uint32_t threshold = static_cast<uint32_t>(-r) % r;
+            while (static_cast<uint32_t>(m) < threshold) {
+                m = static_cast<uint64_t>(nextWord()) * r;
+            }
+        }
+        return static_cast<int>(static_cast<int64_t>(min) + static_cast<int64_t>(m >> 32));
+    }
+
+    double normal(double mean = 0.0, double stddev = 1.0) {
+        if (has_spare_normal) {
+            has_spare_normal = false;
+            return mean + stddev * spare_normal;
+        }
+        double u1 = uniform();
+        double u2 = uniform();
+        double z0;
+        boxMuller(u1, u2, z0, spare_normal);
+        has_spare_normal = true;
+        return mean + stddev * z0;
+    }
+
+    double exponential(double mean = 1.0) {
+        return -mean * std::log(1.0 - uniform());
+    }
+
+    void fillUniform(double* out, std::size_t n) {
+        uint32_t words[SCRATCH];
+        while (n > 0) {
+            std::size_t chunk = n < SCRATCH / 2 ? n : SCRATCH / 2;
+            fillWords(words, 2 * chunk);
+            for (std::size_t i = 0; i < chunk; i++) {
+                out[i] = toUnit(words[2 * i], words[2 * i + 1]);
+            }
+            out += chunk;
+            n -= chunk;
+        }
+    }
+
+    void fillUniformInt(int* out, std::size_t n, int min, int max) {
+        for (std::size_t i = 0; i < n; i++) { out[i] = uniformInt(min, max); }
+    }
+
+    void fillNormal(double* out, std::size_t n, double mean = 0.0, double stddev = 1.0) {
+        if (n > 0 && has_spare_normal) {
+            *out++ = normal(mean, stddev);
+            n--;
+        }
+
+        double u[SCRATCH / 2];
+        while (n >= 2) {
+            std::size_t pairs = n / 2 < SCRATCH / 4 ? n / 2 : SCRATCH / 4;
+            fillUniform(u, 2 * pairs);
+            for (std::size_t i = 0; i < pairs; i++) {
+                double z0, z1;
+                boxMuller(u[2 * i], u[2 * i + 1], z0, z1);
+                out[2 * i] = mean + stddev * z0;
+                out[2 * i + 1] = mean + stddev * z1;
+            }
+            out += 2 * pairs;
+            n -= 2 * pairs;
+        }
+
+        if (n == 1) { *out = normal(mean, stddev); }
+    }
+
+    void fillExponential(double* out, std::size_t n, double mean = 1.0) {
+        fillUniform(out, n);
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = -mean * std::log(1.0 - out[i]);
+        }
+    }
+};
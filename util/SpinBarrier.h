@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+class SpinBarrier {
+    /*
+    Reusable barrier for a fixed number of threads that meet very often.
+
+    Arriving threads spin on a generation counter (yielding after a while, so an
+    oversubscribed machine still makes progress) instead of sleeping on a condition
+    variable, since the parallel Kernel crosses it twice per lookahead window.  Everything
+    a thread wrote before wait() is visible to every thread after it returns.
+    */
+
+    const std::size_t parties;
+    std::atomic<std::size_t> waiting;
+    std::atomic<std::size_t> generation;
+
+public:
+    explicit SpinBarrier(std::size_t parties) : parties(parties), waiting(0), generation(0) {}
+
+    SpinBarrier(const SpinBarrier&) = delete;
+    SpinBarrier& operator=(const SpinBarrier&) = delete;
+
+    void wait() {
+        std::size_t gen = generation.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+            waiting.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+            return;
+        }
+
+        unsigned spins = 0;
+        while (generation.load(std::memory_order_acquire) == gen) {
+            if (++spins > 4096) { std::this_thread::yield(); }
+        }
+    }
+};
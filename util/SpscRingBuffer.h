@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+template <typename T>
+class SpscRingBuffer {
+    /*
+    Bounded lock-free single-producer/single-consumer queue.
+
+    Exactly one thread may push and exactly one (other) thread may pop.  Capacity is
+    rounded up to a power of two.  Head and tail live on separate cache lines, and each
+    side caches the other's index so the common case touches only its own line.
+    */
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer holds trivially copyable records.");
+
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    std::unique_ptr<T[]> slots;
+    std::size_t mask;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> head{0};   // Next slot to write (producer).
+    std::size_t cached_tail = 0;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};   // Next slot to read (consumer).
+    std::size_t cached_head = 0;
+
+public:
+    explicit SpscRingBuffer(std::size_t capacity) {
+        if (capacity < 2) {
+            throw std::invalid_argument("SpscRingBuffer capacity must be at least 2.");
+        }
+        std::size_t size = 1;
+        while (size < capacity) { size <<= 1; }
+        slots.reset(new T[size]);
+        mask = size - 1;
+    }
+
+    bool tryPush(const T& item) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail > mask) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h - cached_tail > mask) { return false; }
+        }
+        slots[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t popBatch(T* out, std::size_t max_items) {
+        /*
+        Moves up to max_items records into out and returns how many were moved.
+        */
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t == cached_head) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t == cached_head) { return 0; }
+        }
+        std::size_t n = cached_head - t;
+        if (n > max_items) { n = max_items; }
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = slots[(t + i) & mask];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const {
+        return mask + 1;
+    }
+};
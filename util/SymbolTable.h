@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+typedef uint16_t SymbolId;
+
+class SymbolTable {
+    /*
+    Process-wide table assigning small integer ids to security symbols.
+
+    Symbols are interned once, at setup (agent and exchange construction, config
+    parsing); from then on orders, messages and agent state carry the SymbolId and the
+    string is only looked up again for output.  Id 0 is reserved for CASH, the special
+    holding worth one cent per share.
+
+        SymbolId abm = SymbolTable::intern("ABM");
+        std::string printable = SymbolTable::name(abm);
+    */
+
+    std::mutex mutex;
+    std::unordered_map<std::string, SymbolId> ids;
+    std::deque<std::string> names;      // Deque, so references handed out stay valid.
+
+    SymbolTable() {
+        ids.emplace("CASH", CASH);
+        names.push_back("CASH");
+    }
+
+    static SymbolTable& instance() {
+        static SymbolTable table;
+        return table;
+    }
+
+public:
+    static constexpr SymbolId CASH = 0;
+
+    static SymbolId intern(const std::string& name) {
+        SymbolTable& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.ids.find(name);
+        if (it != table.ids.end()) { return it->second; }
+
+        if (table.names.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many distinct symbols.");
+        }
+        SymbolId id = static_cast<SymbolId>(table.names.size());
+        table.ids.emplace(name, id);
+        table.names.push_back(name);
+        return id;
+    }
+
+    static std::optional<SymbolId> find(const std::string& name) {
+        SymbolTable& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.ids.find(name);
+        if (it == table.ids.end()) { return std::nullopt; }
+        return it->second;
+    }
+
+    static const std::string& name(SymbolId id) {
+        SymbolTable& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        if (id >= table.names.size()) {
+            throw std::out_of_range("Unknown symbol id " + std::to_string(id));
+        }
+        return table.names[id];
+    }
+
+    static std::size_t size() {
+        SymbolTable& table = instance();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.names.size();
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class ThreadPool {
+    /*
+    Fixed-size pool of worker threads with per-worker task deques and work stealing.
+
+    Each worker pops tasks LIFO from the back of its own deque and, when that is empty,
+    steals FIFO from the front of the other workers' deques, so long and short tasks
+    even out across threads without a single shared queue every worker contends on.
+    Tasks submitted from outside the pool are dealt round-robin across the workers;
+    tasks submitted from inside a task go to the submitting worker's own deque.
+
+        ThreadPool pool(8);
+        for (int i = 0; i < n; i++) { pool.submit([i] { work(i); }); }
+        pool.wait();
+
+    If a task throws, the first exception is kept and rethrown by wait(); the remaining
+    tasks still run.
+    */
+
+    typedef std::function<void()> Task;
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<std::size_t> queued;     // Submitted but not yet taken by a worker.
+    std::size_t unfinished;              // Submitted but not yet completed; guarded by state_mutex.
+    bool stopping;
+    std::exception_ptr error;            // First exception thrown by a task; guarded by state_mutex.
+    std::atomic<std::size_t> next_worker;
+
+    // The pool and worker index the current thread belongs to, if any.
+    static ThreadPool*& currentPool() { static thread_local ThreadPool* pool = nullptr; return pool; }
+    static std::size_t& currentWorker() { static thread_local std::size_t index = 0; return index; }
+
+    bool popLocal(std::size_t self, Task& task) {
+        Worker& worker = *workers[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) { return false; }
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t self, Task& task) {
+        for (std::size_t k = 1; k < workers.size(); k++) {
+            Worker& victim = *workers[(self + k) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) { continue; }
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t self) {
+        currentPool() = this;
+        currentWorker() = self;
+
+        Task task;
+        while (true) {
+            if (popLocal(self, task) || steal(self, task)) {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                try {
+                    task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    if (!error) { error = std::current_exception(); }
+                }
+                task = nullptr;
+
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (--unfinished == 0) { all_done.notify_all(); }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_available.wait(lock, [this] { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+            if (stopping && queued.load(std::memory_order_relaxed) == 0) { return; }
+        }
+    }
+
+public:
+    explicit ThreadPool(std::size_t num_threads = defaultThreads())
+        : queued(0), unfinished(0), stopping(false), next_worker(0) {
+        /*
+        Arguments:
+            num_threads: Number of worker threads; at least one is always started.
+        */
+        if (num_threads == 0) { num_threads = 1; }
+        for (std::size_t i = 0; i < num_threads; i++) {
+            workers.emplace_back(new Worker());
+        }
+        for (std::size_t i = 0; i < num_threads; i++) {
+            threads.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        /*
+        Runs every task already submitted, then joins the workers.
+        */
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& thread : threads) { thread.join(); }
+    }
+
+    static std::size_t defaultThreads() {
+        std::size_t n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : n;
+    }
+
+    std::size_t size() const {
+        return workers.size();
+    }
+
+    void submit(Task task) {
+        std::size_t target = currentPool() == this
+            ? currentWorker()
+            : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        {
+            // Counted before it is visible to workers, so it cannot finish before it is
+            // counted, and under the state lock so a worker about to sleep cannot miss it.
+            std::lock_guard<std::mutex> lock(state_mutex);
+            queued.fetch_add(1, std::memory_order_relaxed);
+            unfinished++;
+        }
+        {
+            Worker& worker = *workers[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        work_available.notify_one();
+    }
+
+    void wait() {
+        /*
+        Blocks until every submitted task has finished, then rethrows the first
+        exception a task threw, if any.  Must not be called from inside a task.
+        */
+        std::unique_lock<std::mutex> lock(state_mutex);
+        all_done.wait(lock, [this] { return unfinished == 0; });
+        if (error) {
+            std::exception_ptr thrown = error;
+            error = nullptr;
+            std::rethrow_exception(thrown);
+        }
+    }
+};
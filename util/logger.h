@@ -1,36 +1,106 @@
 #pragma once
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <stdexcept>
+
+enum class LogLevel {
+    TRACE = 0,
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR,
+    OFF
+};
 
 class Logger
 {
 private:
     std::ofstream logFile;
-    
-    
+    LogLevel level;
+    // Agents of a parallel Kernel run log from several threads.
+    std::mutex mutex;
+
+
 public:
     // Constructor to open the log file.
-    Logger(const std::string& filepath)
+    Logger(const std::string& filepath, LogLevel level = LogLevel::INFO) : level(level)
     {
         logFile.open(filepath, std::ios_base::app);
-        if (!logFile.is_open()) 
+        if (!logFile.is_open())
         {
             throw std::runtime_error("Unable to open log file: " + filepath);
         }
     }
 
-    // Method to write a line to the log file.
-    void log(const std::string& message) 
+    // True if messages at the given level will be written.
+    bool enabled(LogLevel messageLevel) const
     {
-        logFile << message << std::endl;
+        return messageLevel >= level;
+    }
+
+    void setLevel(LogLevel newLevel)
+    {
+        level = newLevel;
+    }
+
+    LogLevel getLevel() const
+    {
+        return level;
+    }
+
+    // Method to write a line to the log file.  Lines are buffered, not flushed;
+    // call flush() if the file must be up to date (e.g. before a crash-prone step).
+    void log(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        logFile << message << '\n';
+    }
+
+    // Writes the line only if the level is enabled.  The message has already been
+    // built by the caller; prefer the LOG_* macros below in hot paths.
+    void log(LogLevel messageLevel, const std::string& message)
+    {
+        if (enabled(messageLevel)) { log(message); }
+    }
+
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        logFile.flush();
     }
 
     // Destructor to close the log file.
     ~Logger() {
-        if (logFile.is_open()) 
+        if (logFile.is_open())
         {
             logFile.close();
         }
     }
-};
\ No newline at end of file
+};
+
+
+/* Level-gated logging.  The message expression is only evaluated when the level is
+   enabled, so disabled levels cost a single comparison and never format strings:
+
+       LOG_TRACE(logger, "Kernel handling " + msg->getName() + " ...");
+
+   Defining ABIDES_STRIP_TRACE (e.g. -DABIDES_STRIP_TRACE in release builds) removes
+   LOG_TRACE statements entirely at compile time. */
+
+#define ABIDES_LOG(logger, lvl, expr)                           \
+    do {                                                        \
+        if ((logger).enabled(lvl)) { (logger).log(expr); }      \
+    } while (0)
+
+#ifdef ABIDES_STRIP_TRACE
+#define LOG_TRACE(logger, expr) do { } while (0)
+#else
+#define LOG_TRACE(logger, expr) ABIDES_LOG(logger, LogLevel::TRACE, expr)
+#endif
+
+#define LOG_DEBUG(logger, expr) ABIDES_LOG(logger, LogLevel::DEBUG, expr)
+#define LOG_INFO(logger, expr) ABIDES_LOG(logger, LogLevel::INFO, expr)
+#define LOG_WARNING(logger, expr) ABIDES_LOG(logger, LogLevel::WARNING, expr)
+#define LOG_ERROR(logger, expr) ABIDES_LOG(logger, LogLevel::ERROR, expr)
@@ -0,0 +1,281 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../RandomStream.h"
+
+class LatencyModel {
+    /*
+    Network latency between agents, in nanoseconds, as applied by the Kernel to every
+    message it sends.
+
+    Every model answers a lookup in O(1) and stores O(agents) data at most (plus
+    whatever small tables it is configured with), so agent counts are not limited by an
+    n x n matrix.  Models that only depend on (sender, recipient) ignore `rng`; models
+    with per-message jitter draw from it (the Kernel passes the sender's own stream).
+
+    latency() is called concurrently in a parallel run, so implementations must not
+    modify shared state in it.
+    */
+
+public:
+    virtual ~LatencyModel() = default;
+
+    virtual int64_t latency(int sender, int recipient, RandomStream& rng) const = 0;
+    /*
+    Returns the latency of one message from sender to recipient.
+    */
+
+    virtual int64_t minLatency() const = 0;
+    /*
+    Returns a lower bound on latency() over all pairs and draws.  The parallel Kernel
+    uses it as its lookahead, so it must not be negative; models reject negative
+    latencies when built.
+    */
+
+    virtual void checkAgents(int /*n_agents*/) const {}
+    /*
+    Throws if the model cannot serve agent ids [0, n_agents).  Called by the Kernel
+    before a run.
+    */
+};
+
+
+class UniformLatencyModel : public LatencyModel {
+    /*
+    The same latency between every pair of agents.
+    */
+
+    int64_t value;
+
+public:
+    explicit UniformLatencyModel(int64_t latency) : value(latency) {
+        if (latency < 0) {
+            throw std::invalid_argument("UniformLatencyModel latency must be non-negative.");
+        }
+    }
+
+    int64_t latency(int, int, RandomStream&) const override {
+        return value;
+    }
+
+    int64_t minLatency() const override {
+        return value;
+    }
+};
+
+
+class GroupLatencyModel : public LatencyModel {
+    /*
+    Agents are assigned to groups (e.g. regions or co-location sites) and latency is a
+    group x group table: latency(s, r) = table[group(s)][group(r)].
+
+        // Agents 0-9 in NY (0), the rest in London (1).
+        std::vector<uint16_t> groups(n_agents, 1);
+        std::fill(groups.begin(), groups.begin() + 10, 0);
+        GroupLatencyModel model(groups, {{ 20000, 35000000 },
+                                         { 35000000, 20000 }});
+    */
+
+    std::vector<uint16_t> group_of;
+    std::size_t n_groups;
+    std::vector<int64_t> table;      // Row-major, n_groups x n_groups.
+    int64_t min_latency;
+
+public:
+    GroupLatencyModel(std::vector<uint16_t> groups, const std::vector<std::vector<int64_t>>& group_latency)
+        : group_of(std::move(groups)), n_groups(group_latency.size()) {
+        /*
+        Arguments:
+            groups: Group of each agent, indexed by agent id.
+            group_latency: Square table of non-negative latencies between groups.
+        */
+        if (n_groups == 0) {
+            throw std::invalid_argument("GroupLatencyModel needs at least one group.");
+        }
+        table.reserve(n_groups * n_groups);
+        for (const std::vector<int64_t>& row : group_latency) {
+            if (row.size() != n_groups) {
+                throw std::invalid_argument("GroupLatencyModel latency table must be square.");
+            }
+            for (int64_t latency : row) {
+                if (latency < 0) {
+                    throw std::invalid_argument("GroupLatencyModel latencies must be non-negative.");
+                }
+            }
+            table.insert(table.end(), row.begin(), row.end());
+        }
+        for (uint16_t g : group_of) {
+            if (g >= n_groups) {
+                throw std::invalid_argument("Agent assigned to unknown latency group " + std::to_string(g));
+            }
+        }
+        min_latency = *std::min_element(table.begin(), table.end());
+    }
+
+    int64_t latency(int sender, int recipient, RandomStream&) const override {
+        return table[group_of[sender] * n_groups + group_of[recipient]];
+    }
+
+    int64_t minLatency() const override {
+        return min_latency;
+    }
+
+    void checkAgents(int n_agents) const override {
+        if (group_of.size() < static_cast<std::size_t>(n_agents)) {
+            throw std::invalid_argument("GroupLatencyModel has groups for " + std::to_string(group_of.size())
+                                        + " agents, simulation has " + std::to_string(n_agents));
+        }
+    }
+};
+
+
+class CubicLatencyModel : public LatencyModel {
+    /*
+    Per-message jitter on top of a base model, as in ABIDES' "cubic" latency model:
+
+        x = uniform(jitter_clip, 1)
+        latency = base + (jitter / x^3) * (base / jitter_unit)
+
+    Most messages arrive close to the base latency, with a heavy tail of late ones.
+    jitter controls the tail, jitter_clip (in (0, 1]) bounds the worst case and
+    jitter_unit scales the extra delay relative to the base latency.
+    */
+
+    std::unique_ptr<LatencyModel> base;
+    double jitter;
+    double jitter_clip;
+    double jitter_unit;
+
+public:
+    CubicLatencyModel(std::unique_ptr<LatencyModel> base, double jitter = 0.5, double jitter_clip = 0.1,
+                      double jitter_unit = 10.0)
+        : base(std::move(base)), jitter(jitter), jitter_clip(jitter_clip), jitter_unit(jitter_unit) {
+        if (!this->base) {
+            throw std::invalid_argument("CubicLatencyModel needs a base model.");
+        }
+        if (jitter < 0 || jitter_clip <= 0 || jitter_clip > 1 || jitter_unit <= 0) {
+            throw std::invalid_argument("CubicLatencyModel needs jitter >= 0, 0 < jitter_clip <= 1, jitter_unit > 0.");
+        }
+    }
+
+    int64_t latency(int sender, int recipient, RandomStream& rng) const override {
+        int64_t min_latency = base->latency(sender, recipient, rng);
+        double x = jitter_clip + (1.0 - jitter_clip) * rng.uniform();
+        return min_latency + static_cast<int64_t>((jitter / (x * x * x)) * (min_latency / jitter_unit));
+    }
+
+    int64_t minLatency() const override {
+        // The extra term is non-negative for non-negative base latencies.
+        return base->minLatency();
+    }
+
+    void checkAgents(int n_agents) const override {
+        base->checkAgents(n_agents);
+    }
+};
+
+
+class PairwiseNoiseLatencyModel : public LatencyModel {
+    /*
+    A fixed, pseudo-random offset per (sender, recipient) pair on top of a base model,
+    so every link gets its own latency without storing one: the offset is a hash of
+    (seed, sender, recipient) mapped onto [0, max_noise].  Not symmetric: the two
+    directions of a link get independent offsets.
+    */
+
+    std::unique_ptr<LatencyModel> base;
+    uint64_t seed;
+    uint64_t span;
+
+    static uint64_t mix(uint64_t z) {
+        // SplitMix64 finaliser.
+        z += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    PairwiseNoiseLatencyModel(std::unique_ptr<LatencyModel> base, int64_t max_noise, uint64_t seed)
+        : base(std::move(base)), seed(seed) {
+        if (!this->base) {
+            throw std::invalid_argument("PairwiseNoiseLatencyModel needs a base model.");
+        }
+        if (max_noise < 0) {
+            throw std::invalid_argument("PairwiseNoiseLatencyModel max_noise must be non-negative.");
+        }
+        span = static_cast<uint64_t>(max_noise) + 1;
+    }
+
+    int64_t latency(int sender, int recipient, RandomStream& rng) const override {
+        uint64_t pair = (static_cast<uint64_t>(static_cast<uint32_t>(sender)) << 32) | static_cast<uint32_t>(recipient);
+        return base->latency(sender, recipient, rng) + static_cast<int64_t>(mix(pair ^ mix(seed)) % span);
+    }
+
+    int64_t minLatency() const override {
+        return base->minLatency();
+    }
+
+    void checkAgents(int n_agents) const override {
+        base->checkAgents(n_agents);
+    }
+};
+
+
+class OverrideLatencyModel : public LatencyModel {
+    /*
+    A base model with explicit latencies for a sparse set of (sender, recipient) pairs,
+    e.g. a co-located market maker's link to the exchange.  Overrides are directional.
+    */
+
+    std::unique_ptr<LatencyModel> base;
+    std::unordered_map<uint64_t, int64_t> overrides;
+    int64_t min_override;
+
+    static uint64_t key(int sender, int recipient) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(sender)) << 32) | static_cast<uint32_t>(recipient);
+    }
+
+public:
+    explicit OverrideLatencyModel(std::unique_ptr<LatencyModel> base)
+        : base(std::move(base)), min_override(INT64_MAX) {
+        if (!this->base) {
+            throw std::invalid_argument("OverrideLatencyModel needs a base model.");
+        }
+    }
+
+    void set(int sender, int recipient, int64_t latency) {
+        if (latency < 0) {
+            throw std::invalid_argument("OverrideLatencyModel latencies must be non-negative.");
+        }
+        overrides[key(sender, recipient)] = latency;
+        min_override = std::min(min_override, latency);
+    }
+
+    void setSymmetric(int a, int b, int64_t latency) {
+        set(a, b, latency);
+        set(b, a, latency);
+    }
+
+    int64_t latency(int sender, int recipient, RandomStream& rng) const override {
+        if (!overrides.empty()) {
+            auto it = overrides.find(key(sender, recipient));
+            if (it != overrides.end()) { return it->second; }
+        }
+        return base->latency(sender, recipient, rng);
+    }
+
+    int64_t minLatency() const override {
+        return std::min(base->minLatency(), min_override);
+    }
+
+    void checkAgents(int n_agents) const override {
+        base->checkAgents(n_agents);
+    }
+};
@@ -1,41 +1,108 @@
 #pragma once
 #include "Oracle.h"
+#include "FundamentalSeries.h"
+#include "FundamentalStore.h"
+#include "../RandomStream.h"
+#include "../timestamping.h"
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
-#include <vector>
-#include <fstream>
-#include <sstream>
 
-struct DataPoint
-{
-public:
-    std::string timestamp;
-    float value;
-};
 
 
-
-class ExternalFileOracle : Oracle
+class ExternalFileOracle : public Oracle
 /* Oracle using an external price series as the fundamental. The external series are specified files in the ABIDES
    config. If an agent requests the fundamental value in between two timestamps the returned fundamental value is
-   linearly interpolated. */
+   linearly interpolated.
+
+   The series file is normally in FundamentalSeries' binary format (see tools/ConvertFundamentals.cpp), which is
+   memory-mapped with no parsing.  A CSV file is still accepted, but is parsed on every load.
+
+   The series itself is shared and read-only: oracles built from the same file (see FundamentalStore), or handed
+   the same series, all point at one copy, however many simulations run in the process.  What is per-simulation
+   is an optional noise overlay: with noise_sd > 0 the fundamental is the series plus a noise path of that
+   standard deviation, drawn afresh for each noise_seed.  The noise at each series point is a function of
+   (noise_seed, point index) and is interpolated like the series, so it costs no memory and gives the same
+   answer whichever agent or thread asks. */
 {
 public:
-    ExternalFileOracle(const std::string& symbol, const std::string& file_path)
-    : symbol(symbol)
+    ExternalFileOracle(const std::string& symbol, const std::string& file_path, double noise_sd = 0, uint64_t noise_seed = 0)
+    : ExternalFileOracle(symbol, FundamentalStore::load(file_path), noise_sd, noise_seed)
+    {
+    }
+
+    ExternalFileOracle(const std::string& symbol, std::shared_ptr<const FundamentalSeries> series,
+                       double noise_sd = 0, uint64_t noise_seed = 0)
+    : symbol(symbol), symbol_id(SymbolTable::intern(symbol)), fundamental(std::move(series)),
+      noise_sd(noise_sd), noise_seed(noise_seed)
+    {
+        if (!fundamental)
+        {
+            throw std::invalid_argument("ExternalFileOracle needs a fundamental series.");
+        }
+    }
+
+    double getFundamental(SymbolId symbol, const Timestamp& time) override
     {
-        load_fundamentals(file_path);
+        if (symbol != symbol_id)
+        {
+            throw std::invalid_argument("ExternalFileOracle has no fundamental for symbol " + SymbolTable::name(symbol));
+        }
+        return getFundamental(time);
+    }
+
+    double getFundamental(SymbolId symbol, const Timestamp& time, OracleCursor& cursor) override
+    {
+        if (symbol != symbol_id)
+        {
+            throw std::invalid_argument("ExternalFileOracle has no fundamental for symbol " + SymbolTable::name(symbol));
+        }
+        SeriesCursor series_cursor{cursor.position};
+        double value = getFundamental(time, series_cursor);
+        cursor.position = series_cursor.index;
+        return value;
+    }
+
+    double getFundamental(const Timestamp& time) const
+    {
+        /* Fundamental value at time, interpolated (see FundamentalSeries::interpolate). */
+        SeriesCursor cursor;
+        return getFundamental(time, cursor);
+    }
+
+    double getFundamental(const Timestamp& time, SeriesCursor& cursor) const
+    {
+        /* As above, continuing from the caller's cursor; amortised O(1) for a caller whose
+           queries move forward in time, e.g. an agent asking at every wakeup. */
+        int64_t t = time.to_nanoseconds();
+        double value = fundamental->interpolate(t, cursor);
+        return noise_sd > 0 ? value + noise(t, cursor.index) : value;
+    }
+
+    void getFundamentals(const Timestamp* times, std::size_t count, double* values, SeriesCursor& cursor) const
+    {
+        /* Fills values[k] with the fundamental value at times[k], for count times. */
+        for (std::size_t k = 0; k < count; k++)
+        {
+            values[k] = getFundamental(times[k], cursor);
+        }
+    }
+
+    const FundamentalSeries& series() const
+    {
+        return *fundamental;
     }
 
     void print(const int& index)
     {
-        if (index > fundamental.size())
+        if (index < 0 || static_cast<std::size_t>(index) >= fundamental->size())
         {
-            std::cout << "Index too large.\n" << "Max index: " << fundamental.size() << std::endl;
+            std::cout << "Index too large.\n" << "Max index: " << fundamental->size() << std::endl;
         }
         else
         {
-            std::cout << fundamental[index].timestamp << "  " << fundamental[index].value << std::endl;
+            std::cout << Timestamp(fundamental->time(index)).to_string() << "  " << fundamental->value(index) << std::endl;
         }
 
     }
@@ -43,34 +110,25 @@ public:
 private:
     int mkt_open;
     std::string symbol;
-    std::vector<DataPoint> fundamental;
+    SymbolId symbol_id;
+    std::shared_ptr<const FundamentalSeries> fundamental;
+    double noise_sd;
+    uint64_t noise_seed;
 
-    void load_fundamentals(const std::string& file_path)
+    double pointNoise(std::size_t i) const
     {
-        std::ifstream file(file_path);
-        if (!file.is_open()) 
-        {
-            std::cout << "Unable to open fundamental file." << std::endl;
-            return; 
-        }
-        
-        std::string line;
-        while (std::getline(file, line))
-        {
-            std::stringstream lineStream(line);
-            std::string timestamp;
-            std::string valueStr;
-
-            // Read the timestamp and value.
-            if (std::getline(lineStream, timestamp, ',') && std::getline(lineStream, valueStr))
-            {
-                DataPoint dp;
-                dp.timestamp = timestamp;
-                dp.value = std::stof(valueStr);
-                fundamental.push_back(dp);
-            }
-        }
-        file.close();
+        return RandomStream(noise_seed, i).normal(0.0, noise_sd);
     }
 
-};
\ No newline at end of file
+    double noise(int64_t t, std::size_t i) const
+    {
+        // Noise at t, interpolated between the noise at series points i and i + 1.
+        const FundamentalSeries& s = *fundamental;
+        if (s.empty()) { return 0; }
+        if (i + 1 >= s.size() || t <= s.time(i)) { return pointNoise(i); }
+        double w = static_cast<double>(t - s.time(i)) / static_cast<double>(s.time(i + 1) - s.time(i));
+        double n0 = pointNoise(i);
+        return n0 + (pointNoise(i + 1) - n0) * w;
+    }
+
+};
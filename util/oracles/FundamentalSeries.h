@@ -0,0 +1,404 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct SeriesCursor {
+    /*
+    A caller's position in a FundamentalSeries, so that lookups moving forward in time
+    (the usual case: an agent asking at each wakeup) start where the last one ended
+    instead of searching from scratch.  Each caller (agent, thread) keeps its own.
+    */
+    std::size_t index = 0;
+};
+
+
+class FundamentalSeries {
+    /*
+    Read-only fundamental value series: ascending timestamps (int64 ns since the epoch,
+    UTC) and their values (double), as two parallel columns.
+
+    The binary file is the columns as-is, so open() maps it and points into the mapping
+    with no parsing or copying.  It reads the time column once to check it ascends;
+    value pages are only read when touched, and processes (or simulations) opening the
+    same file share them through the page cache.
+
+        File layout (little-endian, native widths):
+            char[8]  "ABIDESFS"
+            uint32   format version (1)
+            uint32   reserved (0)
+            uint64   number of points N
+            int64[N] time
+            double[N] value
+
+    CSV files ("dd/mm/yyyy[ HH:MM[:SS[.fff]]],value" per line, as in data/) are only an
+    import route: importCsv() parses one into memory, and convertCsv() (or the
+    convert_fundamentals tool) writes the binary file once so every later run can map it.
+    */
+
+    static constexpr char MAGIC[8] = {'A', 'B', 'I', 'D', 'E', 'S', 'F', 'S'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr std::size_t HEADER_SIZE = 24;
+
+    const int64_t* time_data;
+    const double* value_data;
+    std::size_t n;
+
+    // Either a mapping of the file or columns owned by this object.
+    void* map;
+    std::size_t map_size;
+    std::vector<int64_t> owned_times;
+    std::vector<double> owned_values;
+
+    void unmap() {
+        if (map != nullptr) { munmap(map, map_size); }
+        map = nullptr;
+        map_size = 0;
+    }
+
+    void steal(FundamentalSeries& other) {
+        map = other.map;
+        map_size = other.map_size;
+        owned_times = std::move(other.owned_times);
+        owned_values = std::move(other.owned_values);
+        n = other.n;
+        if (map != nullptr) {
+            time_data = other.time_data;
+            value_data = other.value_data;
+        }
+        else {
+            time_data = owned_times.data();
+            value_data = owned_values.data();
+        }
+        other.map = nullptr;
+        other.map_size = 0;
+        other.time_data = nullptr;
+        other.value_data = nullptr;
+        other.n = 0;
+    }
+
+    std::size_t segment(int64_t t) const {
+        // Index of the last point at or before t (0 if t precedes every point).
+        std::size_t i = static_cast<std::size_t>(std::upper_bound(time_data, time_data + n, t) - time_data);
+        return i == 0 ? 0 : i - 1;
+    }
+
+    double valueAt(int64_t t, std::size_t i) const {
+        // Interpolates within the segment starting at point i.
+        if (n == 0) { return std::numeric_limits<double>::quiet_NaN(); }
+        if (i + 1 >= n || t <= time_data[i]) { return value_data[i]; }
+        int64_t t0 = time_data[i];
+        int64_t t1 = time_data[i + 1];
+        double v0 = value_data[i];
+        return v0 + (value_data[i + 1] - v0) * (static_cast<double>(t - t0) / static_cast<double>(t1 - t0));
+    }
+
+    static bool parseDigits(const char*& p, const char* end, int max_digits, int& out) {
+        int digits = 0;
+        out = 0;
+        while (p < end && digits < max_digits && *p >= '0' && *p <= '9') {
+            out = out * 10 + (*p - '0');
+            p++;
+            digits++;
+        }
+        return digits > 0;
+    }
+
+    static bool parseTimestamp(const char* p, const char* end, int64_t& ns) {
+        // dd/mm/yyyy, optionally followed by ' ' or 'T' and HH:MM[:SS[.fraction]].
+        std::tm tm{};
+        int day, month, year;
+        if (!parseDigits(p, end, 2, day) || p == end || *p++ != '/') { return false; }
+        if (!parseDigits(p, end, 2, month) || p == end || *p++ != '/') { return false; }
+        if (!parseDigits(p, end, 4, year)) { return false; }
+        if (day < 1 || day > 31 || month < 1 || month > 12) { return false; }
+        tm.tm_mday = day;
+        tm.tm_mon = month - 1;
+        tm.tm_year = year - 1900;
+
+        int64_t fraction_ns = 0;
+        if (p < end && (*p == ' ' || *p == 'T')) {
+            p++;
+            int hour, minute, second = 0;
+            if (!parseDigits(p, end, 2, hour) || p == end || *p++ != ':') { return false; }
+            if (!parseDigits(p, end, 2, minute)) { return false; }
+            if (p < end && *p == ':') {
+                p++;
+                if (!parseDigits(p, end, 2, second)) { return false; }
+                if (p < end && *p == '.') {
+                    p++;
+                    int64_t scale = 100000000;
+                    while (p < end && *p >= '0' && *p <= '9') {
+                        fraction_ns += (*p - '0') * scale;
+                        scale /= 10;
+                        p++;
+                    }
+                }
+            }
+            tm.tm_hour = hour;
+            tm.tm_min = minute;
+            tm.tm_sec = second;
+        }
+        while (p < end && (*p == ' ' || *p == '"')) { p++; }
+        if (p != end) { return false; }
+
+        ns = static_cast<int64_t>(timegm(&tm)) * 1000000000LL + fraction_ns;
+        return true;
+    }
+
+public:
+    FundamentalSeries() : time_data(nullptr), value_data(nullptr), n(0), map(nullptr), map_size(0) {}
+
+    FundamentalSeries(std::vector<int64_t> times, std::vector<double> values)
+        : n(times.size()), map(nullptr), map_size(0), owned_times(std::move(times)), owned_values(std::move(values)) {
+        /*
+        An in-memory series.  Points are sorted by time (stably, so equal timestamps keep
+        their order).
+        */
+        if (owned_times.size() != owned_values.size()) {
+            throw std::invalid_argument("FundamentalSeries needs as many values as timestamps.");
+        }
+        if (!std::is_sorted(owned_times.begin(), owned_times.end())) {
+            std::vector<std::size_t> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                             [&](std::size_t a, std::size_t b) { return owned_times[a] < owned_times[b]; });
+            std::vector<int64_t> sorted_times(n);
+            std::vector<double> sorted_values(n);
+            for (std::size_t i = 0; i < n; i++) {
+                sorted_times[i] = owned_times[order[i]];
+                sorted_values[i] = owned_values[order[i]];
+            }
+            owned_times.swap(sorted_times);
+            owned_values.swap(sorted_values);
+        }
+        time_data = owned_times.data();
+        value_data = owned_values.data();
+    }
+
+    FundamentalSeries(const FundamentalSeries&) = delete;
+    FundamentalSeries& operator=(const FundamentalSeries&) = delete;
+
+    FundamentalSeries(FundamentalSeries&& other) noexcept : map(nullptr), map_size(0) {
+        steal(other);
+    }
+
+    FundamentalSeries& operator=(FundamentalSeries&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~FundamentalSeries() {
+        unmap();
+    }
+
+    std::size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    const int64_t* times() const { return time_data; }
+    const double* values() const { return value_data; }
+
+    int64_t time(std::size_t i) const { return time_data[i]; }
+    double value(std::size_t i) const { return value_data[i]; }
+
+    double interpolate(int64_t t) const {
+        /*
+        Value at time t (ns), linearly interpolated between the surrounding points and
+        held flat before the first and after the last one.  NaN for an empty series.
+        Binary search; prefer the cursor overload for lookups that move forward in time.
+        */
+        SeriesCursor cursor;
+        cursor.index = segment(t);
+        return valueAt(t, cursor.index);
+    }
+
+    double interpolate(int64_t t, SeriesCursor& cursor) const {
+        /*
+        As above, starting from the caller's cursor: amortised O(1) when successive
+        lookups move forward in time by a few points at most, O(log n) otherwise.
+        */
+        std::size_t i = cursor.index;
+        if (i >= n || t < time_data[i]) {
+            i = segment(t);
+        }
+        else {
+            // Step forward a little, then fall back to searching the rest.
+            std::size_t steps = 0;
+            while (i + 1 < n && time_data[i + 1] <= t && steps < 8) { i++; steps++; }
+            if (i + 1 < n && time_data[i + 1] <= t) {
+                i = static_cast<std::size_t>(std::upper_bound(time_data + i + 1, time_data + n, t) - time_data) - 1;
+            }
+        }
+        cursor.index = i;
+        return valueAt(t, i);
+    }
+
+    void interpolate(const int64_t* t, std::size_t count, double* out, SeriesCursor& cursor) const {
+        /*
+        Fills out[k] with the value at t[k], for count times.  Fastest when t is sorted.
+        */
+        for (std::size_t k = 0; k < count; k++) {
+            out[k] = interpolate(t[k], cursor);
+        }
+    }
+
+    static bool isBinary(const std::string& path) {
+        // True if the file starts with the binary format's magic.
+        char magic[sizeof(MAGIC)];
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (f == nullptr) { return false; }
+        bool binary = std::fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+                      && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+        std::fclose(f);
+        return binary;
+    }
+
+    static FundamentalSeries open(const std::string& path) {
+        /*
+        Maps a binary series file.  Its times must ascend, as write() leaves them, since
+        interpolate() searches them.  The file must not be modified while mapped.
+        */
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open fundamental file: " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < HEADER_SIZE) {
+            ::close(fd);
+            throw std::runtime_error("Not a fundamental series file: " + path);
+        }
+        std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            throw std::runtime_error("Unable to map fundamental file: " + path);
+        }
+
+        FundamentalSeries series;
+        series.map = map;
+        series.map_size = size;
+
+        const char* base = static_cast<const char*>(map);
+        uint32_t version;
+        uint64_t count;
+        std::memcpy(&version, base + 8, sizeof(version));
+        std::memcpy(&count, base + 16, sizeof(count));
+        if (std::memcmp(base, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION) {
+            throw std::runtime_error("Not a version " + std::to_string(VERSION) + " fundamental series file: " + path);
+        }
+        if (count > (size - HEADER_SIZE) / (sizeof(int64_t) + sizeof(double))
+            || HEADER_SIZE + count * (sizeof(int64_t) + sizeof(double)) != size) {
+            throw std::runtime_error("Truncated fundamental series file: " + path);
+        }
+
+        series.n = static_cast<std::size_t>(count);
+        series.time_data = reinterpret_cast<const int64_t*>(base + HEADER_SIZE);
+        series.value_data = reinterpret_cast<const double*>(base + HEADER_SIZE + count * sizeof(int64_t));
+        if (!std::is_sorted(series.time_data, series.time_data + series.n)) {
+            throw std::runtime_error("Fundamental series file is not sorted by time: " + path);
+        }
+        return series;
+    }
+
+    void write(const std::string& path) const {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (f == nullptr) {
+            throw std::runtime_error("Unable to open fundamental file for writing: " + path);
+        }
+        uint32_t version = VERSION;
+        uint32_t reserved = 0;
+        uint64_t count = n;
+        std::fwrite(MAGIC, 1, sizeof(MAGIC), f);
+        std::fwrite(&version, sizeof(version), 1, f);
+        std::fwrite(&reserved, sizeof(reserved), 1, f);
+        std::fwrite(&count, sizeof(count), 1, f);
+        if (n > 0) {
+            std::fwrite(time_data, sizeof(int64_t), n, f);
+            std::fwrite(value_data, sizeof(double), n, f);
+        }
+        bool failed = std::ferror(f) != 0;
+        if (std::fclose(f) != 0 || failed) {
+            throw std::runtime_error("Error writing fundamental file: " + path);
+        }
+    }
+
+    static FundamentalSeries importCsv(const std::string& path) {
+        /*
+        Parses a "timestamp,value" CSV file into memory.  Blank lines and a header line
+        are skipped; anything else that does not parse is an error.
+        */
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (f == nullptr) {
+            throw std::runtime_error("Unable to open fundamental file: " + path);
+        }
+        std::string text;
+        char chunk[1 << 16];
+        std::size_t got;
+        while ((got = std::fread(chunk, 1, sizeof(chunk), f)) > 0) { text.append(chunk, got); }
+        std::fclose(f);
+
+        std::vector<int64_t> times;
+        std::vector<double> values;
+        const char* p = text.c_str();
+        const char* text_end = p + text.size();
+        std::size_t line = 0;
+        while (p < text_end) {
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', text_end - p));
+            if (eol == nullptr) { eol = text_end; }
+            line++;
+            const char* end = eol;
+            while (end > p && (end[-1] == '\r' || end[-1] == ' ')) { end--; }
+
+            if (end > p) {
+                const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+                int64_t ns;
+                if (comma != nullptr && parseTimestamp(p, comma, ns)) {
+                    char* value_end;
+                    double value = std::strtod(comma + 1, &value_end);
+                    if (value_end == comma + 1 || value_end != end) {
+                        throw std::runtime_error(path + ":" + std::to_string(line) + ": bad value");
+                    }
+                    times.push_back(ns);
+                    values.push_back(value);
+                }
+                else if (!(line == 1 && !std::isdigit(static_cast<unsigned char>(*p)))) {
+                    throw std::runtime_error(path + ":" + std::to_string(line) + ": bad timestamp");
+                }
+            }
+            p = eol + 1;
+        }
+        return FundamentalSeries(std::move(times), std::move(values));
+    }
+
+    static std::size_t convertCsv(const std::string& csv_path, const std::string& out_path) {
+        /*
+        One-time import of a CSV series into the binary format.  Returns the number of points.
+        */
+        FundamentalSeries series = importCsv(csv_path);
+        series.write(out_path);
+        return series.size();
+    }
+
+    static FundamentalSeries load(const std::string& path) {
+        /*
+        Maps a binary file, or imports a CSV one (slower; convert it once instead).
+        */
+        return isBinary(path) ? open(path) : importCsv(path);
+    }
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "FundamentalSeries.h"
+
+class FundamentalStore {
+    /*
+    Process-wide cache of loaded fundamental series, so every oracle in the process (one
+    per simulation, e.g. across a BatchRunner sweep) shares one read-only copy of each
+    file instead of loading its own:
+
+        std::shared_ptr<const FundamentalSeries> aapl = FundamentalStore::load("data/AAPL.fs");
+
+    Series are immutable once loaded and can be read from any thread.  The store only
+    holds weak references: a series is unmapped once the last oracle using it is gone,
+    and loaded again by the next load() of its path.
+    */
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<const FundamentalSeries>> series;
+
+    static FundamentalStore& instance() {
+        static FundamentalStore store;
+        return store;
+    }
+
+public:
+    static std::shared_ptr<const FundamentalSeries> load(const std::string& path) {
+        /*
+        Returns the series in the file at path (see FundamentalSeries::load), loading it
+        only if no one holds it already.  Paths are used as given, so spell each file the
+        same way everywhere.
+        */
+        FundamentalStore& store = instance();
+        // Loads are rare (once per file per sweep), so they simply happen under the lock.
+        std::lock_guard<std::mutex> lock(store.mutex);
+
+        std::shared_ptr<const FundamentalSeries> loaded = store.series[path].lock();
+        if (!loaded) {
+            loaded = std::make_shared<const FundamentalSeries>(FundamentalSeries::load(path));
+            store.series[path] = loaded;
+        }
+        return loaded;
+    }
+};
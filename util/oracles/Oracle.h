@@ -1,6 +1,77 @@
 #pragma once
+#include <cmath>
+#include <cstddef>
+#include "../RandomStream.h"
+#include "../SymbolTable.h"
+#include "../timestamping.h"
+
+struct OracleCursor
+{
+    /*
+    A caller's place in an oracle's data, e.g. the series point it last looked up.  Each
+    agent keeps its own and passes it with every query, so an oracle backed by a time
+    series (ExternalFileOracle) resumes from where that agent last asked, amortised O(1)
+    while its queries move forward in time, instead of searching afresh.  Oracles with
+    nothing to resume ignore it.  Use one cursor per symbol.
+    */
+    std::size_t position = 0;
+};
+
 
 class Oracle
 {
+    /*
+    Source of the fundamental value of each symbol.  The Kernel holds the simulation's
+    oracle (see Kernel::runner) and agents reach it through their kernel reference.
+
+    Agents that query repeatedly should keep an OracleCursor and pass it with each query.
+
+    Oracles may be called from several threads at once in a parallel run.
+    */
+public:
+    virtual ~Oracle() = default;
+
+    virtual double getFundamental(SymbolId symbol, const Timestamp& time) = 0;
+    /*
+    Returns the true fundamental value of symbol at time.
+    */
+
+    virtual double getFundamental(SymbolId symbol, const Timestamp& time, OracleCursor& /*cursor*/)
+    {
+        /*
+        As above, continuing from the caller's cursor.  The default ignores the cursor.
+        */
+        return getFundamental(symbol, time);
+    }
+
+    virtual int getDailyOpenPrice(SymbolId symbol, const Timestamp& mkt_open)
+    {
+        /*
+        Returns the opening price of symbol, e.g. for an exchange seeding its books.
+        */
+        return static_cast<int>(std::lround(getFundamental(symbol, mkt_open)));
+    }
+
+    virtual int observePrice(SymbolId symbol, const Timestamp& time, double sigma_n, RandomStream& rng,
+                             OracleCursor& cursor)
+    {
+        /*
+        Returns a noisy observation of the fundamental: the true value plus normal noise of
+        variance sigma_n, rounded to an integer price.  The noise is drawn from the
+        caller's stream (e.g. the observing agent's own), so observations do not disturb
+        the fundamental path or each other.
+        */
+        double value = getFundamental(symbol, time, cursor);
+        if (sigma_n > 0) { value = rng.normal(value, std::sqrt(sigma_n)); }
+        return static_cast<int>(std::lround(value));
+    }
 
-};
\ No newline at end of file
+    int observePrice(SymbolId symbol, const Timestamp& time, double sigma_n, RandomStream& rng)
+    {
+        /*
+        As above, for a one-off observation with no cursor to keep.
+        */
+        OracleCursor cursor;
+        return observePrice(symbol, time, sigma_n, rng, cursor);
+    }
+};
@@ -0,0 +1,256 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Oracle.h"
+
+struct SparseMeanRevertingParams {
+    /*
+    Parameters of one symbol's fundamental, in ABIDES' units (prices in cents, rates
+    per nanosecond).  The defaults are ABIDES' usual configuration, except fund_vol:
+    ABIDES' 5e-5 was tuned for its variance-as-deviation draw (see below), and 1e-8 here
+    gives a daily standard deviation of about 0.5% of r_bar.
+    */
+    double r_bar = 100000;                  // Long-run mean.
+    double kappa = 1.67e-16;                // Mean reversion rate.
+    double fund_vol = 1e-8;                 // Variance of the fundamental's innovations, per ns.
+    double megashock_lambda_a = 2.77778e-18; // Megashock arrival rate (Poisson).
+    double megashock_mean = 1000;           // Megashock magnitude; the sign is a coin flip.
+    double megashock_var = 50000;           // Megashock variance.
+    int64_t grid = 1000000000;              // Spacing of the time grid the path is drawn on (ns).
+};
+
+
+class SparseMeanRevertingOracle : public Oracle {
+    /*
+    Synthetic fundamental: a mean-reverting Ornstein-Uhlenbeck process with occasional
+    "megashocks" (jumps of normally distributed size around +/-megashock_mean), as
+    ABIDES' SparseMeanRevertingOracle.
+
+    The value at any time is a pure function of (seed, symbol, time), so it does not
+    depend on which agent asks first; agents on different LPs of a parallel run all see
+    the same path as a sequential run.  The path is drawn on a fixed grid of params.grid
+    ns from mkt_open: step k moves the value from grid point k to k + 1 with the
+    closed-form OU transition density
+
+        v(t) ~ N(r_bar + (v(s) - r_bar) e^{-kappa d},  fund_vol / (2 kappa) (1 - e^{-2 kappa d})),  d = t - s
+
+    using draws from the symbol's stream at a block range fixed by k.  A step holds at
+    most one megashock, with probability 1 - e^{-megashock_lambda_a grid} (the chance of
+    a second is negligible at realistic rates), at a uniform time within it.  Between grid
+    points the value is drawn from the OU bridge between its neighbours (split at any
+    megashock) with a draw indexed by the query time, so each time is correctly
+    distributed though two times within one step are not jointly a path.
+
+    Being a function of time rather than of the previous query costs this over a single
+    closed-form draw from the last value: reaching a time means stepping every grid point
+    before it.  Each symbol keeps the value at every CHECKPOINT_EVERY-th grid point
+    reached (one double per 64 steps, e.g. under 3 KiB for a 6.5 hour day on a 1 s grid)
+    and a window of the CHECKPOINT_EVERY steps after one checkpoint.  A query in the
+    window is O(1); one past it steps from the nearest checkpoint below, at most
+    CHECKPOINT_EVERY steps, or from the furthest one reached.  So queries moving forward
+    cost amortised O(1) per grid step crossed, the first query far ahead costs
+    O(elapsed / grid), and a query behind the window costs O(CHECKPOINT_EVERY).
+
+    Unlike ABIDES, which passes the variance above as the standard deviation, the draws
+    use its square root.  Values are floored at 0.  Times before mkt_open are treated as
+    mkt_open and times after mkt_close as the last nanosecond before it.  Each symbol is
+    guarded by its own mutex, as its checkpoints and window change on demand.
+    */
+
+    // Blocks of the grid stream reserved for each grid step; a step draws at most 13 words.
+    static constexpr uint64_t BLOCKS_PER_STEP = 4;
+    // Grid steps between kept values; also the length of the window of steps kept in full.
+    static constexpr uint64_t CHECKPOINT_EVERY = 64;
+
+    struct GridPoint {
+        double value;                   // At this grid point.
+        // The megashock in the step that starts here, if any: its time (ns after mkt_open),
+        // the value just before it and its size.  shock_time is INT64_MAX if there is none.
+        int64_t shock_time;
+        double before_shock;
+        double shock;
+    };
+
+    struct SymbolState {
+        SparseMeanRevertingParams params;
+        std::vector<double> checkpoints;    // Value at grid point j * CHECKPOINT_EVERY, as far as reached.
+        std::vector<GridPoint> window;      // Grid points window_start .. window_start + CHECKPOINT_EVERY.
+        uint64_t window_start = 0;
+        RandomStream grid_rng;          // Indexed by grid step.
+        RandomStream bridge_rng;        // Indexed by query time.
+        std::mutex mutex;
+    };
+
+    int64_t mkt_open;
+    int64_t mkt_close;
+    std::vector<std::unique_ptr<SymbolState>> states;    // Indexed by SymbolId.
+
+    static double variance(const SparseMeanRevertingParams& p, double d) {
+        // Variance of the OU transition over d ns.
+        if (p.kappa > 0) { return p.fund_vol / (2 * p.kappa) * -std::expm1(-2 * p.kappa * d); }
+        return p.fund_vol * d;
+    }
+
+    static double decay(const SparseMeanRevertingParams& p, double d) {
+        return p.kappa > 0 ? std::exp(-p.kappa * d) : 1.0;
+    }
+
+    static double transition(const SparseMeanRevertingParams& p, double from, int64_t elapsed, RandomStream& rng) {
+        // One closed-form OU transition from `from` over elapsed ns.
+        double d = static_cast<double>(elapsed);
+        double mean = p.r_bar + (from - p.r_bar) * decay(p, d);
+        return rng.normal(mean, std::sqrt(std::max(variance(p, d), 0.0)));
+    }
+
+    static double bridge(const SparseMeanRevertingParams& p, int64_t s, double a, int64_t u, double b,
+                         int64_t t, RandomStream& rng) {
+        // A draw of the OU process at t given its values a at s and b at u (s < t < u).
+        double d1 = static_cast<double>(t - s);
+        double d2 = static_cast<double>(u - t);
+        double v1 = variance(p, d1);
+        double vD = variance(p, static_cast<double>(u - s));
+        double mean = p.r_bar + (a - p.r_bar) * decay(p, d1);
+        double var = 0;
+        if (vD > 0) {
+            double w = decay(p, d2) * v1 / vD;
+            mean += w * (b - p.r_bar - (a - p.r_bar) * decay(p, static_cast<double>(u - s)));
+            var = v1 - w * decay(p, d2) * v1;
+        }
+        return rng.normal(mean, std::sqrt(std::max(var, 0.0)));
+    }
+
+    static double step(SymbolState& s, uint64_t k, GridPoint& point) {
+        // Draws step k from grid point `point` (k), recording any megashock in it, and
+        // returns the value at grid point k + 1.
+        const SparseMeanRevertingParams& p = s.params;
+        const int64_t start = static_cast<int64_t>(k) * p.grid;
+        s.grid_rng.seek(k * BLOCKS_PER_STEP);
+
+        point.shock_time = std::numeric_limits<int64_t>::max();
+        point.before_shock = 0;
+        point.shock = 0;
+        double next;
+        if (p.megashock_lambda_a > 0 && s.grid_rng.uniform() < -std::expm1(-p.megashock_lambda_a * p.grid)) {
+            int64_t offset = std::max<int64_t>(1, static_cast<int64_t>(s.grid_rng.uniform() * p.grid));
+            double mean = s.grid_rng.uniformInt(0, 1) == 0 ? p.megashock_mean : -p.megashock_mean;
+            point.shock = s.grid_rng.normal(mean, std::sqrt(p.megashock_var));
+            point.shock_time = start + offset;
+            point.before_shock = std::max(0.0, transition(p, point.value, offset, s.grid_rng));
+            double after = std::max(0.0, point.before_shock + point.shock);
+            next = transition(p, after, p.grid - offset, s.grid_rng);
+        }
+        else {
+            next = transition(p, point.value, p.grid, s.grid_rng);
+        }
+        return std::max(0.0, next);
+    }
+
+    static void fillWindow(SymbolState& s, std::size_t checkpoint) {
+        // Steps the window from the given checkpoint, adding the next checkpoint if new.
+        s.window_start = checkpoint * CHECKPOINT_EVERY;
+        s.window[0].value = s.checkpoints[checkpoint];
+        for (uint64_t i = 0; i < CHECKPOINT_EVERY; i++) {
+            s.window[i + 1].value = step(s, s.window_start + i, s.window[i]);
+        }
+        if (s.checkpoints.size() == checkpoint + 1) {
+            s.checkpoints.push_back(s.window[CHECKPOINT_EVERY].value);
+        }
+    }
+
+    static double valueAt(SymbolState& s, int64_t t) {
+        // The value at t ns after mkt_open.
+        const SparseMeanRevertingParams& p = s.params;
+        const uint64_t k = static_cast<uint64_t>(t / p.grid);
+        const int64_t start = static_cast<int64_t>(k) * p.grid;
+
+        if (k < s.window_start || k >= s.window_start + CHECKPOINT_EVERY) {
+            const std::size_t checkpoint = k / CHECKPOINT_EVERY;
+            while (s.checkpoints.size() <= checkpoint) { fillWindow(s, s.checkpoints.size() - 1); }
+            if (s.window_start != checkpoint * CHECKPOINT_EVERY) { fillWindow(s, checkpoint); }
+        }
+
+        const GridPoint& point = s.window[k - s.window_start];
+        const GridPoint& next = s.window[k - s.window_start + 1];
+        if (t == start) { return point.value; }
+        double after = std::max(0.0, point.before_shock + point.shock);
+        if (t == point.shock_time) { return after; }
+
+        s.bridge_rng.seek(static_cast<uint64_t>(t));
+        double value;
+        if (t < point.shock_time) {
+            int64_t end = std::min(point.shock_time, start + p.grid);
+            double target = end == point.shock_time ? point.before_shock : next.value;
+            value = bridge(p, start, point.value, end, target, t, s.bridge_rng);
+        }
+        else {
+            value = bridge(p, point.shock_time, after, start + p.grid, next.value, t, s.bridge_rng);
+        }
+        return std::max(0.0, value);
+    }
+
+    SymbolState& state(SymbolId symbol) {
+        if (symbol >= states.size() || !states[symbol]) {
+            throw std::invalid_argument("SparseMeanRevertingOracle has no fundamental for symbol "
+                                        + SymbolTable::name(symbol));
+        }
+        return *states[symbol];
+    }
+
+public:
+    using Oracle::getFundamental;
+
+    SparseMeanRevertingOracle(const Timestamp& mkt_open, const Timestamp& mkt_close,
+                              const std::unordered_map<std::string, SparseMeanRevertingParams>& symbols,
+                              uint64_t seed)
+        : mkt_open(mkt_open.to_nanoseconds()), mkt_close(mkt_close.to_nanoseconds()) {
+        /*
+        Arguments:
+            mkt_open, mkt_close: Trading hours; every fundamental starts at r_bar at the open.
+            symbols: Parameters per symbol name.
+            seed: Seeds every symbol's stream (together with its SymbolId).
+        */
+        // Intern in name order, so symbol ids (and so streams) do not depend on hashing.
+        std::vector<std::string> names;
+        for (const auto& entry : symbols) { names.push_back(entry.first); }
+        std::sort(names.begin(), names.end());
+
+        for (const std::string& name : names) {
+            const SparseMeanRevertingParams& params = symbols.at(name);
+            SymbolId symbol = SymbolTable::intern(name);
+            if (states.size() <= symbol) { states.resize(symbol + 1); }
+
+            if (params.grid <= 0) {
+                throw std::invalid_argument("SparseMeanRevertingOracle grid must be positive for symbol " + name);
+            }
+            std::unique_ptr<SymbolState> s(new SymbolState());
+            s->params = params;
+            s->grid_rng = RandomStream(seed, symbol);
+            s->bridge_rng = RandomStream(seed, (uint64_t(1) << 32) | symbol);
+            s->checkpoints.push_back(params.r_bar);
+            s->window.resize(CHECKPOINT_EVERY + 1);
+            fillWindow(*s, 0);
+            states[symbol] = std::move(s);
+        }
+    }
+
+    double getFundamental(SymbolId symbol, const Timestamp& time) override {
+        SymbolState& s = state(symbol);
+        int64_t t = std::min<int64_t>(time.to_nanoseconds(), mkt_close - 1);
+        t = std::max<int64_t>(t - mkt_open, 0);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return valueAt(s, t);
+    }
+
+    int getDailyOpenPrice(SymbolId symbol, const Timestamp&) override {
+        // Every fundamental opens at its long-run mean.
+        return static_cast<int>(std::lround(state(symbol).params.r_bar));
+    }
+};
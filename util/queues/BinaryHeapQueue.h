@@ -0,0 +1,36 @@
+#pragma once
+#include <queue>
+#include <vector>
+#include <functional>
+#include "EventQueue.h"
+
+class BinaryHeapQueue : public EventQueue {
+    /*
+    Reference event queue backed by std::priority_queue.  O(log n) push and pop.
+    */
+
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> heap;
+
+public:
+    void push(const QueueEntry& entry) override {
+        heap.push(entry);
+    }
+
+    const QueueEntry& top() override {
+        return heap.top();
+    }
+
+    QueueEntry pop() override {
+        QueueEntry entry = heap.top();
+        heap.pop();
+        return entry;
+    }
+
+    bool empty() const override {
+        return heap.empty();
+    }
+
+    std::size_t size() const override {
+        return heap.size();
+    }
+};
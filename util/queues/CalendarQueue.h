@@ -0,0 +1,217 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include "EventQueue.h"
+
+class CalendarQueue : public EventQueue {
+    /*
+    Calendar queue (R. Brown, 1988) for the Kernel's pending events.
+
+    Time is divided into "days" of `width` nanoseconds, hashed into a power-of-two number
+    of buckets (a "year").  Each bucket holds its entries sorted by delivery time, so a
+    pop only has to walk forward from the bucket of the last popped event until it finds
+    an entry belonging to the current year.  The number of buckets tracks the queue size
+    and the day width is re-estimated from the gaps between the earliest pending events
+    on every resize, which keeps the expected number of entries per day at a small constant
+    and gives amortised O(1) push and pop.
+
+    Within a bucket entries are ordered by their full key, so ties on delivery time are
+    broken by sequence number exactly as in the binary heap.
+    */
+
+    struct Bucket {
+        // Sorted ascending; entries before `head` have already been popped (at most
+        // half of `items`, see pop()).
+        std::vector<QueueEntry> items;
+        std::size_t head = 0;
+
+        bool empty() const { return head == items.size(); }
+        const QueueEntry& front() const { return items[head]; }
+    };
+
+    static constexpr std::size_t MIN_BUCKETS = 16;
+    static constexpr std::size_t WIDTH_SAMPLE = 64;
+
+    std::vector<Bucket> buckets;
+    std::size_t mask;
+    int64_t width;
+    std::size_t count;
+
+    // Scan state: the bucket holding the current earliest entry, and the exclusive
+    // upper time bound of that bucket's day in the current year.
+    std::size_t lastBucket;
+    int64_t bucketTop;
+    bool located;
+
+    static int64_t nanos(const QueueEntry& entry) { return queueKeyNanos(entry.key); }
+
+    std::size_t bucketOf(int64_t ts) const { return static_cast<std::size_t>(ts / width) & mask; }
+
+    void moveScanTo(int64_t ts) {
+        lastBucket = bucketOf(ts);
+        bucketTop = (ts / width + 1) * width;
+    }
+
+    void locate() {
+        /*
+        Positions lastBucket on the bucket holding the earliest entry.
+        */
+        if (located) { return; }
+
+        std::size_t i = lastBucket;
+        int64_t top = bucketTop;
+        for (std::size_t n = 0; n < buckets.size(); n++) {
+            const Bucket& b = buckets[i];
+            if (!b.empty() && nanos(b.front()) < top) {
+                lastBucket = i;
+                bucketTop = top;
+                located = true;
+                return;
+            }
+            i = (i + 1) & mask;
+            top += width;
+        }
+
+        // Nothing due within a full year: fall back to a direct search for the minimum.
+        const QueueEntry* best = nullptr;
+        for (const Bucket& b : buckets) {
+            if (!b.empty() && (best == nullptr || b.front() < *best)) {
+                best = &b.front();
+            }
+        }
+        moveScanTo(nanos(*best));
+        located = true;
+    }
+
+    void resize(std::size_t new_buckets) {
+        /*
+        Re-buckets every entry in one pass, so a resize is O(n) and push and pop stay
+        amortised O(1).  Only the WIDTH_SAMPLE earliest entries are put in order, for the
+        width estimate, and then each new bucket, which holds a few entries on average.
+        */
+        std::vector<QueueEntry> all;
+        all.reserve(count);
+        for (Bucket& b : buckets) {
+            all.insert(all.end(), b.items.begin() + b.head, b.items.end());
+        }
+        std::size_t sample = std::min(all.size(), WIDTH_SAMPLE);
+        std::partial_sort(all.begin(), all.begin() + sample, all.end());
+
+        width = estimateWidth(all);
+        buckets.assign(new_buckets, Bucket());
+        mask = new_buckets - 1;
+
+        for (const QueueEntry& entry : all) {
+            buckets[bucketOf(nanos(entry))].items.push_back(entry);
+        }
+        for (Bucket& b : buckets) {
+            if (!std::is_sorted(b.items.begin(), b.items.end())) { std::sort(b.items.begin(), b.items.end()); }
+        }
+        if (!all.empty()) { moveScanTo(nanos(all.front())); }
+        located = false;
+    }
+
+    int64_t estimateWidth(const std::vector<QueueEntry>& sorted) const {
+        /*
+        Brown's heuristic: three times the mean separation of the earliest events, after
+        discarding separations more than twice the initial mean.  Runs of identical
+        timestamps are common in the simulation (broadcasts, simultaneous wakeups), so
+        zero gaps are ignored rather than driving the width down to nothing.  Only the
+        first WIDTH_SAMPLE entries of `sorted` need be in order.
+        */
+        std::size_t n = std::min(sorted.size(), WIDTH_SAMPLE);
+        int64_t total = 0;
+        std::size_t gaps = 0;
+        for (std::size_t i = 1; i < n; i++) {
+            int64_t gap = nanos(sorted[i]) - nanos(sorted[i-1]);
+            if (gap > 0) { total += gap; gaps++; }
+        }
+        if (gaps == 0) { return width; }
+
+        int64_t mean = total / gaps;
+        total = 0;
+        gaps = 0;
+        for (std::size_t i = 1; i < n; i++) {
+            int64_t gap = nanos(sorted[i]) - nanos(sorted[i-1]);
+            if (gap > 0 && gap <= 2 * mean) { total += gap; gaps++; }
+        }
+        if (gaps == 0) { return std::max<int64_t>(1, 3 * mean); }
+
+        return std::max<int64_t>(1, 3 * (total / gaps));
+    }
+
+public:
+    CalendarQueue(int64_t initial_width = 1000)
+    : buckets(MIN_BUCKETS), mask(MIN_BUCKETS - 1), width(std::max<int64_t>(1, initial_width)),
+      count(0), lastBucket(0), bucketTop(width), located(false) {}
+    /*
+    Arguments:
+        initial_width: Day width in nanoseconds used until enough events have been seen
+            to estimate one.
+    */
+
+    void push(const QueueEntry& entry) override {
+        int64_t ts = nanos(entry);
+        if (ts < 0) {
+            throw std::invalid_argument("CalendarQueue cannot hold entries with an invalid timestamp.");
+        }
+
+        Bucket& b = buckets[bucketOf(ts)];
+        if (b.empty()) {
+            b.items.clear();
+            b.head = 0;
+            b.items.push_back(entry);
+        }
+        else {
+            // Keys are usually increasing, so this is almost always the end.
+            auto pos = std::upper_bound(b.items.begin() + b.head, b.items.end(), entry);
+            b.items.insert(pos, entry);
+        }
+        count++;
+
+        // An entry earlier than the current day moves the scan back to it.
+        if (count == 1 || ts < bucketTop - width) {
+            moveScanTo(ts);
+        }
+        located = false;
+
+        if (count > 2 * buckets.size()) { resize(2 * buckets.size()); }
+    }
+
+    const QueueEntry& top() override {
+        locate();
+        return buckets[lastBucket].front();
+    }
+
+    QueueEntry pop() override {
+        locate();
+        Bucket& b = buckets[lastBucket];
+        QueueEntry entry = b.items[b.head++];
+        if (b.empty()) {
+            b.items.clear();
+            b.head = 0;
+        }
+        else if (b.head > b.items.size() / 2) {
+            // A bucket that keeps receiving entries for later years may never empty, so
+            // drop the popped prefix once it is the larger part (amortised O(1)).
+            b.items.erase(b.items.begin(), b.items.begin() + b.head);
+            b.head = 0;
+        }
+        count--;
+        located = false;
+
+        if (buckets.size() > MIN_BUCKETS && count < buckets.size() / 2) { resize(buckets.size() / 2); }
+
+        return entry;
+    }
+
+    bool empty() const override {
+        return count == 0;
+    }
+
+    std::size_t size() const override {
+        return count;
+    }
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "../timestamping.h"
+
+class Message;
+
+/* Total ordering key for queued events: delivery time in the high 64 bits and a
+   sequence number in the low 64 bits, so events due at the same nanosecond are ordered
+   with a single integer comparison.  The Kernel's sequence number is
+   (sender id << 40) | per-sender event count, so ties go sender-major: lower sender ids
+   first, and each sender's events in the order it created them.  That order does not
+   depend on how agents are spread over threads. */
+typedef unsigned __int128 QueueKey;
+
+inline QueueKey makeQueueKey(const Timestamp& ts, uint64_t seq) {
+    // Flip the sign bit so signed nanoseconds order correctly as unsigned.
+    uint64_t time_bits = static_cast<uint64_t>(ts.to_nanoseconds()) ^ (uint64_t(1) << 63);
+    return (static_cast<QueueKey>(time_bits) << 64) | seq;
+}
+
+inline int64_t queueKeyNanos(QueueKey key) {
+    return static_cast<int64_t>(static_cast<uint64_t>(key >> 64) ^ (uint64_t(1) << 63));
+}
+
+struct QueueEntry {
+
+    QueueKey key;
+    int senderId;
+    int recipientId;
+    const Message* msg;
+
+    QueueEntry() : key(0), senderId(-1), recipientId(-1), msg(nullptr) {}
+
+    QueueEntry(const Timestamp& ts, uint64_t seq, int senderId, int recipientId, const Message* msg)
+    : key(makeQueueKey(ts, seq)), senderId(senderId), recipientId(recipientId), msg(msg) {}
+
+    Timestamp time() const { return Timestamp(queueKeyNanos(key)); }
+
+    uint64_t seq() const { return static_cast<uint64_t>(key); }
+
+    // The queue always yields the entry with the smallest key first.
+    bool operator<(const QueueEntry& other) const {
+        return key < other.key;
+    }
+
+    bool operator>(const QueueEntry& other) const {
+        return key > other.key;
+    }
+};
+
+
+enum class EventQueueType {
+    BINARY_HEAP,
+    CALENDAR
+};
+
+
+class EventQueue {
+    /*
+    Interface for the Kernel's pending event queue.  Entries are yielded in strictly
+    increasing key order, i.e. by delivery time and then by sequence number.
+
+    The Kernel selects a concrete implementation at construction (see EventQueueType).
+    The binary heap is kept as the reference backend; the calendar queue gives amortised
+    O(1) push/pop for the dense, mostly-forward timestamps the simulation generates.
+    */
+
+public:
+    virtual ~EventQueue() = default;
+
+    virtual void push(const QueueEntry& entry) = 0;
+    /*
+    Adds an entry to the queue.
+    */
+
+    virtual const QueueEntry& top() = 0;
+    /*
+    Returns the earliest entry without removing it.  The queue must not be empty.
+    */
+
+    virtual QueueEntry pop() = 0;
+    /*
+    Removes and returns the earliest entry.  The queue must not be empty.
+    */
+
+    virtual bool empty() const = 0;
+
+    virtual std::size_t size() const = 0;
+};
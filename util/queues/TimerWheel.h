@@ -0,0 +1,347 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EventQueue.h"
+
+struct WakeupHandle {
+    /*
+    Identifies one pending wakeup, for cancelling or rescheduling it.  A handle goes
+    stale once its wakeup has fired or been cancelled; using it then is a harmless no-op.
+    */
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != UINT32_MAX; }
+};
+
+
+class TimerWheel {
+    /*
+    Hierarchical timing wheel holding the Kernel's pending wakeups.
+
+    Time is counted in ticks of 1024 ns.  Six levels of 64 slots each cover 2^36 ticks
+    (about 19.5 hours); level k holds the wakeups whose tick first differs from the
+    wheel's current tick in the k-th group of six bits, in the slot given by that group.
+    Inserting or cancelling a wakeup is O(1) (unlink from an intrusive slot list).
+    Finding the next wakeup is a count-trailing-zeros on the lowest non-empty level,
+    occasionally cascading one slot's wakeups down a level.  Wakeups beyond the wheel's
+    range wait in an overflow heap.
+
+    Wakeups that are due (their tick has been reached) move to a small `ready` heap
+    ordered by full QueueKey, so the wheel yields exactly the same order as the event
+    queue would: by time, then by sequence number.  The Kernel pops from whichever of
+    the wheel and its message queue has the smaller key.
+
+    Entries are stored in a node array and handles are (index, generation) pairs, so a
+    handle to a wakeup that has since fired, and whose node was reused, is recognised
+    as stale.
+    */
+
+    static constexpr int LEVELS = 6;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int TICK_SHIFT = 10;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    enum Where : uint8_t { FREE, SLOT, READY, OVERFLOW, FIRING };
+
+    struct Node {
+        QueueEntry entry;
+        uint32_t prev;          // Slot list links.
+        uint32_t next;          // Slot list link, or next free node.
+        uint32_t pos;           // Position in the ready or overflow heap.
+        uint32_t generation;
+        uint16_t slot;          // level * SLOTS + slot, while in a slot.
+        uint8_t where;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t free_head;
+    uint32_t heads[LEVELS * SLOTS];
+    uint64_t occupied[LEVELS];
+    std::vector<uint32_t> ready;
+    std::vector<uint32_t> overflow;
+    int64_t now_tick;
+    std::size_t count;
+
+    static int64_t tickOf(const QueueEntry& entry) {
+        return queueKeyNanos(entry.key) >> TICK_SHIFT;
+    }
+
+    /* ---- Heaps of node indices, ordered by key, with positions kept in the nodes. ---- */
+
+    bool less(uint32_t a, uint32_t b) const {
+        return nodes[a].entry.key < nodes[b].entry.key;
+    }
+
+    void place(std::vector<uint32_t>& heap, std::size_t pos, uint32_t idx) {
+        heap[pos] = idx;
+        nodes[idx].pos = static_cast<uint32_t>(pos);
+    }
+
+    void siftUp(std::vector<uint32_t>& heap, std::size_t pos) {
+        uint32_t idx = heap[pos];
+        while (pos > 0) {
+            std::size_t parent = (pos - 1) / 2;
+            if (!less(idx, heap[parent])) { break; }
+            place(heap, pos, heap[parent]);
+            pos = parent;
+        }
+        place(heap, pos, idx);
+    }
+
+    void siftDown(std::vector<uint32_t>& heap, std::size_t pos) {
+        uint32_t idx = heap[pos];
+        std::size_t n = heap.size();
+        while (true) {
+            std::size_t child = 2 * pos + 1;
+            if (child >= n) { break; }
+            if (child + 1 < n && less(heap[child + 1], heap[child])) { child++; }
+            if (!less(heap[child], idx)) { break; }
+            place(heap, pos, heap[child]);
+            pos = child;
+        }
+        place(heap, pos, idx);
+    }
+
+    void heapPush(std::vector<uint32_t>& heap, uint32_t idx) {
+        heap.push_back(idx);
+        siftUp(heap, heap.size() - 1);
+    }
+
+    void heapErase(std::vector<uint32_t>& heap, std::size_t pos) {
+        uint32_t last = heap.back();
+        heap.pop_back();
+        if (pos == heap.size()) { return; }
+        place(heap, pos, last);
+        siftUp(heap, pos);
+        siftDown(heap, nodes[last].pos);
+    }
+
+    /* ---- Slots. ---- */
+
+    void link(uint32_t idx, int level, int slot) {
+        Node& node = nodes[idx];
+        uint16_t s = static_cast<uint16_t>(level * SLOTS + slot);
+        node.where = SLOT;
+        node.slot = s;
+        node.prev = NIL;
+        node.next = heads[s];
+        if (heads[s] != NIL) { nodes[heads[s]].prev = idx; }
+        heads[s] = idx;
+        occupied[level] |= uint64_t(1) << slot;
+    }
+
+    void unlink(uint32_t idx) {
+        Node& node = nodes[idx];
+        uint16_t s = node.slot;
+        if (node.prev != NIL) { nodes[node.prev].next = node.next; } else { heads[s] = node.next; }
+        if (node.next != NIL) { nodes[node.next].prev = node.prev; }
+        if (heads[s] == NIL) { occupied[s / SLOTS] &= ~(uint64_t(1) << (s % SLOTS)); }
+    }
+
+    void insert(uint32_t idx) {
+        int64_t tick = tickOf(nodes[idx].entry);
+        if (tick <= now_tick) {
+            nodes[idx].where = READY;
+            heapPush(ready, idx);
+            return;
+        }
+        uint64_t diff = static_cast<uint64_t>(tick ^ now_tick);
+        int level = (63 - __builtin_clzll(diff)) / SLOT_BITS;
+        if (level >= LEVELS) {
+            nodes[idx].where = OVERFLOW;
+            heapPush(overflow, idx);
+            return;
+        }
+        link(idx, level, static_cast<int>((tick >> (SLOT_BITS * level)) & (SLOTS - 1)));
+    }
+
+    void detach(uint32_t idx) {
+        // Removes a pending node from whichever structure holds it.
+        Node& node = nodes[idx];
+        if (node.where == SLOT) { unlink(idx); }
+        else if (node.where == READY) { heapErase(ready, node.pos); }
+        else if (node.where == OVERFLOW) { heapErase(overflow, node.pos); }
+    }
+
+    void freeNode(uint32_t idx) {
+        Node& node = nodes[idx];
+        node.where = FREE;
+        node.generation++;
+        node.next = free_head;
+        free_head = idx;
+    }
+
+    Node* lookup(WakeupHandle handle) {
+        if (handle.index >= nodes.size()) { return nullptr; }
+        Node& node = nodes[handle.index];
+        return node.generation == handle.generation && node.where != FREE ? &node : nullptr;
+    }
+
+    bool prepare() {
+        /*
+        Advances the wheel until the earliest wakeup is in the ready heap.  Returns false
+        if there are no wakeups at all.
+        */
+        while (ready.empty()) {
+            int level = 0;
+            while (level < LEVELS && occupied[level] == 0) { level++; }
+
+            if (level == LEVELS) {
+                if (overflow.empty()) { return false; }
+                // The wheel is empty, so it may jump straight to the earliest far wakeup
+                // and take in everything that now falls within its range.
+                now_tick = tickOf(nodes[overflow[0]].entry);
+                while (!overflow.empty()
+                       && (static_cast<uint64_t>(tickOf(nodes[overflow[0]].entry) ^ now_tick) >> (SLOT_BITS * LEVELS)) == 0) {
+                    uint32_t idx = overflow[0];
+                    heapErase(overflow, 0);
+                    insert(idx);
+                }
+                continue;
+            }
+
+            // Every occupied slot is later than the current tick, and all lower levels
+            // are empty, so the wheel can advance to the start of the first occupied slot.
+            int slot = __builtin_ctzll(occupied[level]);
+            int shift = SLOT_BITS * level;
+            uint64_t above = ~((uint64_t(1) << (shift + SLOT_BITS)) - 1);
+            now_tick = static_cast<int64_t>((static_cast<uint64_t>(now_tick) & above) | (static_cast<uint64_t>(slot) << shift));
+
+            uint16_t s = static_cast<uint16_t>(level * SLOTS + slot);
+            uint32_t idx = heads[s];
+            heads[s] = NIL;
+            occupied[level] &= ~(uint64_t(1) << slot);
+            while (idx != NIL) {
+                uint32_t next = nodes[idx].next;
+                insert(idx);
+                idx = next;
+            }
+        }
+        return true;
+    }
+
+public:
+    TimerWheel() : free_head(NIL), now_tick(0), count(0) {
+        for (uint32_t& head : heads) { head = NIL; }
+        for (uint64_t& bits : occupied) { bits = 0; }
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    WakeupHandle push(const QueueEntry& entry) {
+        uint32_t idx;
+        if (free_head != NIL) {
+            idx = free_head;
+            free_head = nodes[idx].next;
+        }
+        else {
+            idx = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+            nodes.back().generation = 0;
+        }
+        nodes[idx].entry = entry;
+        insert(idx);
+        count++;
+        return WakeupHandle{idx, nodes[idx].generation};
+    }
+
+    const QueueEntry& top() {
+        /*
+        Returns the earliest pending wakeup.  The wheel must not be empty.
+        */
+        prepare();
+        return nodes[ready[0]].entry;
+    }
+
+    QueueEntry pop(WakeupHandle& handle) {
+        /*
+        Removes the earliest pending wakeup and returns it, with its handle.  The wakeup
+        is then firing: call finish() once it has been delivered, or defer() to put it
+        back for a later time.  The wheel must not be empty.
+        */
+        prepare();
+        uint32_t idx = ready[0];
+        heapErase(ready, 0);
+        nodes[idx].where = FIRING;
+        count--;
+        handle = WakeupHandle{idx, nodes[idx].generation};
+        return nodes[idx].entry;
+    }
+
+    void finish(WakeupHandle handle) {
+        Node* node = lookup(handle);
+        if (node != nullptr && node->where == FIRING) { freeNode(handle.index); }
+    }
+
+    void defer(WakeupHandle handle, QueueKey key) {
+        /*
+        Puts a firing wakeup back with a new key, keeping its handle.
+        */
+        Node* node = lookup(handle);
+        if (node == nullptr || node->where != FIRING) { return; }
+        node->entry.key = key;
+        insert(handle.index);
+        count++;
+    }
+
+    bool cancel(WakeupHandle handle, QueueEntry& cancelled) {
+        /*
+        Removes a pending wakeup.  Returns false (and leaves `cancelled` alone) if the
+        handle is stale or its wakeup is firing right now.
+        */
+        Node* node = lookup(handle);
+        if (node == nullptr || node->where == FIRING) { return false; }
+        detach(handle.index);
+        cancelled = node->entry;
+        freeNode(handle.index);
+        count--;
+        return true;
+    }
+
+    bool reschedule(WakeupHandle handle, QueueKey key) {
+        /*
+        Moves a pending wakeup to a new key, keeping its handle.  Returns false if the
+        handle is stale or its wakeup is firing right now.
+        */
+        Node* node = lookup(handle);
+        if (node == nullptr || node->where == FIRING) { return false; }
+        detach(handle.index);
+        node->entry.key = key;
+        insert(handle.index);
+        return true;
+    }
+
+    void clear() {
+        /*
+        Drops every wakeup (pending or firing), invalidating all outstanding handles.
+        */
+        for (uint32_t idx = 0; idx < nodes.size(); idx++) {
+            if (nodes[idx].where != FREE) { freeNode(idx); }
+        }
+        for (uint32_t& head : heads) { head = NIL; }
+        for (uint64_t& bits : occupied) { bits = 0; }
+        ready.clear();
+        overflow.clear();
+        count = 0;
+    }
+
+    const QueueEntry* find(WakeupHandle handle) {
+        /*
+        Returns the pending (or firing) wakeup for a handle, or nullptr if it is stale.
+        */
+        Node* node = lookup(handle);
+        return node == nullptr ? nullptr : &node->entry;
+    }
+};
@@ -29,7 +29,8 @@ struct Timestamp {
         // Convert nanoseconds to time_point
         auto time_point = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(ns_since_epoch));
         std::time_t time = std::chrono::system_clock::to_time_t(time_point);
-        std::tm tm = *std::localtime(&time);
+        std::tm tm;
+        localtime_r(&time, &tm);     // Reentrant: simulations may format times on several threads.
 
         std::ostringstream oss;
         oss << std::put_time(&tm, format.c_str());
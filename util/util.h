@@ -1,29 +1,35 @@
 #pragma once
+#include <cstdint>
 #include <random>
+#include "RandomStream.h"
 #include <iostream>
 #include <unordered_map>
 #include <sstream>  // For std::ostringstream
 #include <string>
 
+// Per-thread fallback stream behind genRandUniform()/genRandInt(), for code that has
+// no stream of its own (agents should use Agent::random instead).  Seeded from
+// hardware until seedRandom() is called.  Per-thread so concurrent simulations (see
+// BatchRunner) neither race on it nor perturb each other's draws.
+inline RandomStream& threadRandomStream() {
+    static thread_local RandomStream stream(
+        (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}());
+    return stream;
+}
+
+// Reseeds the calling thread's fallback stream, making its subsequent draws reproducible.
+inline void seedRandom(uint64_t seed) {
+    threadRandomStream() = RandomStream(seed);
+}
+
 // Utility function to generate a random uniform variable in [0, 1).
 inline double genRandUniform() {
-    // Initialise a static random number generator.
-    static std::random_device rd;  // Obtain a random number from hardware.
-    static std::mt19937 gen(rd()); // Seed the generator with a random number.
-    static std::uniform_real_distribution<> dis(0.0, 1.0); // Define the distribution.
-
-    // Generate and return a random number.
-    return dis(gen);
+    return threadRandomStream().uniform();
 }
 
+// Random integer in [min, max], inclusive.
 inline int genRandInt(int min, int max) {
-    // Initialise a static random number generator.
-    static std::random_device rd;  // Obtain a random number from hardware.
-    static std::mt19937 gen(rd()); // Seed the generator with a random number.
-    std::uniform_int_distribution<> dis(min, max); // Define the distribution.
-
-    // Generate and return a random integer.
-    return dis(gen);
+    return threadRandomStream().uniformInt(min, max);
 }
 
 template<typename K, typename V>
@@ -46,7 +52,7 @@ std::string unorderedMapToString(const std::unordered_map<K, V>& map) {
     return result;
 }
 
-std::string dollarise(int cents) {
+inline std::string dollarise(int cents) {
         /*
         Used to dollarize an int-cents price for printing.
         */
@@ -54,4 +60,4 @@ std::string dollarise(int cents) {
 }
 
 template <typename T>
-std::string str(T val) { return std::to_string(T); }
+std::string str(T val) { return std::to_string(val); }